@@ -0,0 +1,34 @@
+extends SceneTree
+
+# Runs every test case in this folder and quits with a non-zero exit code if
+# any check failed. Run it headless from the demo-folder:
+#   godot --headless --script res://tests/run_tests.gd
+
+const TEST_DIRECTORY := "res://tests/"
+
+func _initialize() -> void:
+	run_all.call_deferred()
+
+func run_all() -> void:
+	DirAccess.make_dir_recursive_absolute(TestCase.DATA_DIRECTORY)
+
+	var checks := 0
+	var failures := 0
+	var file_names := Array(DirAccess.get_files_at(TEST_DIRECTORY))
+	file_names.sort()
+	for file_name in file_names:
+		if not file_name.begins_with("test_") or not file_name.ends_with(".gd"):
+			continue
+		var test_case = load(TEST_DIRECTORY + file_name).new()
+		test_case.tree = self
+		for method in test_case.get_method_list():
+			if not method["name"].begins_with("test_"):
+				continue
+			test_case.current_test = file_name.get_basename() + "." + method["name"]
+			print("Running " + test_case.current_test)
+			await test_case.call(method["name"])
+		checks += test_case.checks
+		failures += test_case.failures
+
+	print("%d checks, %d failures" % [checks, failures])
+	quit(1 if failures > 0 else 0)
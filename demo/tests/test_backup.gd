@@ -0,0 +1,137 @@
+extends "res://tests/test_case.gd"
+
+const ROW_COUNT := 2000
+
+# Starts a background backup without keeping a reference to it. Returns an
+# array that receives the result of the completed signal.
+func start_unreferenced_backup(db : SQLite, destination : String, pages_per_step : int) -> Array:
+	var results := []
+	var backup : SQLiteBackup = db.begin_backup_to(destination)
+	backup.completed.connect(func(success): results.append(success))
+	check(backup.run_in_background(pages_per_step), "Starting a background backup should succeed")
+	return results
+
+func wait_for_results(results : Array, max_frames : int = 600) -> void:
+	for i in max_frames:
+		if not results.is_empty():
+			return
+		await wait_frames()
+
+func test_stepped_backup_copies_everything() -> void:
+	var source_path := create_players_database("backup_source.db", ROW_COUNT)
+	var db := open_database(source_path)
+	var destination := database_path("backup_stepped.db")
+
+	var results := []
+	var backup : SQLiteBackup = db.begin_backup_to(destination)
+	backup.completed.connect(func(success): results.append(success))
+	var rc := SQLite.SQLITE_OK
+	while rc == SQLite.SQLITE_OK:
+		rc = backup.step(4)
+	check_equal(rc, SQLite.SQLITE_DONE, "Stepping should end with SQLITE_DONE")
+	check(backup.is_finished(), "The backup should be finished")
+	check_equal(backup.get_remaining(), 0, "No pages should remain")
+	check_equal(results, [true], "completed should be emitted once with success")
+	check_equal(backup.step(), SQLite.SQLITE_DONE, "Stepping a finished backup should keep returning its result")
+	db.close_db()
+
+	var copy := open_database(destination)
+	check_equal(count_rows(copy, "players"), ROW_COUNT, "The copy should contain all rows")
+	copy.close_db()
+
+func test_background_backup_outlives_its_reference() -> void:
+	var source_path := create_players_database("backup_background_source.db", ROW_COUNT)
+	var db := open_database(source_path)
+	var destination := database_path("backup_background.db")
+
+	var results := start_unreferenced_backup(db, destination, 1)
+	await wait_for_results(results)
+	check_equal(results, [true], "A backup without references should still complete")
+	db.close_db()
+
+	var copy := open_database(destination)
+	check_equal(count_rows(copy, "players"), ROW_COUNT, "The copy should contain all rows")
+	copy.close_db()
+
+func test_background_backup_waits_for_locked_destinations() -> void:
+	var source_path := create_players_database("backup_locked_source.db", ROW_COUNT)
+	var db := open_database(source_path)
+	var destination := database_path("backup_locked.db")
+
+	var blocker := open_database(destination)
+	blocker.query("BEGIN EXCLUSIVE;")
+	var results := start_unreferenced_backup(db, destination, 64)
+	await wait_frames(10)
+	check(results.is_empty(), "The backup should wait while the destination is locked")
+	blocker.query("COMMIT;")
+	blocker.close_db()
+
+	await wait_for_results(results)
+	check_equal(results, [true], "The backup should complete once the lock is released")
+	db.close_db()
+
+func test_cancelled_backups_emit_completed() -> void:
+	var source_path := create_players_database("backup_cancel_source.db", ROW_COUNT)
+	var db := open_database(source_path)
+
+	var results := []
+	var backup : SQLiteBackup = db.begin_backup_to(database_path("backup_cancelled.db"))
+	backup.completed.connect(func(success): results.append(success))
+	backup.step(1)
+	backup.cancel()
+	check_equal(results, [false], "Cancelling a stepped backup should emit completed with failure")
+	check(backup.is_finished(), "A cancelled backup should be finished")
+	check(not backup.run_in_background(), "A cancelled backup can't be restarted")
+	backup.cancel()
+	check_equal(results, [false], "Cancelling twice should emit completed only once")
+
+	# Blocking the destination keeps the background backup from finishing before it's cancelled
+	var destination := database_path("backup_cancelled_background.db")
+	var blocker := open_database(destination)
+	blocker.query("BEGIN EXCLUSIVE;")
+	var background_results := []
+	var background : SQLiteBackup = db.begin_backup_to(destination)
+	background.completed.connect(func(success): background_results.append(success))
+	background.run_in_background()
+	background.cancel()
+	blocker.query("COMMIT;")
+	blocker.close_db()
+	await wait_for_results(background_results)
+	check_equal(background_results, [false], "Cancelling a background backup should emit completed with failure")
+
+	check(db.begin_backup_to(DATA_DIRECTORY + "missing_folder/backup.db") == null, "Backing up to a missing folder should fail")
+	db.close_db()
+	check(db.begin_backup_to(destination) == null, "Backing up a closed database should fail")
+
+func test_buffer_backups_round_trip() -> void:
+	var source_path := create_players_database("backup_buffer_source.db", 100)
+	var db := open_database(source_path)
+	var buffer : PackedByteArray = db.backup_to_buffer()
+	check(buffer.slice(0, 15).get_string_from_ascii() == "SQLite format 3", "The buffer should contain a regular database file")
+	db.close_db()
+
+	var target := open_database(database_path("backup_buffer_target.db"))
+	target.query("CREATE TABLE obsolete (id INTEGER);")
+	check(target.restore_from_buffer(buffer), "Restoring from a buffer should succeed")
+	check_equal(count_rows(target, "players"), 100, "The restored database should contain all rows")
+	check(not target.query("SELECT * FROM obsolete;"), "Tables that weren't in the buffer should be gone")
+
+	check(not target.restore_from_buffer(PackedByteArray()), "Restoring from an empty buffer should fail")
+	check(not target.restore_from_buffer("not a database".to_utf8_buffer()), "Restoring from garbage should fail")
+	check_equal(count_rows(target, "players"), 100, "Failed restores should leave the database untouched")
+	target.close_db()
+	check(target.backup_to_buffer().is_empty(), "Backing up a closed database should fail")
+
+func test_backup_paths_are_validated() -> void:
+	var db := open_database(database_path("backup_paths.db"))
+	db.query("CREATE TABLE items (id INTEGER);")
+	check(not db.backup_to("res://tests/backup_destination.db"), "res:// should be rejected as backup destination")
+	check(db.begin_backup_to("res://tests/backup_destination.db") == null, "res:// should be rejected as incremental backup destination")
+	check(not FileAccess.file_exists("res://tests/backup_destination.db"), "Nothing should be written to res://")
+
+	var missing := DATA_DIRECTORY + "backup_missing_source.db"
+	check(not db.restore_from(missing), "Restoring from a missing file should fail")
+	check(db.begin_restore_from(missing) == null, "Incrementally restoring from a missing file should fail")
+	check(not FileAccess.file_exists(missing), "Restoring should never create its source")
+	check(db.query("SELECT * FROM items;"), "Failed restores should leave the database untouched")
+	db.close_db()
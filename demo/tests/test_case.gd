@@ -0,0 +1,64 @@
+extends RefCounted
+
+# Base class of all test cases. Every method of which the name starts with
+# "test_" is run by run_tests.gd, and is allowed to await frames of the tree.
+
+const DATA_DIRECTORY := "user://tests/"
+
+var tree : SceneTree
+var current_test := ""
+var checks := 0
+var failures := 0
+
+func check(condition : bool, message : String) -> void:
+	checks += 1
+	if not condition:
+		failures += 1
+		printerr("FAILED %s: %s" % [current_test, message])
+
+func check_equal(actual, expected, message : String) -> void:
+	var numbers := [TYPE_INT, TYPE_FLOAT]
+	var comparable : bool = typeof(actual) == typeof(expected) or (typeof(actual) in numbers and typeof(expected) in numbers)
+	check(comparable and actual == expected, "%s (expected %s, got %s)" % [message, str(expected), str(actual)])
+
+# Returns the path of a database file in the data directory, after removing
+# whatever a previous run left behind.
+func database_path(file_name : String) -> String:
+	var path := DATA_DIRECTORY + file_name
+	for suffix in ["", "-journal", "-wal", "-shm"]:
+		if FileAccess.file_exists(path + suffix):
+			DirAccess.remove_absolute(path + suffix)
+	return path
+
+# Opens a connection to the given path. The optional callable gets to set any
+# properties before the connection is opened.
+func open_database(path : String, configure : Callable = Callable()) -> SQLite:
+	var db := SQLite.new()
+	db.path = path
+	db.default_extension = ""
+	db.verbosity_level = SQLite.QUIET
+	if configure.is_valid():
+		configure.call(db)
+	check(db.open_db(), "Opening %s should succeed" % path)
+	return db
+
+# Creates a database file with a "players" table holding the given number of rows.
+func create_players_database(file_name : String, row_count : int = 10) -> String:
+	var path := database_path(file_name)
+	var db := open_database(path)
+	db.query("CREATE TABLE players (id INTEGER PRIMARY KEY, name TEXT NOT NULL, level INTEGER NOT NULL);")
+	var rows := []
+	for i in row_count:
+		rows.append({"id": i + 1, "name": "player_%d" % (i + 1), "level": i % 5})
+	db.insert_rows("players", rows)
+	db.close_db()
+	return path
+
+func count_rows(db : SQLite, table_name : String) -> int:
+	if not db.query("SELECT COUNT(*) AS count FROM %s;" % table_name) or db.query_result.is_empty():
+		return -1
+	return db.query_result[0]["count"]
+
+func wait_frames(count : int = 1) -> void:
+	for i in count:
+		await tree.process_frame
@@ -0,0 +1,67 @@
+extends "res://tests/test_case.gd"
+
+func test_compact_to_writes_a_smaller_copy() -> void:
+	var path := create_players_database("compaction_source.db", 2000)
+	var db := open_database(path)
+	db.delete_rows("players", "id > 100")
+
+	var progress := []
+	var row_counts := []
+	# Handlers run once the copy has been written, so they are free to use the connection
+	var on_progress := func(value):
+		progress.append(value)
+		row_counts.append(count_rows(db, "players"))
+	db.compaction_progress.connect(on_progress)
+	var destination := database_path("compaction_copy.db")
+	check(db.compact_to(destination), "Compacting to a new file should succeed")
+	check(progress.is_empty(), "Progress should only be reported on the next idle frame")
+	await wait_frames(2)
+	check(not progress.is_empty() and progress[-1] == 1.0, "The last progress should be 1.0")
+	check(row_counts.all(func(count): return count == 100), "Handlers should be able to query the database")
+	check(FileAccess.get_file_as_bytes(destination).size() < FileAccess.get_file_as_bytes(path).size(), "The copy should be smaller")
+	check(not db.compact_to(destination), "Compacting to an existing file should fail")
+	db.close_db()
+
+	var copy := open_database(destination)
+	check_equal(count_rows(copy, "players"), 100, "The copy should contain all remaining rows")
+	copy.close_db()
+
+func test_incremental_vacuum_releases_free_pages() -> void:
+	var path := database_path("compaction_incremental.db")
+	var db := open_database(path, func(connection): connection.auto_vacuum = SQLite.AUTO_VACUUM_INCREMENTAL)
+	db.query("CREATE TABLE items (id INTEGER PRIMARY KEY, data BLOB);")
+	var data := PackedByteArray()
+	data.resize(1024)
+	for i in 200:
+		db.insert_row("items", {"id": i, "data": data})
+	db.delete_rows("items", "id >= 10")
+
+	var progress := []
+	db.compaction_progress.connect(func(value): progress.append(value))
+	check_equal(db.incremental_vacuum(0x7FFFFFFF), 0, "All free pages should be released")
+	check(not progress.is_empty(), "Progress should be reported")
+	check_equal(count_rows(db, "items"), 10, "No rows should be lost")
+	db.close_db()
+
+	var plain := open_database(database_path("compaction_plain.db"))
+	check_equal(plain.incremental_vacuum(10), -1, "Incremental vacuum requires AUTO_VACUUM_INCREMENTAL")
+	plain.close_db()
+
+func test_failed_auto_vacuum_closes_the_connection() -> void:
+	var path := create_players_database("compaction_read_only.db")
+
+	var db := SQLite.new()
+	db.path = path
+	db.default_extension = ""
+	db.verbosity_level = SQLite.QUIET
+	db.read_only = true
+	db.auto_vacuum = SQLite.AUTO_VACUUM_FULL
+	check(not db.open_db(), "Changing the auto_vacuum mode of a read-only database should fail")
+	check_equal(db.get_autocommit(), 1, "The connection should be closed after the failure")
+	check_equal(DirAccess.remove_absolute(path), OK, "No handle to the file should be left behind")
+
+	create_players_database(path.get_file())
+	db.auto_vacuum = SQLite.AUTO_VACUUM_UNCHANGED
+	check(db.open_db(), "Opening again should succeed once the configuration is fixed")
+	check_equal(count_rows(db, "players"), 10, "The database should be usable")
+	db.close_db()
@@ -0,0 +1,64 @@
+extends "res://tests/test_case.gd"
+
+func write_text(path : String, text : String) -> void:
+	var file := FileAccess.open(path, FileAccess.WRITE)
+	file.store_string(text)
+	file.close()
+
+func test_csv_export_round_trips_values() -> void:
+	var db := open_database(database_path("csv_round_trip.db"))
+	db.query("CREATE TABLE items (id INTEGER, label TEXT, value REAL, raw BLOB);")
+	db.insert_rows("items", [
+		{"id": 1, "label": "plain", "value": 0.1, "raw": PackedByteArray([0, 1, 255])},
+		{"id": 2, "label": "with \"quotes\", commas\nand newlines", "value": 3.0, "raw": null},
+		{"id": 3, "label": "", "value": 1.0e300, "raw": null},
+	])
+	var path := DATA_DIRECTORY + "csv_round_trip.csv"
+	check(db.export_csv("SELECT * FROM items ORDER BY id;", path), "Exporting a query to CSV should succeed")
+
+	check(db.import_csv("copies", path, {"column_types": {"label": "TEXT", "raw": "BLOB"}}), "Importing the CSV into a new table should succeed")
+	var rows : Array = db.select_rows("copies", "", ["*"])
+	check_equal(rows.size(), 3, "All rows should be imported")
+	check_equal(rows[0]["value"], 0.1, "Reals should round-trip exactly")
+	check_equal(typeof(rows[1]["value"]), TYPE_FLOAT, "Whole reals should stay reals")
+	check_equal(rows[1]["label"], "with \"quotes\", commas\nand newlines", "Quoted text should round-trip")
+	check_equal(rows[2]["label"], "", "Empty text should stay empty for TEXT columns")
+	check_equal(rows[0]["raw"], PackedByteArray([0, 1, 255]), "Blobs should round-trip as base64")
+	check_equal(rows[1]["raw"], null, "Empty fields should become NULL")
+	db.close_db()
+
+func test_csv_import_with_options() -> void:
+	var db := open_database(database_path("csv_options.db"))
+	db.query("CREATE TABLE scores (name TEXT, score INTEGER);")
+	var path := DATA_DIRECTORY + "csv_options.csv"
+	write_text(path, "'a;b';1\n\nplain;2\n")
+	check(db.import_csv("scores", path, {"header": false, "delimiter": ";", "quote": "'"}), "Importing with custom options should succeed")
+	var rows : Array = db.select_rows("scores", "", ["*"])
+	check_equal(rows.size(), 2, "Blank lines should be skipped")
+	check_equal(rows[0]["name"], "a;b", "Quoted delimiters should be kept")
+	check_equal(rows[1]["score"], 2, "Numbers should be converted")
+	db.close_db()
+
+func test_failed_csv_import_is_rolled_back() -> void:
+	var db := open_database(database_path("csv_failed.db"))
+	db.query("CREATE TABLE strict_scores (name TEXT NOT NULL, score INTEGER);")
+	var path := DATA_DIRECTORY + "csv_failed.csv"
+
+	write_text(path, "name,score\nfirst,1\nsecond,2,extra\n")
+	check(not db.import_csv("strict_scores", path), "Rows with too many fields should fail the import")
+	write_text(path, "name,score\nfirst,1\n,2\n")
+	check(not db.import_csv("strict_scores", path), "Constraint violations should fail the import")
+	write_text(path, "name,score\n\"first,1\n")
+	check(not db.import_csv("strict_scores", path), "Malformed quotes should fail the import")
+	check_equal(count_rows(db, "strict_scores"), 0, "Failed imports should not leave any rows behind")
+
+	write_text(path, "name,score\nfirst,1\nsecond,2,extra\n")
+	check(not db.import_csv("new_scores", path), "Importing into a new table should fail as well")
+	check(db.query("SELECT name FROM sqlite_master WHERE name = 'new_scores';"), "Looking up the table should succeed")
+	check(db.query_result.is_empty(), "Failed imports should not leave a newly created table behind")
+
+	check(not db.import_csv("strict_scores", DATA_DIRECTORY + "missing.csv"), "Missing files should fail the import")
+	check(not db.import_csv("strict_scores", path, {"delimiter": ";;"}), "Multi-character delimiters should be rejected")
+	check(not db.import_csv("strict_scores", path, {"column_types": {"score": "DATE"}}), "Unknown column types should be rejected")
+	check(not db.export_csv("SELECT * FROM missing_table;", DATA_DIRECTORY + "missing.csv"), "Exporting an invalid query should fail")
+	db.close_db()
@@ -0,0 +1,160 @@
+extends "res://tests/test_case.gd"
+
+func open_shared_database(path : String, reader_count : int = 2) -> SQLiteDatabase:
+	var database := SQLiteDatabase.new()
+	database.verbosity_level = SQLite.QUIET
+	database.reader_count = reader_count
+	check(database.open(path), "Opening %s should succeed" % path)
+	return database
+
+func test_queued_writes_are_read_back() -> void:
+	var database := open_shared_database(create_players_database("database_writes.db"))
+	var outcomes := {}
+	for name in ["Doomguy", "Chell"]:
+		database.queue_write("INSERT INTO players (name, level) VALUES (?, 1);", [name], func(success : bool, _error_message : String) -> void:
+			outcomes[name] = success
+		)
+	database.wait_for_writes()
+	await wait_frames(2)
+
+	check_equal(outcomes, {"Doomguy": true, "Chell": true}, "Both writes should report success")
+	var rows := database.read("SELECT name FROM players WHERE id > 10 ORDER BY id;")
+	check_equal(rows.map(func(row : Dictionary) -> String: return row["name"]), ["Doomguy", "Chell"], "Readers should see the committed writes")
+	database.close()
+
+func test_rolled_back_transactions_report_every_write() -> void:
+	var path := create_players_database("database_rollback.db")
+	var db := open_database(path)
+	db.query("CREATE TRIGGER reject_intruder BEFORE INSERT ON players WHEN NEW.name = 'Intruder' BEGIN SELECT RAISE(ROLLBACK, 'No intruders allowed'); END;")
+	db.close_db()
+
+	var database := open_shared_database(path)
+	var outcomes := {}
+	var errors := {}
+	for name in ["Before", "Intruder", "After"]:
+		database.queue_write("INSERT INTO players (name, level) VALUES (?, 1);", [name], func(success : bool, error_message : String) -> void:
+			outcomes[name] = success
+			errors[name] = error_message
+		)
+	database.wait_for_writes()
+	await wait_frames(2)
+
+	check_equal(outcomes.get("Intruder"), false, "The write that rolled back its transaction should fail")
+	check_equal(errors.get("Intruder"), "No intruders allowed", "The error message of the trigger should be reported")
+	check_equal(outcomes.get("After"), true, "Writes following the rollback should continue in a new transaction")
+	# Depending on the timing the first write either shares the rolled back transaction or was committed before
+	for name in ["Before", "Intruder", "After"]:
+		var rows := database.read("SELECT COUNT(*) AS count FROM players WHERE name = ?;", [name])
+		check_equal(rows[0]["count"] == 1, outcomes.get(name), "The reported outcome of '%s' should match the database" % name)
+	database.close()
+
+func test_reads_fail_once_closed() -> void:
+	var database := open_shared_database(create_players_database("database_closed.db"), 1)
+	var thread := Thread.new()
+	thread.start(func() -> int:
+		var reads := 0
+		while database.read("SELECT COUNT(*) AS count FROM players;").size() == 1:
+			reads += 1
+		return reads
+	)
+	await wait_frames(2)
+	database.close()
+	# Reads that were waiting for the only reader when the database was closed must return as well
+	thread.wait_to_finish()
+
+	check(not database.is_open(), "The database should be closed")
+	check(database.read("SELECT 1 AS one;").is_empty(), "Reading a closed database should fail")
+	check(database.snapshot_open() == null, "Taking a snapshot of a closed database should fail")
+	check(not database.queue_write("DELETE FROM players;"), "Queueing a write on a closed database should fail")
+
+func test_writes_queued_while_closing_are_reported() -> void:
+	var database := open_shared_database(create_players_database("database_closing.db"))
+	var reported := []
+	var on_written := func(success : bool, _error_message : String) -> void:
+		reported.append(success)
+	var queue_writes := func() -> int:
+		var accepted := 0
+		while database.queue_write("INSERT INTO players (name, level) VALUES ('Doomguy', 1);", [], on_written):
+			accepted += 1
+			OS.delay_msec(1)
+		return accepted
+	var thread := Thread.new()
+	thread.start(queue_writes)
+	await wait_frames(2)
+	database.close()
+	# Writes are rejected once the database starts closing, instead of ending up in a queue that is never drained again
+	var accepted : int = thread.wait_to_finish()
+	await wait_frames(2)
+
+	check(accepted > 0, "Writes should be accepted while the database is open")
+	check_equal(reported.size(), accepted, "Every accepted write should be reported")
+	check(not reported.has(false), "Every accepted write should have been committed")
+
+func snapshots_enabled() -> bool:
+	return SQLite.new().compileoption_used("ENABLE_SNAPSHOT") != 0
+
+func checkpoint(path : String) -> Dictionary:
+	var db := open_database(path)
+	db.query("PRAGMA wal_checkpoint(TRUNCATE);")
+	var result : Dictionary = db.query_result[0] if not db.query_result.is_empty() else {}
+	db.close_db()
+	return result
+
+func test_snapshots_survive_checkpoints() -> void:
+	var path := create_players_database("database_snapshot.db")
+	var database := open_shared_database(path)
+	if not snapshots_enabled():
+		check(database.snapshot_open() == null, "Snapshots should not be taken without the snapshot extension")
+		database.close()
+		return
+
+	# Snapshots can only be taken once the write-ahead log has been written to
+	database.queue_write("INSERT INTO players (name, level) VALUES ('Gordon', 1);")
+	database.wait_for_writes()
+	var snapshot := database.snapshot_open()
+	check(snapshot != null, "Taking a snapshot should succeed")
+	database.queue_write("INSERT INTO players (name, level) VALUES ('Doomguy', 1);")
+	database.wait_for_writes()
+	check_equal(checkpoint(path).get("busy"), 1, "The snapshot should keep the checkpoint from completing")
+	# Without the snapshot being pinned, this write would restart the write-ahead log
+	database.queue_write("INSERT INTO players (name, level) VALUES ('Chell', 1);")
+	database.wait_for_writes()
+
+	var rows := database.read("SELECT COUNT(*) AS count FROM players;", [], snapshot)
+	check(not rows.is_empty() and rows[0]["count"] == 11, "The snapshot should still see the rows from before the writes")
+	rows = database.read("SELECT COUNT(*) AS count FROM players;")
+	check(not rows.is_empty() and rows[0]["count"] == 13, "Reads without snapshot should see all writes")
+
+	snapshot = null
+	check_equal(checkpoint(path).get("busy"), 0, "Freeing the snapshot should allow checkpoints again")
+	database.close()
+
+func test_expired_snapshots_fail_reads() -> void:
+	var path := create_players_database("database_expired_snapshot.db")
+	var database := open_shared_database(path)
+	if not snapshots_enabled():
+		database.close()
+		return
+
+	# Snapshots of regular connections aren't pinned, so they expire once the write-ahead log restarts
+	database.queue_write("INSERT INTO players (name, level) VALUES ('Gordon', 1);")
+	database.wait_for_writes()
+	var db := open_database(path)
+	var snapshot := db.snapshot_open()
+	check(snapshot != null, "Taking a snapshot should succeed")
+	database.queue_write("INSERT INTO players (name, level) VALUES ('Doomguy', 1);")
+	database.wait_for_writes()
+	check_equal(checkpoint(path).get("busy"), 0, "Nothing should keep the checkpoint from completing")
+	database.queue_write("INSERT INTO players (name, level) VALUES ('Chell', 1);")
+	database.wait_for_writes()
+
+	var errors := []
+	database.read_failed.connect(func(_query_string : String, error_message : String) -> void:
+		errors.append(error_message)
+	)
+	check(database.read("SELECT COUNT(*) AS count FROM players;", [], snapshot).is_empty(), "Reading an expired snapshot should fail")
+	await wait_frames(2)
+	check_equal(errors.size(), 1, "The failed read should be reported")
+	check(not errors.is_empty() and "expired" in errors[0], "The error should tell that the snapshot has expired")
+	db.close_db()
+	database.close()
@@ -0,0 +1,207 @@
+extends "res://tests/test_case.gd"
+
+# Exports and imports of whole databases as JSON, binary and CSV.
+
+func create_measurements_database(db : SQLite) -> void:
+	db.query("CREATE TABLE measurements (id INTEGER PRIMARY KEY, label TEXT, value REAL, raw BLOB);")
+	db.insert_rows("measurements", [
+		{"id": 1, "label": "tenth", "value": 0.1, "raw": PackedByteArray([0, 1, 2, 255])},
+		{"id": 2, "label": "huge", "value": 1.0e300, "raw": PackedByteArray()},
+		{"id": 3, "label": "whole", "value": 3.0, "raw": null},
+		{"id": 4, "label": "quote \" and \n newline", "value": -2.5e-10, "raw": null},
+	])
+
+func test_json_export_round_trips_values() -> void:
+	var db := open_database(database_path("export_json.db"))
+	create_measurements_database(db)
+	var json_path := DATA_DIRECTORY + "export_json_backup.json"
+	check(db.export_to_json(json_path), "Exporting to JSON should succeed")
+
+	var document = JSON.parse_string(FileAccess.get_file_as_string(json_path))
+	check(document is Array, "The export should be a valid JSON document")
+
+	var other := open_database(database_path("export_json_restored.db"))
+	check(other.import_from_json(json_path), "Importing the export should succeed")
+	other.query("SELECT * FROM measurements ORDER BY id;")
+	var rows : Array = other.query_result
+	check_equal(rows.size(), 4, "All rows should be imported")
+	if rows.size() == 4:
+		check_equal(rows[0]["value"], 0.1, "Reals should survive the round-trip exactly")
+		check_equal(rows[1]["value"], 1.0e300, "Large reals should survive the round-trip")
+		check_equal(typeof(rows[2]["value"]), TYPE_FLOAT, "Whole reals should stay reals")
+		check_equal(rows[3]["label"], "quote \" and \n newline", "Strings should be escaped and unescaped")
+		check_equal(rows[0]["raw"], PackedByteArray([0, 1, 2, 255]), "Blobs should survive the round-trip")
+	db.close_db()
+	other.close_db()
+
+func test_json_export_to_missing_folder_fails() -> void:
+	var db := open_database(database_path("export_json_missing.db"))
+	create_measurements_database(db)
+	check(not db.export_to_json(DATA_DIRECTORY + "missing_folder/backup.json"), "Exporting into a folder that doesn't exist should fail")
+	db.close_db()
+
+func test_json_import_streams_all_rows() -> void:
+	var db := open_database(database_path("export_json_stream.db"))
+	db.query("CREATE TABLE numbers (value INTEGER);")
+	var rows := []
+	for i in 5000:
+		rows.append({"value": i})
+	db.insert_rows("numbers", rows)
+	db.query("CREATE INDEX numbers_value ON numbers (value);")
+	var buffer : PackedByteArray = db.export_to_buffer(true)
+	db.close_db()
+
+	var other := open_database(database_path("export_json_stream_restored.db"))
+	check(other.import_from_buffer(buffer), "Importing a large buffer should succeed")
+	check_equal(count_rows(other, "numbers"), 5000, "All rows should be imported")
+	other.query("SELECT COUNT(*) AS count FROM sqlite_master WHERE type = 'index';")
+	check_equal(other.query_result[0]["count"], 1, "Indexes should be created after the rows")
+	other.close_db()
+
+func test_failed_json_import_keeps_the_database() -> void:
+	var db := open_database(database_path("export_json_failed.db"))
+	db.query("CREATE TABLE keep (id INTEGER PRIMARY KEY);")
+	db.insert_rows("keep", [{"id": 1}, {"id": 2}])
+
+	# The second row violates the NOT NULL constraint halfway through the import
+	var document := [{
+		"name": "players",
+		"type": "table",
+		"sql": "CREATE TABLE players (id INTEGER PRIMARY KEY, name TEXT NOT NULL)",
+		"row_array": [{"id": 1, "name": "first"}, {"id": 2, "name": null}],
+	}]
+	check(not db.import_from_buffer(JSON.stringify(document).to_utf8_buffer()), "An import with an invalid row should fail")
+	check_equal(count_rows(db, "keep"), 2, "The original tables should survive a failed import")
+	db.query("SELECT name FROM sqlite_master WHERE name = 'players';")
+	check(db.query_result.is_empty(), "Nothing of the failed import should be committed")
+	check(db.get_autocommit(), "No transaction should be left open")
+
+	check(not db.import_from_buffer(PackedByteArray()), "Importing an empty buffer should fail")
+	db.close_db()
+
+func test_binary_export_round_trips_values() -> void:
+	for compressed in [false, true]:
+		var db := open_database(database_path("export_binary.db"))
+		create_measurements_database(db)
+		var buffer : PackedByteArray = db.export_to_binary(compressed)
+		db.close_db()
+		check(not buffer.is_empty(), "A binary export should not be empty")
+
+		var other := open_database(database_path("export_binary_restored.db"))
+		check(other.import_from_binary(buffer), "Importing a binary export should succeed")
+		var rows : Array = other.select_rows("measurements", "", ["label", "value", "raw"])
+		check_equal(rows.size(), 4, "All rows should be imported")
+		check_equal(rows[0]["value"], 0.1, "Reals should round-trip exactly")
+		check_equal(rows[3]["raw"], PackedByteArray([0, 1, 2, 255]), "Blobs should round-trip exactly")
+		other.close_db()
+
+func test_corrupt_binary_headers_are_rejected() -> void:
+	var db := open_database(database_path("export_binary_corrupt.db"))
+	create_measurements_database(db)
+	var buffer : PackedByteArray = db.export_to_binary(true)
+	db.query("CREATE TABLE keep (id INTEGER);")
+
+	# The compression mode is stored right after the 8 bytes of magic
+	var unknown_mode := buffer.duplicate()
+	unknown_mode[8] = 42
+	check(not db.import_from_binary(unknown_mode), "An unknown compression mode should be rejected")
+	var brotli_mode := buffer.duplicate()
+	brotli_mode[8] = FileAccess.COMPRESSION_BROTLI
+	check(not db.import_from_binary(brotli_mode), "Brotli can't be written by Godot and should be rejected")
+
+	# The payload size follows the compression mode
+	var huge_payload := buffer.duplicate()
+	huge_payload.encode_u64(9, 1 << 40)
+	check(not db.import_from_binary(huge_payload), "An absurd payload size should be rejected")
+	var wrong_payload := buffer.duplicate()
+	wrong_payload.encode_u64(9, wrong_payload.decode_u64(9) + 1)
+	check(not db.import_from_binary(wrong_payload), "A payload that doesn't decompress to its size should be rejected")
+
+	check(not db.import_from_binary(buffer.slice(0, 12)), "A truncated header should be rejected")
+	check(not db.import_from_binary(buffer.slice(0, 17)), "A header without payload should be rejected")
+	check(not db.import_from_binary(PackedByteArray()), "An empty buffer should be rejected")
+	check_equal(count_rows(db, "keep"), 0, "Failed imports should leave the database untouched")
+	check_equal(count_rows(db, "measurements"), 4, "Failed imports should leave the database untouched")
+	db.close_db()
+
+func create_tables_database(db : SQLite, table_count : int) -> void:
+	for t in table_count:
+		var table_name := "table_%d" % t
+		db.query("CREATE TABLE %s (id INTEGER PRIMARY KEY, value TEXT);" % table_name)
+		var rows := []
+		for i in 200:
+			rows.append({"id": i, "value": "%s_%d" % [table_name, i]})
+		db.insert_rows(table_name, rows)
+
+func test_parallel_export_matches_serial_export() -> void:
+	var db := open_database(database_path("export_parallel.db"))
+	create_tables_database(db, 6)
+	var serial_json : PackedByteArray = db.export_to_buffer(true)
+	var serial_binary : PackedByteArray = db.export_to_binary(false)
+
+	db.export_thread_count = 4
+	check_equal(db.export_thread_count, 4, "The thread count should be stored")
+	check_equal(db.export_to_buffer(true), serial_json, "A parallel JSON export should equal the serial one")
+	check_equal(db.export_to_binary(false), serial_binary, "A parallel binary export should equal the serial one")
+
+	var other := open_database(database_path("export_parallel_restored.db"))
+	check(other.import_from_buffer(db.export_to_buffer(true)), "A parallel export should be importable")
+	check_equal(count_rows(other, "table_5"), 200, "Every table should be exported completely")
+	other.close_db()
+	db.close_db()
+
+func test_parallel_export_falls_back_to_a_single_thread() -> void:
+	var db := open_database(database_path("export_parallel_fallback.db"))
+	create_tables_database(db, 3)
+	db.export_thread_count = 0
+	check_equal(db.export_thread_count, 1, "The thread count should be at least 1")
+
+	# Uncommitted rows are only visible on this connection, so the export can't use any others
+	db.export_thread_count = 4
+	db.query("BEGIN;")
+	db.insert_row("table_0", {"id": 1000, "value": "uncommitted"})
+	var buffer : PackedByteArray = db.export_to_buffer(true)
+	db.query("ROLLBACK;")
+	check(buffer.get_string_from_utf8().contains("uncommitted"), "An export inside a transaction should include its changes")
+
+	var memory := open_database(":memory:")
+	create_tables_database(memory, 3)
+	memory.export_thread_count = 4
+	check(not memory.export_to_buffer(true).is_empty(), "In-memory databases should be exported on a single thread")
+	memory.close_db()
+	db.close_db()
+
+func test_json_export_detects_blobs_in_any_row() -> void:
+	var db := open_database(database_path("export_mixed_types.db"))
+	db.query("CREATE TABLE mixed (id INTEGER PRIMARY KEY, payload);")
+	db.insert_rows("mixed", [
+		{"id": 1, "payload": 3.5},
+		{"id": 2, "payload": null},
+		{"id": 3, "payload": PackedByteArray([7, 8, 9])},
+		{"id": 4, "payload": 42},
+	])
+	var buffer : PackedByteArray = db.export_to_buffer(true)
+	db.close_db()
+
+	var other := open_database(database_path("export_mixed_types_restored.db"))
+	check(other.import_from_buffer(buffer), "Importing mixed types should succeed")
+	var rows : Array = other.select_rows("mixed", "", ["payload"])
+	check_equal(rows[0]["payload"], 3.5, "Reals before a blob should stay reals")
+	check_equal(rows[1]["payload"], null, "NULLs should stay NULL")
+	check_equal(rows[2]["payload"], PackedByteArray([7, 8, 9]), "A blob after the first row should be detected")
+	check_equal(rows[3]["payload"], 42, "Integers should stay integers")
+	other.close_db()
+
+func test_json_import_rejects_invalid_base64_columns() -> void:
+	var db := open_database(database_path("export_invalid_base64.db"))
+	var document := [{
+		"name": "blobs",
+		"type": "table",
+		"sql": "CREATE TABLE blobs (data BLOB)",
+		"base64_columns": "data",
+		"row_array": [{"data": "AAEC"}],
+	}]
+	check(not db.import_from_buffer(JSON.stringify(document).to_utf8_buffer()), "base64_columns that isn't an array should be rejected")
+	db.query("SELECT name FROM sqlite_master WHERE name = 'blobs';")
+	check(db.query_result.is_empty(), "Nothing of the rejected import should be created")
+	db.close_db()
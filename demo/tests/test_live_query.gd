@@ -0,0 +1,51 @@
+extends "res://tests/test_case.gd"
+
+func open_guild_database(file_name : String) -> SQLite:
+	var db := open_database(database_path(file_name))
+	db.query("CREATE TABLE players (id INTEGER PRIMARY KEY, name TEXT, guild_id INTEGER);")
+	db.query("CREATE TABLE guilds (id INTEGER PRIMARY KEY, name TEXT);")
+	db.insert_row("guilds", {"id": 1, "name": "red"})
+	db.insert_row("players", {"id": 1, "name": "first", "guild_id": 1})
+	return db
+
+func test_live_query_runs_once_per_batch() -> void:
+	var db := open_guild_database("live_query_batch.db")
+	var live_query : SQLiteLiveQuery = db.watch_query("SELECT players.name AS player, guilds.name AS guild FROM players JOIN guilds ON guilds.id = players.guild_id ORDER BY players.id;")
+	check_equal(Array(live_query.get_tables()).size(), 2, "Both tables should be watched")
+	check_equal(live_query.get_result(), [{"player": "first", "guild": "red"}], "The initial result should be available")
+
+	var results := []
+	live_query.result_changed.connect(func(result): results.append(result))
+	db.query("BEGIN;")
+	db.insert_row("players", {"id": 2, "name": "second", "guild_id": 1})
+	db.update_rows("guilds", "id = 1", {"name": "blue"})
+	db.query("COMMIT;")
+	db.flush_changes()
+	db.query("SELECT 42 AS answer;")
+	await wait_frames(2)
+	check_equal(results.size(), 1, "Changes to several tables should re-run the query only once")
+	check_equal(results[-1], [{"player": "first", "guild": "blue"}, {"player": "second", "guild": "blue"}], "The new result should be delivered")
+	check_equal(db.query_result, [{"answer": 42}], "The query_result of the database should be left alone")
+
+	db.update_rows("players", "id = 2", {"guild_id": 2})
+	await wait_frames(2)
+	check_equal(results.size(), 2, "Every batch should re-run the query")
+	db.insert_row("guilds", {"id": 3, "name": "unused"})
+	await wait_frames(2)
+	check_equal(results.size(), 2, "Unchanged results should not be emitted")
+	db.close_db()
+
+func test_unconnected_live_queries_run_lazily() -> void:
+	var db := open_guild_database("live_query_lazy.db")
+	var live_query : SQLiteLiveQuery = db.watch_query("SELECT COUNT(*) AS count FROM players WHERE guild_id = ?;", [1])
+	check_equal(live_query.get_result(), [{"count": 1}], "Bindings should be applied")
+	check(not live_query.is_dirty(), "The result should be up-to-date")
+	db.insert_row("players", {"id": 2, "name": "second", "guild_id": 1})
+	await wait_frames(2)
+	check(live_query.is_dirty(), "Changes should only mark the result as outdated")
+	check_equal(live_query.get_result(), [{"count": 2}], "The result should be refreshed on request")
+
+	check(db.watch_query("DELETE FROM players;") == null, "Queries that write can't be watched")
+	check(db.watch_query("SELECT * FROM missing_table;") == null, "Invalid queries can't be watched")
+	db.close_db()
+	check_equal(live_query.get_result(), [{"count": 2}], "Live queries should keep their last result once the database is closed")
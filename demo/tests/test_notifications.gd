@@ -0,0 +1,187 @@
+extends "res://tests/test_case.gd"
+
+func open_notifying_database(file_name : String, mode : int) -> SQLite:
+	var db := open_database(database_path(file_name), func(connection): connection.change_notifications = mode)
+	db.query("CREATE TABLE items (id INTEGER PRIMARY KEY, name TEXT);")
+	db.query("CREATE TABLE other (id INTEGER PRIMARY KEY);")
+	return db
+
+func test_batched_notifications_are_emitted_once_per_table() -> void:
+	var db := open_notifying_database("notifications_batched.db", SQLite.CHANGE_NOTIFICATIONS_BATCHED)
+	var batches := []
+	db.changes_committed.connect(func(table_name, inserted, updated, deleted): batches.append([table_name, inserted, updated, deleted]))
+
+	db.query("BEGIN;")
+	db.insert_rows("items", [{"id": 1}, {"id": 2}, {"id": 3}])
+	db.update_rows("items", "id = 2", {"name": "second"})
+	db.delete_rows("items", "id = 3")
+	check(batches.is_empty(), "Nothing should be reported before the commit")
+	db.query("COMMIT;")
+	check(batches.is_empty(), "Changes should be reported on the next frame, not from the commit hook")
+	await wait_frames(2)
+	check_equal(batches.size(), 1, "A single batch should be emitted for the table")
+	check_equal(batches[0], ["items", PackedInt64Array([1, 2, 3]), PackedInt64Array([2]), PackedInt64Array([3])], "The batch should contain all changes")
+
+	batches.clear()
+	db.insert_row("items", {"id": 4})
+	db.insert_row("other", {"id": 1})
+	db.flush_changes()
+	check_equal(batches.size(), 2, "flush_changes() should deliver one batch per table right away")
+	await wait_frames(2)
+	check_equal(batches.size(), 2, "Flushed changes should not be delivered twice")
+	db.close_db()
+
+func test_rolled_back_changes_are_not_reported() -> void:
+	var db := open_notifying_database("notifications_rollback.db", SQLite.CHANGE_NOTIFICATIONS_BATCHED)
+	var batches := []
+	db.changes_committed.connect(func(table_name, inserted, updated, deleted): batches.append(table_name))
+	db.query("BEGIN;")
+	db.insert_row("items", {"id": 1})
+	db.query("ROLLBACK;")
+	db.flush_changes()
+	await wait_frames(2)
+	check(batches.is_empty(), "Rolled back changes should not be reported")
+	db.close_db()
+
+func test_row_notifications_and_disabled_notifications() -> void:
+	var db := open_notifying_database("notifications_row.db", SQLite.CHANGE_NOTIFICATIONS_ROW)
+	var rows := []
+	db.row_inserted.connect(func(table_name, rowid): rows.append(["insert", table_name, rowid]))
+	db.row_updated.connect(func(table_name, rowid): rows.append(["update", table_name, rowid]))
+	db.row_deleted.connect(func(table_name, rowid): rows.append(["delete", table_name, rowid]))
+	db.insert_row("items", {"id": 1})
+	db.update_rows("items", "id = 1", {"name": "first"})
+	db.delete_rows("items", "id = 1")
+	check_equal(rows, [["insert", "items", 1], ["update", "items", 1], ["delete", "items", 1]], "Every row change should be emitted")
+	db.close_db()
+
+	var silent := open_notifying_database("notifications_none.db", SQLite.CHANGE_NOTIFICATIONS_NONE)
+	var emitted := []
+	silent.row_inserted.connect(func(table_name, rowid): emitted.append(rowid))
+	silent.changes_committed.connect(func(table_name, inserted, updated, deleted): emitted.append(table_name))
+	silent.insert_row("items", {"id": 1})
+	silent.flush_changes()
+	await wait_frames(2)
+	check(emitted.is_empty(), "Nothing should be emitted without change notifications")
+	silent.close_db()
+
+func test_subscriptions_are_filtered_by_kind() -> void:
+	var db := open_notifying_database("notifications_subscriptions.db", SQLite.CHANGE_NOTIFICATIONS_NONE)
+	var inserts := []
+	var everything := []
+	var on_insert := func(table_name, inserted, updated, deleted): inserts.append([inserted, updated, deleted])
+	var on_anything := func(table_name, inserted, updated, deleted): everything.append([inserted, updated, deleted])
+	check(db.subscribe_changes("items", on_insert, SQLite.CHANGE_INSERT), "Subscribing to inserts should succeed")
+	check(db.subscribe_changes("items", on_anything), "Subscribing to all changes should succeed")
+
+	db.insert_row("items", {"id": 1})
+	db.update_rows("items", "id = 1", {"name": "first"})
+	db.insert_row("other", {"id": 1})
+	db.flush_changes()
+	check_equal(inserts, [[PackedInt64Array([1]), PackedInt64Array(), PackedInt64Array()]], "Only inserts should be delivered")
+	check_equal(everything, [[PackedInt64Array([1]), PackedInt64Array([1]), PackedInt64Array()]], "All changes of the table should be delivered in one batch")
+
+	# Subscribing again replaces the kinds
+	inserts.clear()
+	check(db.subscribe_changes("items", on_insert, SQLite.CHANGE_DELETE), "Changing the kinds should succeed")
+	db.update_rows("items", "id = 1", {"name": "renamed"})
+	db.delete_rows("items", "id = 1")
+	db.flush_changes()
+	check_equal(inserts, [[PackedInt64Array(), PackedInt64Array(), PackedInt64Array([1])]], "The new kinds should apply")
+
+	inserts.clear()
+	check(db.unsubscribe_changes("items", on_insert), "Unsubscribing should succeed")
+	db.insert_row("items", {"id": 2})
+	db.flush_changes()
+	check(inserts.is_empty(), "Unsubscribed callables should not be called")
+
+	check(not db.subscribe_changes("items", on_insert, 0), "Subscribing without kinds should fail")
+	check(not db.subscribe_changes("items", Callable()), "Subscribing an invalid callable should fail")
+	check(not db.unsubscribe_changes("other", on_insert), "Unsubscribing a callable that never subscribed should fail")
+	db.close_db()
+
+func test_value_notifications_include_full_rows() -> void:
+	var db := open_notifying_database("notifications_values.db", SQLite.CHANGE_NOTIFICATIONS_NONE)
+	if db.compileoption_used("ENABLE_PREUPDATE_HOOK") == 0:
+		db.change_notifications = SQLite.CHANGE_NOTIFICATIONS_VALUES
+		check_equal(db.change_notifications, SQLite.CHANGE_NOTIFICATIONS_NONE, "VALUES requires the pre-update hook")
+		db.close_db()
+		return
+	db.change_notifications = SQLite.CHANGE_NOTIFICATIONS_VALUES
+	var transactions := []
+	db.transaction_committed.connect(func(changes): transactions.append(changes))
+
+	db.query("BEGIN;")
+	db.insert_row("items", {"id": 1, "name": "first"})
+	db.update_rows("items", "id = 1", {"name": "renamed"})
+	db.delete_rows("items", "id = 1")
+	db.query("COMMIT;")
+	db.query("BEGIN;")
+	db.insert_row("items", {"id": 2, "name": "discarded"})
+	db.query("ROLLBACK;")
+	db.flush_changes()
+
+	check_equal(transactions.size(), 1, "Only the committed transaction should be reported")
+	var changes : Array = transactions[0]
+	check_equal(changes.size(), 3, "Every change of the transaction should be reported")
+	check_equal(changes[0]["kind"], SQLite.CHANGE_INSERT, "The first change should be the insert")
+	check_equal(changes[0]["new_values"], [1, "first"], "Inserts should carry the new values")
+	check_equal(changes[0]["old_values"], [], "Inserts have no old values")
+	check_equal(changes[1]["old_values"], [1, "first"], "Updates should carry the old values")
+	check_equal(changes[1]["new_values"], [1, "renamed"], "Updates should carry the new values")
+	check_equal(changes[2]["kind"], SQLite.CHANGE_DELETE, "The last change should be the delete")
+	check_equal(changes[2]["new_values"], [], "Deletes have no new values")
+	check_equal(changes[2]["table"], "items", "The table should be reported")
+
+	check(db.create_session() == null, "Sessions can't be created while values are reported")
+	db.close_db()
+
+func test_changes_rolled_back_to_a_savepoint_are_not_reported() -> void:
+	var db := open_notifying_database("notifications_savepoints.db", SQLite.CHANGE_NOTIFICATIONS_BATCHED)
+	var batches := []
+	db.changes_committed.connect(func(table_name, inserted, updated, deleted): batches.append([table_name, inserted]))
+	var subscribed := []
+	db.subscribe_changes("items", func(table_name, inserted, updated, deleted): subscribed.append(inserted))
+
+	db.begin()
+	db.insert_row("items", {"id": 1})
+	db.savepoint("nested")
+	db.insert_row("items", {"id": 2})
+	db.insert_row("other", {"id": 1})
+	check(db.rollback_to("nested"), "Rolling back to the savepoint should succeed")
+	db.release("nested")
+	db.commit()
+	db.flush_changes()
+	check_equal(batches, [["items", PackedInt64Array([1])]], "Only the change before the savepoint should be reported")
+	check_equal(subscribed, [PackedInt64Array([1])], "Subscribers should not receive rolled back changes")
+
+	# Rolling back the outermost savepoint and releasing it commits an empty transaction
+	batches.clear()
+	subscribed.clear()
+	db.savepoint("outer")
+	db.insert_row("items", {"id": 3})
+	db.rollback_to("outer")
+	db.release("outer")
+	db.flush_changes()
+	check(batches.is_empty() and subscribed.is_empty(), "Changes of a rolled back outermost savepoint should not be reported")
+
+	# A failing helper inside of a transaction only undoes its own changes
+	db.begin()
+	db.insert_row("items", {"id": 4})
+	check(not db.insert_rows("items", [{"id": 5}, {"id": 4}]), "Inserting a duplicate should fail")
+	db.commit()
+	db.flush_changes()
+	check_equal(subscribed, [PackedInt64Array([4])], "Changes of a failed helper should not be reported")
+
+	# A failing CSV import rolls back its own savepoint
+	subscribed.clear()
+	var path := DATA_DIRECTORY + "notifications_savepoints.csv"
+	var file := FileAccess.open(path, FileAccess.WRITE)
+	file.store_string("id\n10\n11\n4\n")
+	file.close()
+	check(not db.import_csv("items", path), "Importing a duplicate should fail")
+	db.flush_changes()
+	check(subscribed.is_empty(), "Changes of a failed CSV import should not be reported")
+
+	check(not db.rollback_to("missing"), "Rolling back to an unknown savepoint should fail")
+	db.close_db()
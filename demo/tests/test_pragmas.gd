@@ -0,0 +1,53 @@
+extends "res://tests/test_case.gd"
+
+func test_presets_and_pragmas_are_applied() -> void:
+	var configure := func(connection):
+		connection.pragma_preset = "fast_local"
+		connection.pragmas = {"synchronous": "FULL", "cache_size": -4096, "foreign_keys": true}
+	var db := open_database(database_path("pragmas_applied.db"), configure)
+	var effective : Dictionary = db.get_effective_pragmas()
+	check_equal(str(effective["journal_mode"]).to_lower(), "wal", "The preset should switch to WAL")
+	check_equal(effective["synchronous"], 2, "Explicit pragmas should take precedence over the preset")
+	check_equal(effective["cache_size"], -4096, "Integer pragmas should be applied")
+	check_equal(effective["foreign_keys"], 1, "Boolean pragmas should be applied")
+	check_equal(effective["busy_timeout"], 5000, "Pragmas of the preset should be applied")
+	db.query("PRAGMA synchronous;")
+	check_equal(db.query_result[0]["synchronous"], 2, "The connection should use the effective value")
+	db.close_db()
+
+func test_invalid_pragmas_are_rejected_before_opening() -> void:
+	var invalid_configurations := [
+		{"pragma_preset": "missing_preset"},
+		{"pragmas": {"unknown_pragma": 1}},
+		{"pragmas": {"page_size": 1000}},
+		{"pragmas": {"journal_mode": "SIDEWAYS"}},
+		{"pragmas": {"cache_spill": "yes"}},
+		{"pragmas": {"busy_timeout": -1}},
+	]
+	for configuration in invalid_configurations:
+		var path := database_path("pragmas_invalid.db")
+		var db := SQLite.new()
+		db.path = path
+		db.default_extension = ""
+		db.verbosity_level = SQLite.QUIET
+		for key in configuration:
+			db.set(key, configuration[key])
+		check(not db.open_db(), "Opening with %s should fail" % [configuration])
+		check(not FileAccess.file_exists(path), "The database should not be created when %s is rejected" % [configuration])
+
+func test_pragmas_that_write_are_rejected_for_read_only_connections() -> void:
+	var path := create_players_database("pragmas_read_only.db")
+	var db := SQLite.new()
+	db.path = path
+	db.default_extension = ""
+	db.verbosity_level = SQLite.QUIET
+	db.read_only = true
+	db.pragmas = {"journal_mode": "WAL"}
+	check(not db.open_db(), "journal_mode can't be changed on a read-only connection")
+
+	db.pragmas = {}
+	db.pragma_preset = "read_only_content"
+	check(db.open_db(), "The read_only_content preset should apply to read-only connections")
+	check_equal(db.get_effective_pragmas()["query_only"], 1, "query_only should be enabled")
+	check_equal(count_rows(db, "players"), 10, "The database should be readable")
+	db.close_db()
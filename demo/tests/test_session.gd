@@ -0,0 +1,59 @@
+extends "res://tests/test_case.gd"
+
+func sessions_enabled(db : SQLite) -> bool:
+	return db.compileoption_used("ENABLE_SESSION") != 0
+
+func test_changesets_replicate_changes() -> void:
+	var source := open_database(database_path("session_source.db"))
+	if not sessions_enabled(source):
+		check(source.create_session() == null, "Sessions should not be created without the session extension")
+		source.close_db()
+		return
+	source.query("CREATE TABLE items (id INTEGER PRIMARY KEY, name TEXT);")
+	source.insert_rows("items", [{"id": 1, "name": "first"}, {"id": 2, "name": "second"}])
+
+	var target := open_database(database_path("session_target.db"))
+	target.query("CREATE TABLE items (id INTEGER PRIMARY KEY, name TEXT);")
+	target.insert_rows("items", [{"id": 1, "name": "first"}, {"id": 2, "name": "second"}])
+
+	var session : SQLiteSession = source.create_session()
+	check(session.attach("items"), "Attaching an existing table should succeed")
+	check(session.is_empty(), "A new session should be empty")
+	source.update_rows("items", "id = 1", {"name": "renamed"})
+	source.delete_rows("items", "id = 2")
+	source.insert_row("items", {"id": 3, "name": "third"})
+	check(not session.is_empty(), "The session should record changes")
+
+	var target_session : SQLiteSession = target.create_session()
+	check(target_session.apply_changeset(session.changeset()), "Applying the changeset should succeed")
+	var rows : Array = target.select_rows("items", "", ["id", "name"])
+	check_equal(rows, [{"id": 1, "name": "renamed"}, {"id": 3, "name": "third"}], "The target should mirror the source")
+	check(target_session.is_empty(), "Applied changes should not be recorded again")
+	check(not session.patchset().is_empty(), "Patchsets should contain the same changes")
+
+	source.close_db()
+	target.close_db()
+
+func test_conflicting_changesets_are_aborted() -> void:
+	var source := open_database(database_path("session_conflict_source.db"))
+	if not sessions_enabled(source):
+		source.close_db()
+		return
+	source.query("CREATE TABLE items (id INTEGER PRIMARY KEY, name TEXT);")
+	var session : SQLiteSession = source.create_session()
+	session.attach()
+	source.insert_row("items", {"id": 1, "name": "source"})
+
+	var target := open_database(database_path("session_conflict_target.db"))
+	target.query("CREATE TABLE items (id INTEGER PRIMARY KEY, name TEXT);")
+	target.insert_rows("items", [{"id": 1, "name": "target"}, {"id": 2, "name": "other"}])
+	var target_session : SQLiteSession = target.create_session()
+	check(not target_session.apply_changeset(session.changeset(), SQLiteSession.CONFLICT_ABORT), "Aborting on a conflict should fail")
+	check_equal(target.select_rows("items", "id = 1", ["name"])[0]["name"], "target", "An aborted changeset should change nothing")
+	check(target_session.apply_changeset(session.changeset(), SQLiteSession.CONFLICT_REPLACE), "Replacing on a conflict should succeed")
+	check_equal(target.select_rows("items", "id = 1", ["name"])[0]["name"], "source", "The conflicting row should be replaced")
+	check(not target_session.apply_changeset(PackedByteArray([1, 2, 3])), "A corrupt changeset should be rejected")
+
+	target.close_db()
+	check(not target_session.attach("items"), "A session should become invalid once its connection is closed")
+	source.close_db()
@@ -0,0 +1,98 @@
+extends "res://tests/test_case.gd"
+
+func open_threaded_database(file_name : String, threading_mode : int) -> SQLite:
+	var path := create_players_database(file_name)
+	return open_database(path, func(connection : SQLite) -> void:
+		connection.threading_mode = threading_mode
+	)
+
+# Runs the callable on a thread of its own and returns its result.
+func run_on_thread(callable : Callable) -> Variant:
+	var thread := Thread.new()
+	thread.start(callable)
+	return thread.wait_to_finish()
+
+func test_autocommit_is_reported_per_thread_connection() -> void:
+	var db := open_threaded_database("threading_autocommit.db", SQLite.THREADING_MODE_MULTI_THREAD)
+	var began : bool = run_on_thread(func() -> bool:
+		return db.query("BEGIN;")
+	)
+	check(began, "Beginning a transaction on the connection of the thread should succeed")
+
+	var thread_autocommit : int = run_on_thread(func() -> int:
+		return db.get_autocommit()
+	)
+	check_equal(thread_autocommit, 0, "The thread should see its own open transaction")
+	check(db.get_autocommit() != 0, "The main connection shouldn't be affected by the transaction of the thread")
+
+	var rolled_back : bool = run_on_thread(func() -> bool:
+		return db.query("ROLLBACK;")
+	)
+	check(rolled_back, "Rolling back the transaction of the thread should succeed")
+	db.close_db()
+
+func test_thread_connections_run_in_parallel() -> void:
+	var configure := func(connection : SQLite) -> void:
+		connection.threading_mode = SQLite.THREADING_MODE_MULTI_THREAD
+		connection.pragmas = {"busy_timeout": 5000}
+	var db := open_database(create_players_database("threading_parallel.db"), configure)
+	var locked := Semaphore.new()
+	var hold_lock := func() -> bool:
+		if not db.query("BEGIN IMMEDIATE;"):
+			locked.post()
+			return false
+		locked.post()
+		# Commit while the other thread is still waiting for the lock inside of its call
+		OS.delay_msec(200)
+		return db.query("COMMIT;")
+	var holder := Thread.new()
+	holder.start(hold_lock)
+	locked.wait()
+
+	var inserted : bool = run_on_thread(func() -> bool:
+		return db.query("INSERT INTO players (name, level) VALUES ('Doomguy', 1);")
+	)
+	check(holder.wait_to_finish(), "Committing while another thread waits for the lock should succeed")
+	check(inserted, "The insert should wait for the transaction of the other thread instead of blocking its commit")
+	check(db.query("SELECT COUNT(*) AS count FROM players;"), "Counting the rows should succeed")
+	check_equal(db.query_result[0]["count"], 11, "The insert of the waiting thread should have been applied")
+	db.close_db()
+
+func test_getters_are_safe_to_call_from_other_threads() -> void:
+	var db := open_threaded_database("threading_getters.db", SQLite.THREADING_MODE_SERIALIZED)
+	var threads : Array[Thread] = []
+	for i in 4:
+		var thread := Thread.new()
+		thread.start(func() -> int:
+			var failures := 0
+			for j in 50:
+				if not db.query_with_bindings("UPDATE players SET level = level + 1 WHERE id = ?;", [i + 1]):
+					failures += 1
+				if db.get_autocommit() == 0:
+					failures += 1
+				# Writable connections don't go through the godot VFS, so there are no counters to report
+				if not db.get_io_stats().is_empty():
+					failures += 1
+			return failures
+		)
+		threads.append(thread)
+
+	for j in 50:
+		db.get_autocommit()
+		db.get_io_stats()
+		db.get_effective_pragmas()
+	for thread in threads:
+		check_equal(thread.wait_to_finish(), 0, "Every call of the thread should see a consistent connection")
+
+	check(db.query("SELECT SUM(level) AS total FROM players WHERE id <= 4;"), "Reading the updated rows should succeed")
+	check_equal(db.query_result[0]["total"], 0 + 1 + 2 + 3 + 4 * 50, "Every update of the threads should have been applied")
+	db.close_db()
+
+func test_threading_mode_cant_change_while_open() -> void:
+	var db := open_threaded_database("threading_mode.db", SQLite.THREADING_MODE_SERIALIZED)
+	db.threading_mode = SQLite.THREADING_MODE_SINGLE_THREAD
+	check_equal(db.threading_mode, SQLite.THREADING_MODE_SERIALIZED, "The threading mode of an open connection shouldn't change")
+	db.close_db()
+
+	db.threading_mode = SQLite.THREADING_MODE_MULTI_THREAD
+	check_equal(db.threading_mode, SQLite.THREADING_MODE_MULTI_THREAD, "The threading mode of a closed connection should change")
@@ -0,0 +1,141 @@
+extends "res://tests/test_case.gd"
+
+# Read-only connections go through the godot VFS, which implements locking,
+# write buffering, I/O statistics and prefetching on top of FileAccess.
+
+func open_read_only(path : String, configure : Callable = Callable()) -> SQLite:
+	return open_database(path, func(db : SQLite):
+		db.read_only = true
+		if configure.is_valid():
+			configure.call(db)
+	)
+
+func test_connections_share_the_file_lock() -> void:
+	var path := create_players_database("vfs_locking.db")
+	var first := open_read_only(path)
+	var second := open_read_only(path)
+
+	# Both connections hold a SHARED lock on the same lock entry at once
+	first.query("BEGIN;")
+	check_equal(count_rows(first, "players"), 10, "The first reader should start reading")
+	check_equal(count_rows(second, "players"), 10, "The second reader shouldn't be blocked by the first")
+	first.query("COMMIT;")
+
+	first.close_db()
+	check_equal(count_rows(second, "players"), 10, "Closing one handle shouldn't release the lock entry of the other")
+	second.close_db()
+
+func test_missing_file_can_not_be_opened() -> void:
+	var db := SQLite.new()
+	db.path = database_path("vfs_missing.db")
+	db.default_extension = ""
+	db.read_only = true
+	db.verbosity_level = SQLite.QUIET
+	check(not db.open_db(), "Opening a file that doesn't exist in read-only mode should fail")
+
+# The write-back buffer only comes into play for files that can't be accessed
+# natively, such as `res://` in exported projects. Here the buffered read path
+# is exercised by reading back a database that spans many write buffers.
+func test_large_database_reads_back_intact() -> void:
+	var path := database_path("vfs_large.db")
+	var db := open_database(path)
+	db.query("CREATE TABLE blobs (id INTEGER PRIMARY KEY, data BLOB NOT NULL);")
+	var blob := PackedByteArray()
+	blob.resize(100000)
+	for i in blob.size():
+		blob[i] = i % 251
+	db.begin()
+	for i in 40:
+		db.insert_row("blobs", {"id": i, "data": blob})
+	db.commit()
+	db.close_db()
+
+	var reader := open_read_only(path)
+	reader.query("SELECT data FROM blobs WHERE id = 39;")
+	check(not reader.query_result.is_empty() and reader.query_result[0]["data"] == blob, "The last blob should read back byte for byte")
+	check_equal(count_rows(reader, "blobs"), 40, "All rows should be readable")
+	reader.close_db()
+
+func test_file_that_is_not_a_database_is_rejected() -> void:
+	var path := database_path("vfs_garbage.db")
+	var file := FileAccess.open(path, FileAccess.WRITE)
+	file.store_string("This is not a database file, but it is long enough to contain a header of one.".repeat(10))
+	file.close()
+
+	var db := SQLite.new()
+	db.path = path
+	db.default_extension = ""
+	db.read_only = true
+	db.verbosity_level = SQLite.QUIET
+	db.open_db()
+	check(not db.query("SELECT * FROM sqlite_schema;"), "Querying a file that isn't a database should fail")
+	db.close_db()
+
+func test_compressed_database_is_read_transparently() -> void:
+	var source_path := create_players_database("vfs_uncompressed.db", 500)
+	var compressed_path := database_path("vfs_compressed.cdb")
+	check(SQLite.compress_database(source_path, compressed_path, 4096), "Compressing the database should succeed")
+	check(FileAccess.get_size(compressed_path) < FileAccess.get_size(source_path), "The compressed database should be smaller")
+
+	var db := open_read_only(compressed_path)
+	check_equal(count_rows(db, "players"), 500, "All rows should be readable from the compressed database")
+	db.query("SELECT name FROM players WHERE id = 250;")
+	check(not db.query_result.is_empty() and db.query_result[0]["name"] == "player_250", "Rows in the middle of the file should decompress correctly")
+	db.close_db()
+
+func test_compressing_with_invalid_arguments_fails() -> void:
+	var source_path := create_players_database("vfs_compress_source.db")
+	check(not SQLite.compress_database(source_path, database_path("vfs_invalid_block.cdb"), 0), "A block size of zero should be rejected")
+	check(not SQLite.compress_database(database_path("vfs_no_source.db"), database_path("vfs_no_source.cdb")), "A missing source should be rejected")
+
+func test_io_stats_count_reads() -> void:
+	var path := create_players_database("vfs_io_stats.db", 200)
+	var db := open_read_only(path)
+	count_rows(db, "players")
+	var io_stats : Dictionary = db.get_io_stats()
+	check(io_stats.has("main"), "Read-only connections should report the counters of the database file")
+	if io_stats.has("main"):
+		check(io_stats["main"]["reads"] > 0, "Reads should be counted")
+		check(io_stats["main"]["bytes_read"] > 0, "Bytes read should be counted")
+		check_equal(io_stats["main"]["writes"], 0, "A read-only connection shouldn't write")
+
+	db.reset_io_stats()
+	check_equal(db.get_io_stats()["main"]["reads"], 0, "Resetting should zero the counters")
+	db.close_db()
+
+func test_io_stats_of_other_files_are_empty() -> void:
+	var db := open_database(database_path("vfs_native.db"))
+	check(db.get_io_stats().is_empty(), "Connections that don't use the godot VFS have no counters")
+	db.close_db()
+
+	# In-memory journals don't implement xFileControl() at all
+	db = open_database(":memory:")
+	db.query("PRAGMA journal_mode=MEMORY;")
+	db.query("CREATE TABLE numbers (value INTEGER);")
+	db.begin()
+	db.query("INSERT INTO numbers VALUES (1);")
+	check(db.get_io_stats().is_empty(), "Asking for counters during an in-memory journal should be harmless")
+	db.commit()
+	db.close_db()
+
+func test_prefetched_pages_serve_reads() -> void:
+	var path := create_players_database("vfs_prefetch.db", 2000)
+	var db := open_read_only(path, func(db : SQLite): db.prefetch = true)
+	check(db.prefetch_pages(1, 64), "Prefetching pages of a read-only database should succeed")
+	# Give the background thread a moment to read the requested pages
+	OS.delay_msec(100)
+	db.reset_io_stats()
+	check_equal(count_rows(db, "players"), 2000, "Reads should return the same data with prefetching enabled")
+	check(db.get_io_stats()["main"]["prefetch_hits"] > 0, "Reads of prefetched pages should be served by the prefetcher")
+	db.close_db()
+
+func test_prefetching_requires_a_read_only_database() -> void:
+	var path := create_players_database("vfs_prefetch_writable.db")
+	var db := open_database(path, func(db : SQLite): db.prefetch = true)
+	check(not db.prefetch_pages(1, 8), "Prefetching should be refused for writable databases")
+	check_equal(count_rows(db, "players"), 10, "The connection should remain usable")
+	db.close_db()
+
+	db = open_read_only(path)
+	check(not db.prefetch_pages(1, 8), "Prefetching should be refused when the prefetch property isn't enabled")
+	db.close_db()
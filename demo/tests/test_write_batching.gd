@@ -0,0 +1,54 @@
+extends "res://tests/test_case.gd"
+
+# Opens a batching connection and a plain second connection to the same file,
+# which only sees the batched writes once they have been committed.
+func open_batching_databases(file_name : String) -> Array:
+	var path := database_path(file_name)
+	var db := open_database(path, func(connection): connection.write_batching = true)
+	db.query("CREATE TABLE items (id INTEGER PRIMARY KEY);")
+	var observer := open_database(path)
+	return [db, observer]
+
+func test_writes_are_committed_once_per_frame() -> void:
+	var databases := open_batching_databases("write_batching_frame.db")
+	var db : SQLite = databases[0]
+	var observer : SQLite = databases[1]
+	var commits := []
+	db.write_batch_committed.connect(func(success, statement_count): commits.append([success, statement_count]))
+
+	for i in 10:
+		db.insert_row("items", {"id": i})
+	check_equal(count_rows(db, "items"), 10, "Plain queries should see the open batch")
+	check_equal(count_rows(observer, "items"), 0, "Plain queries should not commit the batch")
+	await wait_frames(2)
+	check_equal(commits, [[true, 10]], "The batch should be committed once on the next frame")
+	check_equal(count_rows(observer, "items"), 10, "Committed writes should be visible to other connections")
+	db.close_db()
+	observer.close_db()
+
+func test_pragmas_and_attach_commit_the_batch() -> void:
+	var databases := open_batching_databases("write_batching_statements.db")
+	var db : SQLite = databases[0]
+	var observer : SQLite = databases[1]
+
+	db.insert_row("items", {"id": 1})
+	db.query("PRAGMA table_info(items);")
+	check_equal(count_rows(observer, "items"), 1, "A read-only PRAGMA should commit the batch first")
+
+	db.insert_row("items", {"id": 2})
+	db.query("EXPLAIN SELECT * FROM items;")
+	check_equal(count_rows(observer, "items"), 2, "EXPLAIN should commit the batch first")
+
+	db.insert_row("items", {"id": 3})
+	db.query_with_bindings("ATTACH DATABASE ? AS extra;", [database_path("write_batching_attached.db")])
+	check_equal(count_rows(observer, "items"), 3, "ATTACH should commit the batch first")
+	db.insert_row("items", {"id": 4})
+	db.query("DETACH DATABASE extra;")
+	check_equal(count_rows(observer, "items"), 4, "DETACH should commit the batch first")
+
+	# Failing statements still commit the batch before they fail
+	db.insert_row("items", {"id": 5})
+	check(not db.query("ATTACH DATABASE '%s' AS broken;" % (DATA_DIRECTORY + "missing_folder/broken.db")), "Attaching a missing folder should fail")
+	check_equal(count_rows(observer, "items"), 5, "The batch should be committed before the failing statement")
+	db.close_db()
+	observer.close_db()
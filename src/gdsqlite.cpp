@@ -1,4 +1,8 @@
 #include "gdsqlite.hpp"
+#include "gdsqlite_backup.hpp"
+#include "gdsqlite_live_query.hpp"
+#include "gdsqlite_session.hpp"
+#include "gdsqlite_snapshot.hpp"
 
 using namespace godot;
 
@@ -10,11 +14,28 @@ void SQLite::_bind_methods() {
 	ClassDB::bind_method(D_METHOD("query_with_bindings", "query_string", "param_bindings"), &SQLite::query_with_bindings);
 	ClassDB::bind_method(D_METHOD("query_with_named_bindings", "query_string", "param_bindings"), &SQLite::query_with_named_bindings);
 
+	ClassDB::bind_method(D_METHOD("begin", "mode"), &SQLite::begin, DEFVAL(TRANSACTION_DEFERRED));
+	ClassDB::bind_method(D_METHOD("commit"), &SQLite::commit);
+	ClassDB::bind_method(D_METHOD("rollback"), &SQLite::rollback);
+	ClassDB::bind_method(D_METHOD("savepoint", "name"), &SQLite::savepoint);
+	ClassDB::bind_method(D_METHOD("release", "name"), &SQLite::release);
+	ClassDB::bind_method(D_METHOD("rollback_to", "name"), &SQLite::rollback_to);
+
+	ClassDB::bind_method(D_METHOD("snapshot_open", "database_name"), &SQLite::snapshot_open, DEFVAL("main"));
+	ClassDB::bind_method(D_METHOD("begin_read_snapshot", "snapshot"), &SQLite::begin_read_snapshot);
+
+	ClassDB::bind_method(D_METHOD("flush"), &SQLite::flush);
+	ClassDB::bind_method(D_METHOD("call_when_durable", "callable"), &SQLite::call_when_durable);
+
 	ClassDB::bind_method(D_METHOD("create_table", "table_name", "table_data"), &SQLite::create_table);
 	ClassDB::bind_method(D_METHOD("drop_table", "table_name"), &SQLite::drop_table);
 
 	ClassDB::bind_method(D_METHOD("backup_to", "destination"), &SQLite::backup_to);
 	ClassDB::bind_method(D_METHOD("restore_from", "source"), &SQLite::restore_from);
+	ClassDB::bind_method(D_METHOD("backup_to_buffer"), &SQLite::backup_to_buffer);
+	ClassDB::bind_method(D_METHOD("restore_from_buffer", "database_buffer"), &SQLite::restore_from_buffer);
+	ClassDB::bind_method(D_METHOD("begin_backup_to", "destination"), &SQLite::begin_backup_to);
+	ClassDB::bind_method(D_METHOD("begin_restore_from", "source"), &SQLite::begin_restore_from);
 
 	ClassDB::bind_method(D_METHOD("insert_row", "table_name", "row_data"), &SQLite::insert_row);
 	ClassDB::bind_method(D_METHOD("insert_rows", "table_name", "row_array"), &SQLite::insert_rows);
@@ -26,17 +47,39 @@ void SQLite::_bind_methods() {
 	ClassDB::bind_method(D_METHOD("create_function", "function_name", "callable", "arguments"), &SQLite::create_function);
 
 	ClassDB::bind_method(D_METHOD("import_from_json", "import_path"), &SQLite::import_from_json);
-	ClassDB::bind_method(D_METHOD("export_to_json", "export_path"), &SQLite::export_to_json);
+	ClassDB::bind_method(D_METHOD("export_to_json", "export_path", "compact"), &SQLite::export_to_json, DEFVAL(false));
 	ClassDB::bind_method(D_METHOD("import_from_buffer", "json_buffer"), &SQLite::import_from_buffer);
-	ClassDB::bind_method(D_METHOD("export_to_buffer"), &SQLite::export_to_buffer);
+	ClassDB::bind_method(D_METHOD("export_to_buffer", "compact"), &SQLite::export_to_buffer, DEFVAL(false));
+	ClassDB::bind_method(D_METHOD("import_from_binary", "binary_buffer"), &SQLite::import_from_binary);
+	ClassDB::bind_method(D_METHOD("export_to_binary", "compress"), &SQLite::export_to_binary, DEFVAL(false));
+	ClassDB::bind_method(D_METHOD("import_csv", "table_name", "import_path", "options"), &SQLite::import_csv, DEFVAL(Dictionary()));
+	ClassDB::bind_method(D_METHOD("export_csv", "query_string", "export_path", "options"), &SQLite::export_csv, DEFVAL(Dictionary()));
 
 	ClassDB::bind_method(D_METHOD("get_autocommit"), &SQLite::get_autocommit);
 	ClassDB::bind_method(D_METHOD("compileoption_used", "option_name"), &SQLite::compileoption_used);
 
+	ClassDB::bind_method(D_METHOD("create_session", "database_name"), &SQLite::create_session, DEFVAL("main"));
+
+	ClassDB::bind_method(D_METHOD("watch_query", "query_string", "param_bindings"), &SQLite::watch_query, DEFVAL(Array()));
+
+	ClassDB::bind_method(D_METHOD("subscribe_changes", "table_name", "callable", "kinds"), &SQLite::subscribe_changes, DEFVAL(CHANGE_ALL));
+	ClassDB::bind_method(D_METHOD("unsubscribe_changes", "table_name", "callable"), &SQLite::unsubscribe_changes);
+	ClassDB::bind_method(D_METHOD("flush_changes"), &SQLite::flush_changes);
+
+	ClassDB::bind_method(D_METHOD("get_io_stats"), &SQLite::get_io_stats);
+	ClassDB::bind_method(D_METHOD("reset_io_stats"), &SQLite::reset_io_stats);
+
+	ClassDB::bind_method(D_METHOD("prefetch_pages", "first_page", "page_count"), &SQLite::prefetch_pages);
+	ClassDB::bind_method(D_METHOD("prefetch_objects", "names"), &SQLite::prefetch_objects);
+
+	ClassDB::bind_method(D_METHOD("compact_to", "destination_path"), &SQLite::compact_to);
+	ClassDB::bind_method(D_METHOD("incremental_vacuum", "page_count"), &SQLite::incremental_vacuum);
+
 	ClassDB::bind_method(D_METHOD("enable_load_extension", "onoff"), &SQLite::enable_load_extension);
 	ClassDB::bind_method(D_METHOD("load_extension", "extension_path", "entrypoint"), &SQLite::load_extension, DEFVAL("sqlite3_extension_init"));
 
 	ClassDB::bind_static_method("SQLite", D_METHOD("sanitize_identifier", "table_or_column_name"), &SQLite::sanitize_identifier);
+	ClassDB::bind_static_method("SQLite", D_METHOD("compress_database", "source_path", "destination_path", "block_size", "compression_mode"), &SQLite::compress_database, DEFVAL(COMPRESSED_DEFAULT_BLOCK_SIZE), DEFVAL(FileAccess::COMPRESSION_ZSTD));
 
 	// Properties.
 	ClassDB::bind_method(D_METHOD("set_last_insert_rowid", "last_insert_rowid"), &SQLite::set_last_insert_rowid);
@@ -55,6 +98,48 @@ void SQLite::_bind_methods() {
 	ClassDB::bind_method(D_METHOD("get_read_only"), &SQLite::get_read_only);
 	ADD_PROPERTY(PropertyInfo(Variant::BOOL, "read_only"), "set_read_only", "get_read_only");
 
+	ClassDB::bind_method(D_METHOD("set_prefetch", "prefetch"), &SQLite::set_prefetch);
+	ClassDB::bind_method(D_METHOD("get_prefetch"), &SQLite::get_prefetch);
+	ADD_PROPERTY(PropertyInfo(Variant::BOOL, "prefetch"), "set_prefetch", "get_prefetch");
+
+	ClassDB::bind_method(D_METHOD("set_export_thread_count", "export_thread_count"), &SQLite::set_export_thread_count);
+	ClassDB::bind_method(D_METHOD("get_export_thread_count"), &SQLite::get_export_thread_count);
+	ADD_PROPERTY(PropertyInfo(Variant::INT, "export_thread_count"), "set_export_thread_count", "get_export_thread_count");
+
+	ClassDB::bind_method(D_METHOD("set_change_notifications", "change_notifications"), &SQLite::set_change_notifications);
+	ClassDB::bind_method(D_METHOD("get_change_notifications"), &SQLite::get_change_notifications);
+	ADD_PROPERTY(PropertyInfo(Variant::INT, "change_notifications"), "set_change_notifications", "get_change_notifications");
+
+	ClassDB::bind_method(D_METHOD("set_threading_mode", "threading_mode"), &SQLite::set_threading_mode);
+	ClassDB::bind_method(D_METHOD("get_threading_mode"), &SQLite::get_threading_mode);
+	ADD_PROPERTY(PropertyInfo(Variant::INT, "threading_mode"), "set_threading_mode", "get_threading_mode");
+
+	ClassDB::bind_method(D_METHOD("set_write_batching", "write_batching"), &SQLite::set_write_batching);
+	ClassDB::bind_method(D_METHOD("get_write_batching"), &SQLite::get_write_batching);
+	ADD_PROPERTY(PropertyInfo(Variant::BOOL, "write_batching"), "set_write_batching", "get_write_batching");
+
+	ClassDB::bind_method(D_METHOD("set_write_batch_size", "write_batch_size"), &SQLite::set_write_batch_size);
+	ClassDB::bind_method(D_METHOD("get_write_batch_size"), &SQLite::get_write_batch_size);
+	ADD_PROPERTY(PropertyInfo(Variant::INT, "write_batch_size"), "set_write_batch_size", "get_write_batch_size");
+
+	ClassDB::bind_method(D_METHOD("set_write_batch_msec", "write_batch_msec"), &SQLite::set_write_batch_msec);
+	ClassDB::bind_method(D_METHOD("get_write_batch_msec"), &SQLite::get_write_batch_msec);
+	ADD_PROPERTY(PropertyInfo(Variant::INT, "write_batch_msec"), "set_write_batch_msec", "get_write_batch_msec");
+
+	ClassDB::bind_method(D_METHOD("set_auto_vacuum", "auto_vacuum"), &SQLite::set_auto_vacuum);
+	ClassDB::bind_method(D_METHOD("get_auto_vacuum"), &SQLite::get_auto_vacuum);
+	ADD_PROPERTY(PropertyInfo(Variant::INT, "auto_vacuum"), "set_auto_vacuum", "get_auto_vacuum");
+
+	ClassDB::bind_method(D_METHOD("set_pragma_preset", "pragma_preset"), &SQLite::set_pragma_preset);
+	ClassDB::bind_method(D_METHOD("get_pragma_preset"), &SQLite::get_pragma_preset);
+	ADD_PROPERTY(PropertyInfo(Variant::STRING, "pragma_preset", PROPERTY_HINT_ENUM_SUGGESTION, "durable,fast_local,read_only_content"), "set_pragma_preset", "get_pragma_preset");
+
+	ClassDB::bind_method(D_METHOD("set_pragmas", "pragmas"), &SQLite::set_pragmas);
+	ClassDB::bind_method(D_METHOD("get_pragmas"), &SQLite::get_pragmas);
+	ADD_PROPERTY(PropertyInfo(Variant::DICTIONARY, "pragmas"), "set_pragmas", "get_pragmas");
+
+	ClassDB::bind_method(D_METHOD("get_effective_pragmas"), &SQLite::get_effective_pragmas);
+
 	ClassDB::bind_method(D_METHOD("set_path", "path"), &SQLite::set_path);
 	ClassDB::bind_method(D_METHOD("get_path"), &SQLite::get_path);
 	ADD_PROPERTY(PropertyInfo(Variant::STRING, "path"), "set_path", "get_path");
@@ -80,6 +165,29 @@ void SQLite::_bind_methods() {
 	BIND_ENUM_CONSTANT(VERBOSE);
 	BIND_ENUM_CONSTANT(VERY_VERBOSE);
 
+	BIND_ENUM_CONSTANT(CHANGE_NOTIFICATIONS_NONE);
+	BIND_ENUM_CONSTANT(CHANGE_NOTIFICATIONS_ROW);
+	BIND_ENUM_CONSTANT(CHANGE_NOTIFICATIONS_BATCHED);
+	BIND_ENUM_CONSTANT(CHANGE_NOTIFICATIONS_VALUES);
+
+	BIND_BITFIELD_FLAG(CHANGE_INSERT);
+	BIND_BITFIELD_FLAG(CHANGE_UPDATE);
+	BIND_BITFIELD_FLAG(CHANGE_DELETE);
+	BIND_BITFIELD_FLAG(CHANGE_ALL);
+
+	BIND_ENUM_CONSTANT(AUTO_VACUUM_UNCHANGED);
+	BIND_ENUM_CONSTANT(AUTO_VACUUM_NONE);
+	BIND_ENUM_CONSTANT(AUTO_VACUUM_FULL);
+	BIND_ENUM_CONSTANT(AUTO_VACUUM_INCREMENTAL);
+
+	BIND_ENUM_CONSTANT(THREADING_MODE_SINGLE_THREAD);
+	BIND_ENUM_CONSTANT(THREADING_MODE_SERIALIZED);
+	BIND_ENUM_CONSTANT(THREADING_MODE_MULTI_THREAD);
+
+	BIND_ENUM_CONSTANT(TRANSACTION_DEFERRED);
+	BIND_ENUM_CONSTANT(TRANSACTION_IMMEDIATE);
+	BIND_ENUM_CONSTANT(TRANSACTION_EXCLUSIVE);
+
 	BIND_CONSTANT(SQLITE_OK); /* Successful result */
 	/* beginning-of-error-codes */
 	BIND_CONSTANT(SQLITE_ERROR);
@@ -118,10 +226,42 @@ void SQLite::_bind_methods() {
 	ADD_SIGNAL(MethodInfo("row_inserted", PropertyInfo(Variant::STRING, "table_name"), PropertyInfo(Variant::INT, "rowid")));
 	ADD_SIGNAL(MethodInfo("row_updated", PropertyInfo(Variant::STRING, "table_name"), PropertyInfo(Variant::INT, "rowid")));
 	ADD_SIGNAL(MethodInfo("row_deleted", PropertyInfo(Variant::STRING, "table_name"), PropertyInfo(Variant::INT, "rowid")));
+	ADD_SIGNAL(MethodInfo("changes_committed", PropertyInfo(Variant::STRING, "table_name"), PropertyInfo(Variant::PACKED_INT64_ARRAY, "inserted_rowids"), PropertyInfo(Variant::PACKED_INT64_ARRAY, "updated_rowids"), PropertyInfo(Variant::PACKED_INT64_ARRAY, "deleted_rowids")));
+	ADD_SIGNAL(MethodInfo("write_batch_committed", PropertyInfo(Variant::BOOL, "success"), PropertyInfo(Variant::INT, "statement_count")));
+	ADD_SIGNAL(MethodInfo("transaction_committed", PropertyInfo(Variant::ARRAY, "changes", PROPERTY_HINT_ARRAY_TYPE, "Dictionary")));
+	ADD_SIGNAL(MethodInfo("compaction_progress", PropertyInfo(Variant::FLOAT, "progress")));
 }
 
-void update_hook_callback(void* db_ref, int notif_type, char const* db_name, char const* table_name, sqlite3_int64 row_id) {
+void SQLite::update_hook_callback(void* db_ref, int notif_type, char const* db_name, char const* table_name, sqlite3_int64 row_id) {
 	SQLite *sqlite = (SQLite *)db_ref;
+	int kind = notif_type == SQLITE_INSERT ? CHANGE_INSERT : (notif_type == SQLITE_UPDATE ? CHANGE_UPDATE : CHANGE_DELETE);
+
+	/* Changes of tables that nobody subscribed to are only buffered in BATCHED mode */
+	bool subscribed = false;
+	if (!sqlite->subscriptions.empty()) {
+		auto it = sqlite->subscriptions.find(table_name);
+		subscribed = it != sqlite->subscriptions.end() && (it->second.kinds & kind);
+	}
+
+	if (subscribed || sqlite->change_notifications == CHANGE_NOTIFICATIONS_BATCHED) {
+		/* Only buffer the change, it's up to the commit hook to report it */
+		table_changes_struct &changes = sqlite->pending_changes[table_name];
+		switch (notif_type) {
+			case SQLITE_INSERT:
+				changes.inserted.push_back(row_id);
+				break;
+			case SQLITE_UPDATE:
+				changes.updated.push_back(row_id);
+				break;
+			case SQLITE_DELETE:
+				changes.deleted.push_back(row_id);
+				break;
+		}
+	}
+	if (sqlite->change_notifications != CHANGE_NOTIFICATIONS_ROW) {
+		return;
+	}
+
 	switch (notif_type) {
 		case SQLITE_INSERT:
 			sqlite->emit_signal("row_inserted", String(table_name), static_cast<int64_t>(row_id));
@@ -135,6 +275,351 @@ void update_hook_callback(void* db_ref, int notif_type, char const* db_name, cha
 	}
 }
 
+/*
+** Move the changes of the transaction that is being committed to the changes
+** that still have to be reported. Signals can't be emitted from inside of the
+** commit hook, as their handlers aren't allowed to use the connection, so
+** they are emitted on the next idle frame instead.
+*/
+int SQLite::commit_hook_callback(void *db_ref) {
+	SQLite *sqlite = (SQLite *)db_ref;
+	for (auto &pending : sqlite->pending_changes) {
+		table_changes_struct &changes = sqlite->committed_changes[pending.first];
+		changes.inserted.insert(changes.inserted.end(), pending.second.inserted.begin(), pending.second.inserted.end());
+		changes.updated.insert(changes.updated.end(), pending.second.updated.begin(), pending.second.updated.end());
+		changes.deleted.insert(changes.deleted.end(), pending.second.deleted.begin(), pending.second.deleted.end());
+	}
+	sqlite->pending_changes.clear();
+	sqlite->savepoint_markers.clear();
+
+	if (!sqlite->pending_row_changes.is_empty()) {
+		sqlite->committed_transactions.append(sqlite->pending_row_changes);
+		sqlite->pending_row_changes = Array();
+	}
+
+	if ((!sqlite->committed_changes.empty() || !sqlite->committed_transactions.is_empty()) && !sqlite->changes_flush_scheduled) {
+		sqlite->changes_flush_scheduled = true;
+		callable_mp(sqlite, &SQLite::flush_committed_changes).call_deferred();
+	}
+	return 0;
+}
+
+void SQLite::rollback_hook_callback(void *db_ref) {
+	SQLite *sqlite = (SQLite *)db_ref;
+	sqlite->pending_changes.clear();
+	sqlite->pending_row_changes.clear();
+	sqlite->savepoint_markers.clear();
+}
+
+/*
+** The rollback hook isn't called for ROLLBACK TO, so every savepoint that is
+** started through this class remembers how many changes were pending at that
+** moment. Savepoints that are started with plain SQL aren't tracked.
+*/
+void SQLite::push_savepoint_marker(const String &p_name) {
+	if (on_thread_connection()) {
+		return;
+	}
+	savepoint_marker_struct marker;
+	marker.name = p_name;
+	for (const auto &pending : pending_changes) {
+		marker.change_counts[pending.first] = { pending.second.inserted.size(), pending.second.updated.size(), pending.second.deleted.size() };
+	}
+	marker.row_change_count = pending_row_changes.size();
+	savepoint_markers.push_back(marker);
+}
+
+/*
+** Releasing a savepoint also releases all savepoints that were started after
+** it, while their changes stay pending.
+*/
+void SQLite::release_savepoint_marker(const String &p_name) {
+	if (on_thread_connection()) {
+		return;
+	}
+	for (size_t i = savepoint_markers.size(); i > 0; i--) {
+		if (savepoint_markers[i - 1].name.nocasecmp_to(p_name) == 0) {
+			savepoint_markers.resize(i - 1);
+			return;
+		}
+	}
+}
+
+/*
+** Discard the changes that were made since the savepoint was started. The
+** savepoint itself remains, just like it does in SQLite.
+*/
+void SQLite::rollback_savepoint_marker(const String &p_name) {
+	if (on_thread_connection()) {
+		return;
+	}
+	for (size_t i = savepoint_markers.size(); i > 0; i--) {
+		const savepoint_marker_struct &marker = savepoint_markers[i - 1];
+		if (marker.name.nocasecmp_to(p_name) != 0) {
+			continue;
+		}
+		for (auto it = pending_changes.begin(); it != pending_changes.end();) {
+			auto counts = marker.change_counts.find(it->first);
+			if (counts == marker.change_counts.end()) {
+				it = pending_changes.erase(it);
+				continue;
+			}
+			it->second.inserted.resize(counts->second.inserted);
+			it->second.updated.resize(counts->second.updated);
+			it->second.deleted.resize(counts->second.deleted);
+			++it;
+		}
+		if (pending_row_changes.size() > marker.row_change_count) {
+			pending_row_changes.resize(marker.row_change_count);
+		}
+		savepoint_markers.resize(i);
+		return;
+	}
+}
+
+#ifdef SQLITE_ENABLE_PREUPDATE_HOOK
+static Variant value_to_variant(sqlite3_value *p_value) {
+	if (p_value == nullptr) {
+		return Variant();
+	}
+	switch (sqlite3_value_type(p_value)) {
+		case SQLITE_INTEGER:
+			return Variant((int64_t)sqlite3_value_int64(p_value));
+
+		case SQLITE_FLOAT:
+			return Variant(sqlite3_value_double(p_value));
+
+		case SQLITE_TEXT:
+			return String::utf8((const char *)sqlite3_value_text(p_value), sqlite3_value_bytes(p_value));
+
+		case SQLITE_BLOB: {
+			int bytes = sqlite3_value_bytes(p_value);
+			PackedByteArray arr = PackedByteArray();
+			arr.resize(bytes);
+			if (bytes > 0) {
+				memcpy((void *)arr.ptrw(), sqlite3_value_blob(p_value), bytes);
+			}
+			return arr;
+		}
+
+		default:
+			return Variant();
+	}
+}
+
+/*
+** Record the column values of every changed row before the change is made,
+** such that listeners don't have to query the row again. Unlike the update
+** hook, this hook is also called for WITHOUT ROWID tables.
+*/
+void SQLite::preupdate_hook_callback(void *db_ref, sqlite3 *db, int notif_type, char const *db_name, char const *table_name, sqlite3_int64 old_row_id, sqlite3_int64 new_row_id) {
+	SQLite *sqlite = (SQLite *)db_ref;
+	int column_count = sqlite3_preupdate_count(db);
+
+	Array old_values;
+	if (notif_type != SQLITE_INSERT) {
+		old_values.resize(column_count);
+		for (int i = 0; i < column_count; i++) {
+			sqlite3_value *value = nullptr;
+			sqlite3_preupdate_old(db, i, &value);
+			old_values[i] = value_to_variant(value);
+		}
+	}
+	Array new_values;
+	if (notif_type != SQLITE_DELETE) {
+		new_values.resize(column_count);
+		for (int i = 0; i < column_count; i++) {
+			sqlite3_value *value = nullptr;
+			sqlite3_preupdate_new(db, i, &value);
+			new_values[i] = value_to_variant(value);
+		}
+	}
+
+	Dictionary change;
+	change["database"] = String::utf8(db_name);
+	change["table"] = String::utf8(table_name);
+	change["kind"] = notif_type == SQLITE_INSERT ? CHANGE_INSERT : (notif_type == SQLITE_UPDATE ? CHANGE_UPDATE : CHANGE_DELETE);
+	change["rowid"] = static_cast<int64_t>(notif_type == SQLITE_INSERT ? new_row_id : old_row_id);
+	change["old_values"] = old_values;
+	change["new_values"] = new_values;
+	sqlite->pending_row_changes.append(change);
+}
+#endif
+
+static PackedInt64Array to_packed_array(const std::vector<int64_t> &p_vector) {
+	PackedInt64Array array;
+	array.resize(p_vector.size());
+	if (!p_vector.empty()) {
+		memcpy(array.ptrw(), p_vector.data(), p_vector.size() * sizeof(int64_t));
+	}
+	return array;
+}
+
+/*
+** Report all changes of the transactions that were committed since the last
+** flush, with a single changes_committed signal per table and a single call
+** per table for each of its subscribers. Changes that include their column
+** values are reported with a transaction_committed signal per transaction.
+*/
+void SQLite::flush_committed_changes() {
+	call_guard guard(this, false);
+	changes_flush_scheduled = false;
+	/* Handlers might commit new changes, which are reported by the next flush */
+	Array transactions = committed_transactions;
+	committed_transactions = Array();
+	for (int64_t i = 0; i < transactions.size(); i++) {
+		emit_signal("transaction_committed", transactions[i]);
+	}
+
+	std::unordered_map<std::string, table_changes_struct> changes;
+	changes.swap(committed_changes);
+	for (auto &table : changes) {
+		String table_name = String::utf8(table.first.c_str());
+		PackedInt64Array inserted = to_packed_array(table.second.inserted);
+		PackedInt64Array updated = to_packed_array(table.second.updated);
+		PackedInt64Array deleted = to_packed_array(table.second.deleted);
+		if (change_notifications == CHANGE_NOTIFICATIONS_BATCHED) {
+			emit_signal("changes_committed", table_name, inserted, updated, deleted);
+		}
+
+		auto it = subscriptions.find(table.first);
+		if (it == subscriptions.end()) {
+			continue;
+		}
+		/* Copied, as subscribers are allowed to unsubscribe while being called */
+		std::vector<subscription_struct> subscribers = it->second.subscribers;
+		for (const subscription_struct &subscriber : subscribers) {
+			bool has_inserted = (subscriber.kinds & CHANGE_INSERT) && !inserted.is_empty();
+			bool has_updated = (subscriber.kinds & CHANGE_UPDATE) && !updated.is_empty();
+			bool has_deleted = (subscriber.kinds & CHANGE_DELETE) && !deleted.is_empty();
+			if (!subscriber.callable.is_valid() || !(has_inserted || has_updated || has_deleted)) {
+				continue;
+			}
+			subscriber.callable.call(table_name, has_inserted ? inserted : PackedInt64Array(), has_updated ? updated : PackedInt64Array(), has_deleted ? deleted : PackedInt64Array());
+		}
+	}
+}
+
+void SQLite::flush_changes() {
+	call_guard guard(this, false);
+	if (!committed_changes.empty() || !committed_transactions.is_empty()) {
+		flush_committed_changes();
+	}
+}
+
+/*
+** Create a query whose result is kept up-to-date with the tables it reads
+** from, see the SQLiteLiveQuery class for more details.
+*/
+Ref<SQLiteLiveQuery> SQLite::watch_query(const String &p_query, const Array &p_param_bindings) {
+	call_guard guard(this, false);
+	if (db == nullptr) {
+		ERR_PRINT("GDSQLite Error: Can't watch query if connection is not open!");
+		return Ref<SQLiteLiveQuery>();
+	}
+
+	Ref<SQLiteLiveQuery> live_query;
+	live_query.instantiate();
+	if (!live_query->start(Ref<SQLite>(this), p_query, p_param_bindings)) {
+		return Ref<SQLiteLiveQuery>();
+	}
+	return live_query;
+}
+
+/*
+** Call the callable with all changes that are committed to the given table,
+** limited to the given kinds of changes. The changes are delivered in
+** batches, once per frame or when calling flush_changes(), with the rowids
+** of the inserted, updated and deleted rows as its arguments.
+*/
+bool SQLite::subscribe_changes(const String &p_table_name, const Callable &p_callable, BitField<ChangeKind> p_kinds) {
+	call_guard guard(this, false);
+	if (!p_callable.is_valid()) {
+		ERR_PRINT("GDSQLite Error: Can't subscribe to changes with an invalid callable!");
+		return false;
+	}
+	int64_t kinds = int64_t(p_kinds) & CHANGE_ALL;
+	if (kinds == 0) {
+		ERR_PRINT("GDSQLite Error: Can't subscribe to changes without any kinds of changes!");
+		return false;
+	}
+
+	const CharString utf8_name = p_table_name.utf8();
+	table_subscriptions_struct &table = subscriptions[utf8_name.get_data()];
+	for (subscription_struct &subscriber : table.subscribers) {
+		if (subscriber.callable == p_callable) {
+			subscriber.kinds = kinds;
+			update_subscribed_kinds(table);
+			return true;
+		}
+	}
+	table.subscribers.push_back({ p_callable, kinds });
+	update_subscribed_kinds(table);
+	update_hooks();
+	return true;
+}
+
+bool SQLite::unsubscribe_changes(const String &p_table_name, const Callable &p_callable) {
+	call_guard guard(this, false);
+	const CharString utf8_name = p_table_name.utf8();
+	auto it = subscriptions.find(utf8_name.get_data());
+	if (it != subscriptions.end()) {
+		std::vector<subscription_struct> &subscribers = it->second.subscribers;
+		for (size_t i = 0; i < subscribers.size(); i++) {
+			if (subscribers[i].callable == p_callable) {
+				subscribers.erase(subscribers.begin() + i);
+				if (subscribers.empty()) {
+					subscriptions.erase(it);
+				} else {
+					update_subscribed_kinds(it->second);
+				}
+				update_hooks();
+				return true;
+			}
+		}
+	}
+	ERR_PRINT("GDSQLite Error: Can't unsubscribe from changes of table \"" + p_table_name + "\" that were never subscribed to!");
+	return false;
+}
+
+void SQLite::update_subscribed_kinds(table_subscriptions_struct &p_table) {
+	p_table.kinds = 0;
+	for (const subscription_struct &subscriber : p_table.subscribers) {
+		p_table.kinds |= subscriber.kinds;
+	}
+}
+
+/*
+** Install the hooks that are needed for the current change_notifications mode
+** and subscriptions, or remove them entirely when no notifications are wanted.
+*/
+void SQLite::update_hooks() {
+	/* The hooks belong to the main connection, even if the call came from another thread */
+	sqlite3 *hooked_db = db.get_shared();
+	if (hooked_db == nullptr) {
+		return;
+	}
+	bool values = change_notifications == CHANGE_NOTIFICATIONS_VALUES;
+	bool batched = change_notifications == CHANGE_NOTIFICATIONS_BATCHED || !subscriptions.empty();
+	sqlite3_update_hook(hooked_db, change_notifications == CHANGE_NOTIFICATIONS_ROW || batched ? update_hook_callback : NULL, this);
+	sqlite3_commit_hook(hooked_db, batched || values ? commit_hook_callback : NULL, this);
+	sqlite3_rollback_hook(hooked_db, batched || values ? rollback_hook_callback : NULL, this);
+	if (!batched) {
+		pending_changes.clear();
+	}
+	if (!values) {
+		pending_row_changes.clear();
+	}
+
+#ifdef SQLITE_ENABLE_PREUPDATE_HOOK
+	/* Sessions rely on the pre-update hook as well, so it's only touched when needed */
+	if (values != preupdate_hook_installed) {
+		sqlite3_preupdate_hook(hooked_db, values ? preupdate_hook_callback : NULL, this);
+		preupdate_hook_installed = values;
+	}
+#endif
+}
+
 SQLite::SQLite() {
 	db = nullptr;
 	query_result = TypedArray<Dictionary>();
@@ -151,6 +636,8 @@ SQLite::~SQLite() {
 }
 
 bool SQLite::open_db() {
+	call_guard guard(this, false);
+	std::unique_lock<std::shared_mutex> connection_lock(connection_mutex);
 	if (db) {
 		ERR_PRINT("GDSQLite Error: Can't open database if connection is already open!");
 		return false;
@@ -166,26 +653,23 @@ bool SQLite::open_db() {
 	}
 	path = normalize_path(path, read_only);
 
-	int rc;
-	const CharString utf8_path = path.utf8();
-	const char *char_path = utf8_path.get_data();
+	/* Validate all pragmas up front, such that a faulty configuration doesn't leave a half-tuned connection behind */
+	std::vector<gdsqlite_pragma_setting> pragma_settings;
+	String pragma_error;
+	if (!gdsqlite_resolve_pragmas(pragma_preset, pragmas, read_only, pragma_settings, pragma_error)) {
+		ERR_PRINT("GDSQLite Error: " + pragma_error);
+		return false;
+	}
 
-	/* Try to open the database */
-	if (read_only) {
-		if (path.find(":memory:") == -1) {
-			sqlite3_vfs_register(gdsqlite_vfs(), 0);
-			rc = sqlite3_open_v2(char_path, &db, SQLITE_OPEN_READONLY, "godot");
-		} else {
-			ERR_PRINT("GDSQLite Error: Opening in-memory databases in read-only mode is currently not supported!");
-			return false;
-		}
-	} else {
-		/* The `SQLITE_OPEN_URI`-flag is solely required for in-memory databases with shared cache, but it is safe to use in most general cases */
-		/* As discussed here: https://www.sqlite.org/uri.html */
-		rc = sqlite3_open_v2(char_path, &db, SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE | SQLITE_OPEN_URI, NULL);
-		/* Identical to: `rc = sqlite3_open(char_path, &db);`*/
+	if (read_only && path.find(":memory:") != -1) {
+		ERR_PRINT("GDSQLite Error: Opening in-memory databases in read-only mode is currently not supported!");
+		return false;
 	}
 
+	/* Try to open the database */
+	int rc = open_connection(&db.get_shared());
+	owner_thread = std::this_thread::get_id();
+
 	if (rc != SQLITE_OK) {
 		ERR_PRINT("GDSQLite Error: Can't open database: " + String::utf8(sqlite3_errmsg(db)));
 		return false;
@@ -193,6 +677,18 @@ bool SQLite::open_db() {
 		UtilityFunctions::print("Opened database successfully (" + path + ")");
 	}
 
+	/* Start the prefetcher of the godot VFS, the database itself isn't read until the first query */
+	if (prefetch) {
+		if (!read_only || path.find(":memory:") != -1) {
+			ERR_PRINT("GDSQLite Error: Prefetching is only supported for read-only databases, ignoring the prefetch property!");
+		} else {
+			rc = sqlite3_file_control(db, "main", GDSQLITE_FCNTL_PREFETCH_ENABLE, nullptr);
+			if (rc != SQLITE_OK) {
+				ERR_PRINT("GDSQLite Error: Can't enable prefetching: " + String::utf8(sqlite3_errstr(rc)));
+			}
+		}
+	}
+
 	/* Try to enable foreign keys. */
 	if (foreign_keys) {
 		char *zErrMsg = nullptr;
@@ -204,20 +700,200 @@ bool SQLite::open_db() {
 		}
 	}
 
+	Dictionary main_effective_pragmas;
+	bool success = apply_pragmas(db, pragma_settings, main_effective_pragmas);
+	{
+		std::lock_guard<std::mutex> lock(state_mutex);
+		effective_pragmas = main_effective_pragmas;
+	}
+	if (!success) {
+		sqlite3_close_v2(db);
+		db = nullptr;
+		return false;
+	}
+
+	if (auto_vacuum != AUTO_VACUUM_UNCHANGED && !apply_auto_vacuum()) {
+		sqlite3_close_v2(db);
+		db = nullptr;
+		return false;
+	}
+
 	/* Connect data change notification callbacks to signals. */
-	sqlite3_update_hook(db, update_hook_callback, this);
+	update_hooks();
 
 	return true;
 }
 
+/*
+** Open a connection to the database at the current path, taking the read_only
+** and threading_mode properties into account.
+*/
+int SQLite::open_connection(sqlite3 **r_db) {
+	const CharString utf8_path = path.utf8();
+	const char *char_path = utf8_path.get_data();
+
+	/* SQLite's own mutexes are redundant in multi-thread mode, as no connection is ever shared between threads */
+	int threading_flags = 0;
+	if (threading_mode == THREADING_MODE_SERIALIZED) {
+		threading_flags = SQLITE_OPEN_FULLMUTEX;
+	} else if (threading_mode == THREADING_MODE_MULTI_THREAD) {
+		threading_flags = SQLITE_OPEN_NOMUTEX;
+	}
+
+	if (read_only) {
+		sqlite3_vfs *vfs = gdsqlite_vfs();
+		/* Databases converted by `compress_database()` are decompressed on-the-fly by a dedicated VFS */
+		if (gdsqlite_is_compressed_database(path)) {
+			vfs = gdsqlite_compressed_vfs();
+		}
+		sqlite3_vfs_register(vfs, 0);
+		return sqlite3_open_v2(char_path, r_db, SQLITE_OPEN_READONLY | threading_flags, vfs->zName);
+	}
+	/* The `SQLITE_OPEN_URI`-flag is solely required for in-memory databases with shared cache, but it is safe to use in most general cases */
+	/* As discussed here: https://www.sqlite.org/uri.html */
+	return sqlite3_open_v2(char_path, r_db, SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE | SQLITE_OPEN_URI | threading_flags, NULL);
+}
+
+/*
+** Open an additional connection to the same database for the calling thread,
+** configured just like the main connection. Change notifications, write
+** batching, custom functions and sessions remain exclusive to the main
+** connection. Note that every in-memory database is private to a single
+** connection, unless it's opened with a shared cache URI.
+*/
+sqlite3 *SQLite::open_thread_connection() {
+	sqlite3 *thread_db = nullptr;
+	if (open_connection(&thread_db) != SQLITE_OK) {
+		ERR_PRINT("GDSQLite Error: Can't open database for thread: " + String::utf8(sqlite3_errmsg(thread_db)));
+		sqlite3_close_v2(thread_db);
+		return nullptr;
+	}
+	if (foreign_keys) {
+		sqlite3_exec(thread_db, "PRAGMA foreign_keys=on;", NULL, NULL, NULL);
+	}
+
+	std::vector<gdsqlite_pragma_setting> pragma_settings;
+	String pragma_error;
+	if (!gdsqlite_resolve_pragmas(pragma_preset, pragmas, read_only, pragma_settings, pragma_error)) {
+		ERR_PRINT("GDSQLite Error: " + pragma_error);
+		sqlite3_close_v2(thread_db);
+		return nullptr;
+	}
+	/* The effective pragmas of the main connection are the ones that are reported */
+	Dictionary thread_effective_pragmas;
+	if (!apply_pragmas(thread_db, pragma_settings, thread_effective_pragmas)) {
+		sqlite3_close_v2(thread_db);
+		return nullptr;
+	}
+	return thread_db;
+}
+
+/* Innermost of the outermost calls of the calling thread, one per SQLite object */
+static thread_local call_frame_struct *current_call_frame = nullptr;
+
+SQLite::call_guard::call_guard(SQLite *p_sqlite, bool p_thread_connection) :
+		sqlite(p_sqlite) {
+	/* Nested calls simply continue on the connection of the outermost call */
+	if (sqlite->threading_mode == THREADING_MODE_SINGLE_THREAD || sqlite->find_call_frame() != nullptr) {
+		return;
+	}
+	std::thread::id thread_id = std::this_thread::get_id();
+	frame.sqlite = sqlite;
+	frame.previous = current_call_frame;
+
+	if (p_thread_connection && sqlite->threading_mode == THREADING_MODE_MULTI_THREAD) {
+		connection_lock = std::shared_lock<std::shared_mutex>(sqlite->connection_mutex);
+		if (sqlite->db.get_shared() && thread_id != sqlite->owner_thread) {
+			{
+				std::lock_guard<std::mutex> lock(sqlite->state_mutex);
+				frame.state = &sqlite->thread_states[thread_id];
+			}
+			current_call_frame = &frame;
+			if (frame.state->db == nullptr) {
+				frame.state->db = sqlite->open_thread_connection();
+			}
+			return;
+		}
+		connection_lock.unlock();
+	}
+
+	sqlite->call_mutex.lock();
+	current_call_frame = &frame;
+	/* Continue from the results of the previous call of this thread, as if no other thread had made any calls since */
+	std::lock_guard<std::mutex> lock(sqlite->state_mutex);
+	thread_state_struct &state = sqlite->thread_states[thread_id];
+	sqlite->query_result = state.query_result;
+	sqlite->error_message = state.error_message;
+}
+
+SQLite::call_guard::~call_guard() {
+	if (frame.sqlite == nullptr) {
+		return;
+	}
+	current_call_frame = frame.previous;
+	if (frame.state) {
+		/* The shared lock on the connections is released along with the guard */
+		if (frame.state->db) {
+			frame.state->last_insert_rowid = sqlite3_last_insert_rowid(frame.state->db);
+		}
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(sqlite->state_mutex);
+		thread_state_struct &state = sqlite->thread_states[std::this_thread::get_id()];
+		state.query_result = sqlite->query_result;
+		state.error_message = sqlite->error_message;
+		if (sqlite->db) {
+			state.last_insert_rowid = sqlite3_last_insert_rowid(sqlite->db);
+		}
+	}
+	sqlite->call_mutex.unlock();
+}
+
 bool SQLite::close_db() {
+	call_guard guard(this, false);
+	if (on_thread_connection()) {
+		ERR_PRINT("GDSQLite Error: Can't close database from inside of a call on the connection of another thread!");
+		return false;
+	}
+	/* Wait for the calls on the connections of other threads to finish */
+	std::unique_lock<std::shared_mutex> connection_lock(connection_mutex);
 	if (db) {
+		/* Closing the connection would silently roll back any batched writes */
+		flush();
+		if (write_batch_open) {
+			finish_write_batch(false);
+		}
+
+		/* Releasing removes them from their list, so iterate over copies */
+		std::vector<SQLiteBackup *> running_backups = backups;
+		for (SQLiteBackup *backup : running_backups) {
+			backup->release();
+		}
+		std::vector<SQLiteLiveQuery *> watched_queries = live_queries;
+		for (SQLiteLiveQuery *live_query : watched_queries) {
+			live_query->release();
+		}
+		std::vector<SQLiteSession *> open_sessions = sessions;
+		for (SQLiteSession *session : open_sessions) {
+			session->release();
+		}
+
 		// Cannot close database!
 		if (sqlite3_close_v2(db) != SQLITE_OK) {
 			ERR_PRINT("GDSQLite Error: Can't close database!");
 			return false;
 		} else {
 			db = nullptr;
+			preupdate_hook_installed = false;
+			std::lock_guard<std::mutex> lock(state_mutex);
+			for (auto &thread_state : thread_states) {
+				if (thread_state.second.db) {
+					sqlite3_close_v2(thread_state.second.db);
+				}
+			}
+			thread_states.clear();
 			if (verbosity_level > VerbosityLevel::QUIET) {
 				UtilityFunctions::print("Closed database (" + path + ")");
 			}
@@ -242,6 +918,7 @@ String SQLite::normalize_path(const String p_path, const bool p_read_only) const
 }
 
 bool SQLite::query(const String &p_query) {
+	call_guard guard(this);
 	return query_with_bindings(p_query, Array());
 }
 
@@ -252,7 +929,7 @@ bool SQLite::prepare_statement(const CharString &p_query, sqlite3_stmt **out_stm
 
     const char *sql = p_query.get_data();
 
-    query_result.clear();
+    query_result.get().clear();
 
     int rc = sqlite3_prepare_v2(db, sql, -1, out_stmt, pzTail);
     update_error_message(rc);
@@ -307,13 +984,11 @@ bool SQLite::bind_parameter(Variant binding_value, sqlite3_stmt *stmt, int i) {
 	return true;
 }
 
-bool SQLite::execute_statement(sqlite3_stmt *stmt) {
-	if (verbosity_level > VerbosityLevel::NORMAL) {
-		char *expanded_sql = sqlite3_expanded_sql(stmt);
-		UtilityFunctions::print(String::utf8(expanded_sql));
-		sqlite3_free(expanded_sql);
-	}
-
+/*
+** Step through all rows of the statement, appending every row to r_rows as a
+** Dictionary. Returns the result code of the last step.
+*/
+int SQLite::read_statement_rows(sqlite3_stmt *stmt, TypedArray<Dictionary> &r_rows) {
 	/* Column names don't change for every row -> Cache them! */
 	int argc = sqlite3_column_count(stmt);
 	Vector<StringName> column_names;
@@ -324,7 +999,8 @@ bool SQLite::execute_statement(sqlite3_stmt *stmt) {
 	}
 
 	// Execute the statement and iterate over all the resulting rows.
-	while (sqlite3_step(stmt) == SQLITE_ROW) {
+	int rc;
+	while ((rc = sqlite3_step(stmt)) == SQLITE_ROW) {
 		Dictionary column_dict;
 
 		/* Loop over all columns and add them to the Dictionary */
@@ -363,10 +1039,26 @@ bool SQLite::execute_statement(sqlite3_stmt *stmt) {
 
 			column_dict[column_names[i]] = column_value;
 		}
-		/* Add result to query_result Array */
-		query_result.append(column_dict);
+		/* Add result to the rows */
+		r_rows.append(column_dict);
+	}
+	return rc;
+}
+
+bool SQLite::execute_statement(sqlite3_stmt *stmt) {
+	if (verbosity_level > VerbosityLevel::NORMAL) {
+		char *expanded_sql = sqlite3_expanded_sql(stmt);
+		UtilityFunctions::print(String::utf8(expanded_sql));
+		sqlite3_free(expanded_sql);
+	}
+
+	if (write_batching && !on_thread_connection() && !prepare_write_batch(stmt)) {
+		sqlite3_finalize(stmt);
+		return false;
 	}
 
+	read_statement_rows(stmt, query_result);
+
 	/* Clean up and delete the resources used by the prepared statement */
 	sqlite3_finalize(stmt);
 
@@ -382,6 +1074,7 @@ bool SQLite::execute_statement(sqlite3_stmt *stmt) {
 }
 
 bool SQLite::query_with_bindings(const String &p_query, Array param_bindings) {
+	call_guard guard(this);
 	const char *pzTail;
 	sqlite3_stmt *stmt;
 
@@ -426,6 +1119,7 @@ bool SQLite::query_with_bindings(const String &p_query, Array param_bindings) {
 }
 
 bool SQLite::query_with_named_bindings(const String &p_query, Dictionary param_bindings) {
+	call_guard guard(this);
 	const char *pzTail;
 	sqlite3_stmt *stmt;
 
@@ -483,7 +1177,22 @@ String SQLite::sanitize_identifier(const String &p_identifier) {
 	return vformat("\"%s\"", p_identifier.replace("\"", "\"\""));
 }
 
+bool SQLite::compress_database(const String &p_source_path, const String &p_destination_path, int64_t p_block_size, int64_t p_compression_mode) {
+	if (p_block_size <= 0 || p_block_size > UINT32_MAX) {
+		ERR_PRINT("GDSQLite Error: The block size should be a positive number of bytes!");
+		return false;
+	}
+
+	Error err_code = gdsqlite_compress_database(p_source_path, p_destination_path, p_block_size, (FileAccess::CompressionMode)p_compression_mode);
+	if (err_code != Error::OK) {
+		ERR_PRINT("GDSQLite Error: Can't compress database " + p_source_path + " to " + p_destination_path + " (Error = " + String::num_int64(err_code) + ")");
+		return false;
+	}
+	return true;
+}
+
 bool SQLite::create_table(const String &p_name, const Dictionary &p_table_dict) {
+	call_guard guard(this);
 	if (!validate_table_dict(p_table_dict)) {
 		return false;
 	}
@@ -630,6 +1339,7 @@ bool SQLite::validate_table_dict(const Dictionary &p_table_dict) {
 }
 
 bool SQLite::drop_table(const String &p_name) {
+	call_guard guard(this);
 	String query_string;
 	/* Create SQL statement */
 	query_string = vformat("DROP TABLE %s;", p_name);
@@ -637,13 +1347,38 @@ bool SQLite::drop_table(const String &p_name) {
 	return query(query_string);
 }
 
-bool SQLite::backup_to(String destination_path) {
-	destination_path = ProjectSettings::get_singleton()->globalize_path(destination_path.strip_edges());
-	CharString dummy_path = destination_path.utf8();
+/*
+** Open the database on the other end of a backup or restore. Paths that can't
+** be converted to a path on the file system, such as `res://` in exported
+** projects, are accessed through Godot's FileAccess by means of the godot VFS.
+** Sources are opened read-only, as `res://` can't be written to once exported,
+** which is also why it's never accepted as a destination.
+*/
+int SQLite::open_backup_db(const String &p_path, bool p_read_only, sqlite3 **r_db) {
+	String stripped_path = p_path.strip_edges();
+	if (!p_read_only && stripped_path.begins_with("res://")) {
+		ERR_PRINT("GDSQLite Error: Can't use \"" + stripped_path + "\" as backup destination, as res:// is read-only in exported projects!");
+		*r_db = nullptr;
+		return SQLITE_PERM;
+	}
+	String global_path = ProjectSettings::get_singleton()->globalize_path(stripped_path);
+	const CharString dummy_path = global_path.utf8();
 	const char *char_path = dummy_path.get_data();
+	int flags = p_read_only ? SQLITE_OPEN_READONLY : SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE;
+
+	if (global_path.begins_with("res://") || global_path.begins_with("user://")) {
+		sqlite3_vfs *vfs = gdsqlite_vfs();
+		sqlite3_vfs_register(vfs, 0);
+		return sqlite3_open_v2(char_path, r_db, flags, vfs->zName);
+	}
+	return sqlite3_open_v2(char_path, r_db, flags | SQLITE_OPEN_URI, NULL);
+}
 
+bool SQLite::backup_to(String destination_path) {
+	call_guard guard(this);
+	flush();
 	sqlite3 *destination_db;
-	int result = sqlite3_open_v2(char_path, &destination_db, SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE | SQLITE_OPEN_URI, NULL);
+	int result = open_backup_db(destination_path, false, &destination_db);
 	if (result == SQLITE_OK) {
 		result = backup_database(db, destination_db);
 	}
@@ -652,12 +1387,10 @@ bool SQLite::backup_to(String destination_path) {
 }
 
 bool SQLite::restore_from(String source_path) {
-	source_path = ProjectSettings::get_singleton()->globalize_path(source_path.strip_edges());
-	CharString dummy_path = source_path.utf8();
-	const char *char_path = dummy_path.get_data();
-
+	call_guard guard(this);
+	flush();
 	sqlite3 *source_db;
-	int result = sqlite3_open_v2(char_path, &source_db, SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE | SQLITE_OPEN_URI, NULL);
+	int result = open_backup_db(source_path, true, &source_db);
 	if (result == SQLITE_OK) {
 		result = backup_database(source_db, db);
 	}
@@ -665,7 +1398,109 @@ bool SQLite::restore_from(String source_path) {
 	return result == SQLITE_OK;
 }
 
-int SQLite::backup_database(sqlite3 *source_db, sqlite3 *destination_db) {
+/*
+** Serialize the database into a buffer, without touching the disk. The
+** buffer contains a regular database file, which can also be written to disk
+** and opened as-is.
+*/
+PackedByteArray SQLite::backup_to_buffer() {
+	call_guard guard(this);
+	PackedByteArray database_buffer;
+	if (db == nullptr) {
+		ERR_PRINT("GDSQLite Error: Can't backup database if connection is not open!");
+		return database_buffer;
+	}
+	flush();
+
+	sqlite3_int64 size = 0;
+	unsigned char *data = sqlite3_serialize(db, "main", &size, 0);
+	if (data == nullptr) {
+		ERR_PRINT("GDSQLite Error: Can't serialize database: " + String::utf8(sqlite3_errmsg(db)));
+		return database_buffer;
+	}
+	database_buffer.resize(size);
+	memcpy(database_buffer.ptrw(), data, size);
+	sqlite3_free(data);
+	return database_buffer;
+}
+
+/*
+** Restore the database from a buffer as returned by backup_to_buffer(). The
+** buffer is loaded into a temporary in-memory database first, which is then
+** copied with the backup API. This way the connection keeps using its
+** original file instead of being turned into an in-memory database.
+*/
+bool SQLite::restore_from_buffer(const PackedByteArray &p_database_buffer) {
+	call_guard guard(this);
+	if (db == nullptr) {
+		ERR_PRINT("GDSQLite Error: Can't restore database if connection is not open!");
+		return false;
+	}
+	if (p_database_buffer.is_empty()) {
+		ERR_PRINT("GDSQLite Error: Can't restore database from an empty buffer!");
+		return false;
+	}
+	flush();
+
+	sqlite3 *source_db;
+	int result = sqlite3_open_v2(":memory:", &source_db, SQLITE_OPEN_READWRITE, NULL);
+	if (result == SQLITE_OK) {
+		/* SQLite takes ownership of the copy and frees it when the connection is closed */
+		sqlite3_int64 size = p_database_buffer.size();
+		unsigned char *data = static_cast<unsigned char *>(sqlite3_malloc64(size));
+		if (data == nullptr) {
+			result = SQLITE_NOMEM;
+		} else {
+			memcpy(data, p_database_buffer.ptr(), size);
+			result = sqlite3_deserialize(source_db, "main", data, size, size, SQLITE_DESERIALIZE_FREEONCLOSE | SQLITE_DESERIALIZE_READONLY);
+		}
+	}
+	if (result == SQLITE_OK) {
+		result = backup_database(source_db, db);
+	}
+	if (result != SQLITE_OK) {
+		ERR_PRINT("GDSQLite Error: Can't restore database from buffer: " + String::utf8(sqlite3_errstr(result)));
+	}
+	(void)sqlite3_close_v2(source_db);
+	return result == SQLITE_OK;
+}
+
+/*
+** Start an incremental backup, see the SQLiteBackup class for more details.
+*/
+Ref<SQLiteBackup> SQLite::begin_backup_to(const String &p_destination_path) {
+	call_guard guard(this, false);
+	if (db == nullptr) {
+		ERR_PRINT("GDSQLite Error: Can't start backup if connection is not open!");
+		return Ref<SQLiteBackup>();
+	}
+	flush();
+
+	Ref<SQLiteBackup> backup;
+	backup.instantiate();
+	if (!backup->start(Ref<SQLite>(this), p_destination_path, false)) {
+		return Ref<SQLiteBackup>();
+	}
+	return backup;
+}
+
+Ref<SQLiteBackup> SQLite::begin_restore_from(const String &p_source_path) {
+	call_guard guard(this, false);
+	if (db == nullptr) {
+		ERR_PRINT("GDSQLite Error: Can't start restore if connection is not open!");
+		return Ref<SQLiteBackup>();
+	}
+	flush();
+
+	Ref<SQLiteBackup> backup;
+	backup.instantiate();
+	if (!backup->start(Ref<SQLite>(this), p_source_path, true)) {
+		return Ref<SQLiteBackup>();
+	}
+	return backup;
+}
+
+int SQLite::backup_database(sqlite3 *source_db, sqlite3 *destination_db) {
 	int rc;
 	sqlite3_backup *backup = sqlite3_backup_init(destination_db, "main", source_db, "main");
 	if (backup) {
@@ -678,6 +1513,7 @@ int SQLite::backup_database(sqlite3 *source_db, sqlite3 *destination_db) {
 }
 
 bool SQLite::insert_row(const String &p_name, const Dictionary &p_row_dict) {
+	call_guard guard(this);
 	Array keys = p_row_dict.keys();
 	Array param_bindings = p_row_dict.values();
 
@@ -698,33 +1534,33 @@ bool SQLite::insert_row(const String &p_name, const Dictionary &p_row_dict) {
 }
 
 bool SQLite::insert_rows(const String &p_name, const Array &p_row_array) {
-	query("BEGIN TRANSACTION;");
+	call_guard guard(this);
+	bool outermost;
+	if (!begin_helper_savepoint(outermost)) {
+		return false;
+	}
+	bool success = true;
 	int64_t number_of_rows = p_row_array.size();
 	for (int64_t i = 0; i <= number_of_rows - 1; i++) {
 		if (p_row_array[i].get_type() != Variant::DICTIONARY) {
 			ERR_PRINT("GDSQLite Error: All elements of the Array should be of type Dictionary");
-			/* Don't forget to close the transaction! */
-			/* Maybe we should do a rollback instead? */
-			query("END TRANSACTION;");
-			return false;
+			success = false;
+			break;
 		}
 		if (!insert_row(p_name, p_row_array[i])) {
-			/* Don't forget to close the transaction! */
-			/* Stop the error_message from being overwritten! */
-			String previous_error_message = error_message;
-			query("END TRANSACTION;");
-			error_message = previous_error_message;
-			return false;
+			success = false;
+			break;
 		}
 	}
-	query("END TRANSACTION;");
-	return true;
+	/* None of the rows are inserted if any of them fails */
+	return end_helper_savepoint(success, outermost);
 }
 
 Array SQLite::select_rows(const String &p_name, const String &p_conditions, const Array &p_columns_array) {
+	call_guard guard(this);
 	if (p_columns_array.is_empty()) {
 		ERR_PRINT("GDSQLite Error: The columns array cannot be empty (HINT: Use [\"*\"] to select all columns)");
-		return query_result;
+		return query_result.get();
 	}
 
 	int64_t number_of_columns = p_columns_array.size();
@@ -734,7 +1570,7 @@ Array SQLite::select_rows(const String &p_name, const String &p_conditions, cons
 	for (int64_t i = 0; i < number_of_columns; i++) {
 		if (p_columns_array[i].get_type() != Variant::STRING) {
 			ERR_PRINT("GDSQLite Error: All elements of the Array should be of type String");
-			return query_result;
+			return query_result.get();
 		}
 		key_strings[i] = (const String &)p_columns_array[i];
 	}
@@ -753,6 +1589,7 @@ Array SQLite::select_rows(const String &p_name, const String &p_conditions, cons
 }
 
 bool SQLite::update_rows(const String &p_name, const String &p_conditions, const Dictionary &p_updated_row_dict) {
+	call_guard guard(this);
 	Array param_bindings;
 	bool success;
 
@@ -776,16 +1613,16 @@ bool SQLite::update_rows(const String &p_name, const String &p_conditions, const
 	else {
 		query_string = vformat("UPDATE %s SET %s WHERE %s;", p_name, String(", ").join(key_strings), p_conditions);
 	}
-	query("BEGIN TRANSACTION;");
+	bool outermost;
+	if (!begin_helper_savepoint(outermost)) {
+		return false;
+	}
 	success = query_with_bindings(query_string, param_bindings);
-	/* Stop the error_message from being overwritten! */
-	String previous_error_message = error_message;
-	query("END TRANSACTION;");
-	error_message = previous_error_message;
-	return success;
+	return end_helper_savepoint(success, outermost);
 }
 
 bool SQLite::delete_rows(const String &p_name, const String &p_conditions) {
+	call_guard guard(this);
 	bool success;
 
 	String query_string;
@@ -797,13 +1634,403 @@ bool SQLite::delete_rows(const String &p_name, const String &p_conditions) {
 	else {
 		query_string = vformat("DELETE FROM %s WHERE %s;", p_name, p_conditions);
 	}
-	query("BEGIN TRANSACTION;");
+	bool outermost;
+	if (!begin_helper_savepoint(outermost)) {
+		return false;
+	}
 	success = query(query_string);
+	return end_helper_savepoint(success, outermost);
+}
+
+/*
+** Execute a statement that controls transactions or savepoints. These are
+** executed directly, as they don't return any rows and don't need bindings.
+*/
+bool SQLite::execute_transaction_statement(const String &p_statement) {
+	if (db == nullptr) {
+		ERR_PRINT("GDSQLite Error: Can't execute \"" + p_statement + "\" if connection is not open!");
+		return false;
+	}
+	if (verbosity_level > VerbosityLevel::NORMAL) {
+		UtilityFunctions::print(p_statement);
+	}
+	/* Explicit transactions and savepoints never become part of a write batch */
+	if (write_batch_open && helper_savepoint_depth == 0 && !on_thread_connection()) {
+		flush();
+	}
+
+	const CharString utf8_statement = p_statement.utf8();
+	int rc = sqlite3_exec(db, utf8_statement.get_data(), NULL, NULL, NULL);
+	if (rc != SQLITE_OK) {
+		error_message = String::utf8(sqlite3_errmsg(db));
+		ERR_PRINT(" --> SQL error: " + error_message);
+		return false;
+	}
+	error_message = "";
+	return true;
+}
+
+bool SQLite::begin(int64_t p_mode) {
+	call_guard guard(this);
+	switch (p_mode) {
+		case TRANSACTION_IMMEDIATE:
+			return execute_transaction_statement("BEGIN IMMEDIATE;");
+		case TRANSACTION_EXCLUSIVE:
+			return execute_transaction_statement("BEGIN EXCLUSIVE;");
+		default:
+			return execute_transaction_statement("BEGIN DEFERRED;");
+	}
+}
+
+bool SQLite::commit() {
+	call_guard guard(this);
+	return execute_transaction_statement("COMMIT;");
+}
+
+bool SQLite::rollback() {
+	call_guard guard(this);
+	return execute_transaction_statement("ROLLBACK;");
+}
+
+bool SQLite::savepoint(const String &p_name) {
+	call_guard guard(this);
+	if (!execute_transaction_statement("SAVEPOINT " + sanitize_identifier(p_name) + ";")) {
+		return false;
+	}
+	push_savepoint_marker(p_name);
+	return true;
+}
+
+bool SQLite::release(const String &p_name) {
+	call_guard guard(this);
+	if (!execute_transaction_statement("RELEASE " + sanitize_identifier(p_name) + ";")) {
+		return false;
+	}
+	release_savepoint_marker(p_name);
+	return true;
+}
+
+bool SQLite::rollback_to(const String &p_name) {
+	call_guard guard(this);
+	if (!execute_transaction_statement("ROLLBACK TO " + sanitize_identifier(p_name) + ";")) {
+		return false;
+	}
+	rollback_savepoint_marker(p_name);
+	return true;
+}
+
+/*
+** Take a snapshot of the current state of the database, which requires the
+** database to be in WAL mode. A read transaction is needed to do so, which is
+** started and ended here unless a read transaction is already open.
+*/
+Ref<SQLiteSnapshot> SQLite::snapshot_open(const String &p_database_name) {
+	call_guard guard(this);
+	if (db == nullptr) {
+		ERR_PRINT("GDSQLite Error: Can't take snapshot if connection is not open!");
+		return Ref<SQLiteSnapshot>();
+	}
+#ifdef SQLITE_ENABLE_SNAPSHOT
+	bool own_transaction = sqlite3_get_autocommit(db) || write_batch_open;
+	if (own_transaction) {
+		/* The transaction only starts reading once the database is accessed */
+		if (!execute_transaction_statement("BEGIN DEFERRED;") || !execute_transaction_statement("PRAGMA " + sanitize_identifier(p_database_name) + ".schema_version;")) {
+			if (!sqlite3_get_autocommit(db)) {
+				execute_transaction_statement("ROLLBACK;");
+			}
+			return Ref<SQLiteSnapshot>();
+		}
+	}
+
+	const CharString utf8_name = p_database_name.utf8();
+	sqlite3_snapshot *snapshot = nullptr;
+	int rc = sqlite3_snapshot_get(db, utf8_name.get_data(), &snapshot);
+	if (own_transaction) {
+		execute_transaction_statement("COMMIT;");
+	}
+	if (rc != SQLITE_OK) {
+		/* Fails for databases that aren't in WAL mode and inside of write transactions */
+		ERR_PRINT("GDSQLite Error: Can't take snapshot: " + String::utf8(sqlite3_errstr(rc)) + " (the database has to be in WAL mode and no write transaction can be open)");
+		return Ref<SQLiteSnapshot>();
+	}
+
+	Ref<SQLiteSnapshot> result;
+	result.instantiate();
+	result->snapshot = snapshot;
+	result->path = path;
+	result->database_name = p_database_name;
+	return result;
+#else
+	ERR_PRINT("GDSQLite Error: Snapshots require the plugin to be compiled with the `enable_snapshot` flag!");
+	return Ref<SQLiteSnapshot>();
+#endif
+}
+
+/*
+** Start a read transaction that sees the database exactly as it was when the
+** snapshot was taken, which is ended again with commit() or rollback(). This
+** fails if the WAL has been checkpointed past the snapshot in the meantime,
+** unless another connection kept a read transaction open on the snapshot.
+*/
+bool SQLite::begin_read_snapshot(const Ref<SQLiteSnapshot> &p_snapshot) {
+	call_guard guard(this);
+	if (db == nullptr) {
+		ERR_PRINT("GDSQLite Error: Can't begin read snapshot if connection is not open!");
+		return false;
+	}
+	if (p_snapshot.is_null() || p_snapshot->snapshot == nullptr) {
+		error_message = "The snapshot is invalid";
+		ERR_PRINT("GDSQLite Error: Can't begin read snapshot on an invalid snapshot!");
+		return false;
+	}
+	if (p_snapshot->path != path) {
+		error_message = "The snapshot was taken of a different database";
+		ERR_PRINT("GDSQLite Error: Can't begin read snapshot on a snapshot of a different database (" + p_snapshot->path + ")!");
+		return false;
+	}
+#ifdef SQLITE_ENABLE_SNAPSHOT
+	if (!execute_transaction_statement("BEGIN DEFERRED;")) {
+		return false;
+	}
+
+	const CharString utf8_name = p_snapshot->database_name.utf8();
+	int rc = sqlite3_snapshot_open(db, utf8_name.get_data(), p_snapshot->snapshot);
+	if (rc != SQLITE_OK) {
+		if (rc == SQLITE_ERROR_SNAPSHOT) {
+			error_message = "The snapshot has expired, as the write-ahead log has been checkpointed and restarted since it was taken";
+		} else {
+			error_message = String::utf8(sqlite3_errstr(rc));
+		}
+		ERR_PRINT("GDSQLite Error: Can't begin read snapshot: " + error_message);
+		execute_transaction_statement("ROLLBACK;");
+		return false;
+	}
+	return true;
+#else
+	ERR_PRINT("GDSQLite Error: Snapshots require the plugin to be compiled with the `enable_snapshot` flag!");
+	return false;
+#endif
+}
+
+/*
+** The helper functions wrap their statements in a savepoint, which starts a
+** transaction of its own when there isn't one yet and nests inside of the
+** transaction of the caller otherwise.
+*/
+bool SQLite::begin_helper_savepoint(bool &r_outermost) {
+	if (write_batching && db != nullptr && !on_thread_connection() && !begin_write_batch()) {
+		return false;
+	}
+	r_outermost = db == nullptr || sqlite3_get_autocommit(db);
+	helper_savepoint_depth.get()++;
+	if (!execute_transaction_statement("SAVEPOINT gdsqlite_helper;")) {
+		helper_savepoint_depth.get()--;
+		return false;
+	}
+	push_savepoint_marker("gdsqlite_helper");
+	return true;
+}
+
+/*
+** Keep the changes of the helper on success and undo all of them otherwise.
+** When the savepoint started the transaction, the whole transaction is rolled
+** back, such that the rollback hook discards any buffered change notifications.
+*/
+bool SQLite::end_helper_savepoint(bool p_success, bool p_outermost) {
+	if (p_success) {
+		bool released = execute_transaction_statement("RELEASE gdsqlite_helper;");
+		if (released) {
+			release_savepoint_marker("gdsqlite_helper");
+		}
+		helper_savepoint_depth.get()--;
+		return released;
+	}
+
 	/* Stop the error_message from being overwritten! */
 	String previous_error_message = error_message;
-	query("END TRANSACTION;");
+	if (sqlite3_get_autocommit(db)) {
+		/* Some errors already roll back the transaction automatically */
+	} else if (p_outermost) {
+		execute_transaction_statement("ROLLBACK;");
+	} else {
+		/* The pending changes are discarded before releasing, which might commit them otherwise */
+		if (execute_transaction_statement("ROLLBACK TO gdsqlite_helper;")) {
+			rollback_savepoint_marker("gdsqlite_helper");
+		}
+		if (execute_transaction_statement("RELEASE gdsqlite_helper;")) {
+			release_savepoint_marker("gdsqlite_helper");
+		}
+	}
+	helper_savepoint_depth.get()--;
 	error_message = previous_error_message;
-	return success;
+	return false;
+}
+
+/*
+** Returns true if the statement starts with the given keyword, ignoring case
+** and leading whitespace.
+*/
+static bool starts_with_keyword(const char *p_sql, const char *p_keyword) {
+	while (*p_sql == ' ' || *p_sql == '\t' || *p_sql == '\n' || *p_sql == '\r') {
+		p_sql++;
+	}
+	size_t length = strlen(p_keyword);
+	if (sqlite3_strnicmp(p_sql, p_keyword, (int)length) != 0) {
+		return false;
+	}
+	char next = p_sql[length];
+	return !((next >= 'a' && next <= 'z') || (next >= 'A' && next <= 'Z') || (next >= '0' && next <= '9') || next == '_');
+}
+
+/*
+** Called before executing every statement while write_batching is enabled.
+** Writes to the rows of tables are collected in the write batch, while
+** statements that control transactions or can't run inside of one commit
+** the batch first.
+*/
+bool SQLite::prepare_write_batch(sqlite3_stmt *p_stmt) {
+	const char *sql = sqlite3_sql(p_stmt);
+	bool read_only = sqlite3_stmt_readonly(p_stmt);
+	bool batchable = starts_with_keyword(sql, "INSERT") || starts_with_keyword(sql, "UPDATE") ||
+			starts_with_keyword(sql, "DELETE") || starts_with_keyword(sql, "REPLACE") ||
+			(starts_with_keyword(sql, "WITH") && !read_only);
+
+	if (!batchable) {
+		/* Transaction control, ATTACH, DETACH and most PRAGMAs are reported as read-only too, so only plain queries may read from the open batch */
+		bool plain_query = read_only && sqlite3_stmt_isexplain(p_stmt) == 0 &&
+				(starts_with_keyword(sql, "SELECT") || starts_with_keyword(sql, "VALUES") || starts_with_keyword(sql, "WITH"));
+		if (write_batch_open && helper_savepoint_depth == 0 && !plain_query) {
+			flush();
+		}
+		return true;
+	}
+
+	if (write_batch_open && helper_savepoint_depth == 0 && is_write_batch_full()) {
+		flush();
+	}
+	if (!begin_write_batch()) {
+		return false;
+	}
+	if (write_batch_open) {
+		write_batch_statement_count++;
+	}
+	return true;
+}
+
+/*
+** Start a new write batch, unless one is open already or the caller has a
+** transaction of its own, in which case the writes are part of that one.
+*/
+bool SQLite::begin_write_batch() {
+	if (write_batch_open && sqlite3_get_autocommit(db)) {
+		/* Some errors, such as SQLITE_FULL, roll back the transaction automatically */
+		finish_write_batch(false);
+	}
+	if (write_batch_open || !sqlite3_get_autocommit(db)) {
+		return true;
+	}
+
+	int rc = sqlite3_exec(db, "BEGIN;", NULL, NULL, NULL);
+	if (rc != SQLITE_OK) {
+		error_message = String::utf8(sqlite3_errmsg(db));
+		ERR_PRINT(" --> SQL error: " + error_message);
+		return false;
+	}
+	write_batch_open = true;
+	write_batch_statement_count = 0;
+	write_batch_start_ticks = Time::get_singleton()->get_ticks_msec();
+	if (!write_batch_flush_scheduled) {
+		write_batch_flush_scheduled = true;
+		callable_mp(this, &SQLite::flush_scheduled_write_batch).call_deferred();
+	}
+	return true;
+}
+
+bool SQLite::is_write_batch_full() const {
+	if (write_batch_size > 0 && write_batch_statement_count >= write_batch_size) {
+		return true;
+	}
+	return write_batch_msec > 0 && Time::get_singleton()->get_ticks_msec() - write_batch_start_ticks >= (uint64_t)write_batch_msec;
+}
+
+/*
+** Close the write batch and let everyone know whether its writes made it to
+** the database.
+*/
+void SQLite::finish_write_batch(bool p_success) {
+	int64_t statement_count = write_batch_statement_count;
+	write_batch_open = false;
+	write_batch_statement_count = 0;
+
+	/* Callbacks might write again, which starts a new batch with callbacks of its own */
+	std::vector<Callable> callbacks;
+	callbacks.swap(durability_callbacks);
+	for (const Callable &callback : callbacks) {
+		if (callback.is_valid()) {
+			callback.call(p_success);
+		}
+	}
+	emit_signal("write_batch_committed", p_success, statement_count);
+}
+
+void SQLite::flush_scheduled_write_batch() {
+	write_batch_flush_scheduled = false;
+	if (write_batch_open) {
+		flush();
+	}
+}
+
+/*
+** Commit all batched writes right away. A busy database keeps the batch open,
+** in which case the commit is retried on the next idle frame.
+*/
+bool SQLite::flush() {
+	call_guard guard(this, false);
+	/* The write batch belongs to the main connection */
+	if (!write_batch_open || on_thread_connection()) {
+		return true;
+	}
+	if (sqlite3_get_autocommit(db)) {
+		error_message = "The write batch was rolled back by an earlier error";
+		ERR_PRINT("GDSQLite Error: " + error_message);
+		finish_write_batch(false);
+		return false;
+	}
+
+	int rc = sqlite3_exec(db, "COMMIT;", NULL, NULL, NULL);
+	if (rc == SQLITE_BUSY) {
+		error_message = String::utf8(sqlite3_errmsg(db));
+		if (!write_batch_flush_scheduled) {
+			write_batch_flush_scheduled = true;
+			callable_mp(this, &SQLite::flush_scheduled_write_batch).call_deferred();
+		}
+		return false;
+	}
+	if (rc != SQLITE_OK) {
+		error_message = String::utf8(sqlite3_errmsg(db));
+		ERR_PRINT(" --> SQL error: " + error_message);
+		if (!sqlite3_get_autocommit(db)) {
+			sqlite3_exec(db, "ROLLBACK;", NULL, NULL, NULL);
+		}
+		finish_write_batch(false);
+		return false;
+	}
+	finish_write_batch(true);
+	return true;
+}
+
+/*
+** Call the callable with true once all writes made so far are committed, or
+** with false if they were rolled back instead. Without any batched writes,
+** the callable is called immediately.
+*/
+void SQLite::call_when_durable(const Callable &p_callable) {
+	call_guard guard(this, false);
+	if (!write_batch_open) {
+		p_callable.call(true);
+		return;
+	}
+	durability_callbacks.push_back(p_callable);
 }
 
 static void function_callback(sqlite3_context *context, int argc, sqlite3_value **argv) {
@@ -891,6 +2118,7 @@ static void function_callback(sqlite3_context *context, int argc, sqlite3_value
 }
 
 bool SQLite::create_function(const String &p_name, const Callable &p_callable, int p_argc) {
+	call_guard guard(this, false);
 	/* The exact memory position of the std::vector's elements changes during memory reallocation (= when adding additional elements) */
 	/* Luckily, the pointer to the managed object (of the std::unique_ptr) won't change during execution! (= consistent) */
 	/* The std::unique_ptr is stored in a std::vector and is thus allocated on the heap */
@@ -920,6 +2148,7 @@ bool SQLite::create_function(const String &p_name, const Callable &p_callable, i
 }
 
 bool SQLite::import_from_json(String import_path) {
+	call_guard guard(this);
 	/* Add .json to the import_path String if not present */
 	String ending = String(".json");
 	if (!import_path.ends_with(ending)) {
@@ -927,31 +2156,20 @@ bool SQLite::import_from_json(String import_path) {
 	}
 	/* Find the real path */
 	import_path = ProjectSettings::get_singleton()->globalize_path(import_path.strip_edges());
-	CharString dummy_path = import_path.utf8();
-	const char *char_path = dummy_path.get_data();
 
-	/* Open the json-file and stream its content into a stringstream */
-	std::ifstream ifs(char_path);
-	if (ifs.fail()) {
-		ERR_PRINT("GDSQLite Error: " + String(std::strerror(errno)) + " (" + import_path + ")");
+	Ref<FileAccess> file = FileAccess::open(import_path, FileAccess::READ);
+	if (file.is_null()) {
+		ERR_PRINT("GDSQLite Error: Can't open file for reading, error code " + String::num_int64(FileAccess::get_open_error()) + " (" + import_path + ")");
 		return false;
 	}
 
-	std::stringstream buffer;
-	buffer << ifs.rdbuf();
-	std::string str = buffer.str();
-	ifs.close();
-
-	String json_string = String::utf8(str.c_str());
-	PackedByteArray json_buffer = json_string.to_utf8_buffer();
-
-	return import_from_buffer(json_buffer);
+	/* The file is parsed incrementally, so it never has to be loaded in memory as a whole */
+	gdsqlite_json_reader reader(file);
+	return import_json(reader);
 }
 
-bool SQLite::export_to_json(String export_path) {
-	PackedByteArray json_buffer = export_to_buffer();
-	String json_string = json_buffer.get_string_from_utf8();
-
+bool SQLite::export_to_json(String export_path, bool p_compact) {
+	call_guard guard(this);
 	/* Add .json to the import_path String if not present */
 	String ending = String(".json");
 	if (!export_path.ends_with(ending)) {
@@ -959,255 +2177,1450 @@ bool SQLite::export_to_json(String export_path) {
 	}
 	/* Find the real path */
 	export_path = ProjectSettings::get_singleton()->globalize_path(export_path.strip_edges());
-	CharString dummy_path = export_path.utf8();
-	const char *char_path = dummy_path.get_data();
 
-	std::ofstream ofs(char_path, std::ios::trunc);
-	if (ofs.fail()) {
-		ERR_PRINT("GDSQLite Error: " + String(std::strerror(errno)) + " (" + export_path + ")");
+	Ref<FileAccess> file = FileAccess::open(export_path, FileAccess::WRITE);
+	if (file.is_null()) {
+		ERR_PRINT("GDSQLite Error: Can't open file for writing, error code " + String::num_int64(FileAccess::get_open_error()) + " (" + export_path + ")");
 		return false;
 	}
 
-	CharString dummy_string = json_string.utf8();
-	ofs << dummy_string.get_data();
-	ofs.close();
+	/* Rows are streamed straight to the file instead of building the whole document first */
+	gdsqlite_json_writer writer(file, p_compact);
+	if (!write_json(writer)) {
+		return false;
+	}
+	if (!writer.finish()) {
+		ERR_PRINT("GDSQLite Error: Failed to write to file (" + export_path + ")");
+		return false;
+	}
 
 	return true;
 }
 
 bool SQLite::import_from_buffer(PackedByteArray json_buffer) {
-	/* Attempt to parse the input json_string and, if unsuccessful, throw a parse error specifying the erroneous line */
-
-	Ref<JSON> json;
-	json.instantiate();
-	String json_string = json_buffer.get_string_from_utf8();
-	Error error = json->parse(json_string);
-	if (error != Error::OK) {
-		/* Throw a parsing error */
-		ERR_PRINT("GDSQLite Error: parsing failed! reason: " + json->get_error_message() + ", at line: " + String::num_int64(json->get_error_line()));
+	call_guard guard(this);
+	if (json_buffer.is_empty()) {
+		ERR_PRINT("GDSQLite Error: Can't import from an empty buffer!");
 		return false;
 	}
-	Array database_array = json->get_data();
+	gdsqlite_json_reader reader(json_buffer.ptr(), json_buffer.size());
+	return import_json(reader);
+}
+
+static void print_json_parse_error(const gdsqlite_json_reader &p_reader, const String &p_reason) {
+	ERR_PRINT("GDSQLite Error: parsing failed! reason: " + p_reason + ", at line: " + String::num_int64(p_reader.get_line()));
+}
+
+/*
+** Import the JSON document in two passes: the first pass validates the
+** document and collects the schema, while the second pass streams the rows
+** into the freshly created tables. Indexes, views and triggers are only
+** created once all rows are in place, which avoids updating the indexes for
+** every single row and stops triggers from firing during the import.
+*/
+bool SQLite::import_json(gdsqlite_json_reader &p_reader) {
 	std::vector<object_struct> objects_to_import;
-	/* Validate the json structure and populate the tables_to_import vector */
-	if (!validate_json(database_array, objects_to_import)) {
+	if (!read_json_schema(p_reader, objects_to_import)) {
 		return false;
 	}
 
-	/* Check if the database is open and, if not, attempt to open it */
-	if (db == nullptr) {
-		/* Open the database using the open_db method */
-		if (!open_db()) {
-			return false;
-		}
-	}
-
-	/* Find all views that are present in this database */
-	query(String("SELECT name FROM sqlite_master WHERE type = 'view';"));
-	TypedArray<Dictionary> old_view_array = query_result.duplicate(true);
-	int64_t old_number_of_views = old_view_array.size();
-	/* Drop all old views present in the database */
-	for (int64_t i = 0; i <= old_number_of_views - 1; i++) {
-		Dictionary view_dict = old_view_array[i];
-		String view_name = view_dict["name"];
-		String query_string = "DROP VIEW " + view_name + ";";
-
-		query(query_string);
+	/* Clearing and importing happen in a single savepoint, so a failed import leaves the database untouched */
+	if (db == nullptr && !open_db()) {
+		return false;
 	}
-
-	/* Find all tables that are present in this database */
-	/* We don't care about indexes or triggers here since they get dropped automatically when their table is dropped */
-	query(String("SELECT name,type FROM sqlite_master WHERE type = 'table' AND name NOT LIKE 'sqlite_%';"));
-	TypedArray<Dictionary> old_table_array = query_result.duplicate(true);
-#ifdef SQLITE_ENABLE_FTS5
-	/* FTS5 creates a bunch of shadow tables that cannot be dropped manually! */
-	/* The virtual table is responsible for dropping these tables itself */
-	remove_shadow_tables(old_table_array);
-#endif
-	int64_t old_number_of_tables = old_table_array.size();
-	/* Drop all old tables present in the database */
-	for (int64_t i = 0; i <= old_number_of_tables - 1; i++) {
-		Dictionary table_dict = old_table_array[i];
-		String table_name = sanitize_identifier(table_dict["name"]);
-
-		drop_table(table_name);
+	bool outermost;
+	if (!begin_helper_savepoint(outermost)) {
+		return false;
 	}
-
-	query("BEGIN TRANSACTION;");
 	/* foreign_keys cannot be enforced until after all rows have been added! */
 	query("PRAGMA defer_foreign_keys=on;");
-	/* Add all new tables and fill them up with all the rows */
-	for (auto table : objects_to_import) {
-		if (!query(table.sql)) {
-			/* Don't forget to close the transaction! */
-			/* Stop the error_message from being overwritten! */
-			String previous_error_message = error_message;
-			query("END TRANSACTION;");
-			error_message = previous_error_message;
+
+	bool success = clear_database();
+	for (const object_struct &object : objects_to_import) {
+		if (!success) {
+			break;
+		}
+		if (object.type == TABLE && !query(object.sql)) {
+			success = false;
 		}
 	}
 
-	for (auto object : objects_to_import) {
-		if (object.type != TABLE) {
-			/* The object is an index, view or trigger and doesn't have any rows! */
-			continue;
+	success = success && import_json_rows(p_reader, objects_to_import);
+
+	for (const object_struct &object : objects_to_import) {
+		if (!success) {
+			break;
+		}
+		if (object.type != TABLE && !object.sql.is_empty()) {
+			success = query(object.sql);
 		}
+	}
 
-		/* Convert the base64-encoded columns back to raw data */
-		for (int64_t i = 0; i <= object.base64_columns.size() - 1; i++) {
-			String key = object.base64_columns[i];
-			for (int64_t j = 0; j <= object.row_array.size() - 1; j++) {
-				Dictionary row = object.row_array[j];
+	/* Only a complete import is kept, anything else is rolled back */
+	return end_helper_savepoint(success, outermost);
+}
 
-				if (row.has(key)) {
-					String encoded_string = ((const String &)row[key]);
-					PackedByteArray arr = Marshalls::get_singleton()->base64_to_raw(encoded_string);
-					row[key] = arr;
+/*
+** First pass: validate the structure of the document and collect the name,
+** sql, type and base64_columns of every object. Rows are skipped entirely.
+*/
+bool SQLite::read_json_schema(gdsqlite_json_reader &p_reader, std::vector<object_struct> &r_objects) {
+	if (p_reader.next() != JSON_BEGIN_ARRAY) {
+		print_json_parse_error(p_reader, "Expected an array of objects");
+		return false;
+	}
+
+	JSON_TOKEN token;
+	while ((token = p_reader.next()) == JSON_BEGIN_OBJECT) {
+		object_struct new_object;
+		bool has_name = false;
+		bool has_sql = false;
+		bool has_row_array = false;
+		String type;
+
+		while ((token = p_reader.next()) == JSON_STRING) {
+			std::string key = p_reader.get_string();
+			token = p_reader.next();
+
+			if (key == "name" || key == "type" || (key == "sql" && token != JSON_NULL)) {
+				if (token != JSON_STRING) {
+					ERR_PRINT("GDSQlite Error: The value of the key \"" + String::utf8(key.c_str()) + "\" should be a string");
+					return false;
+				}
+				String value = String::utf8(p_reader.get_string().c_str(), p_reader.get_string().length());
+				if (key == "name") {
+					new_object.name = value;
+					has_name = true;
+				} else if (key == "sql") {
+					new_object.sql = value;
+					has_sql = true;
+				} else {
+					type = value;
+				}
+			} else if (key == "sql") {
+				/* Objects that are created implicitly, such as autoindexes, don't have a sql template */
+				has_sql = true;
+			} else if (key == "base64_columns") {
+				if (token != JSON_BEGIN_ARRAY) {
+					ERR_PRINT("GDSQlite Error: The value of the key \"base64_columns\" should consist of an array of column names");
+					return false;
+				}
+				while ((token = p_reader.next()) == JSON_STRING) {
+					new_object.base64_columns.insert(p_reader.get_string());
+				}
+				if (token != JSON_END_ARRAY) {
+					print_json_parse_error(p_reader, "Expected the end of the base64_columns array");
+					return false;
+				}
+			} else if (key == "row_array") {
+				if (token != JSON_BEGIN_ARRAY) {
+					ERR_PRINT("GDSQlite Error: The value of the key \"row_array\" should consist of an array of rows");
+					return false;
+				}
+				has_row_array = true;
+				if (!p_reader.skip_value(token)) {
+					print_json_parse_error(p_reader, "Unexpected end of the row_array array");
+					return false;
+				}
+			} else if (!p_reader.skip_value(token)) {
+				print_json_parse_error(p_reader, "Invalid value for key \"" + String::utf8(key.c_str()) + "\"");
+				return false;
+			}
+		}
+		if (token != JSON_END_OBJECT) {
+			print_json_parse_error(p_reader, "Expected a key or the end of the object");
+			return false;
+		}
+
+		if (!has_name) {
+			/* Did not find the necessary key! */
+			ERR_PRINT("GDSQlite Error: Did not find required key \"name\" in the supplied json-file");
+			return false;
+		}
+		if (!has_sql) {
+			/* Did not find the necessary key! */
+			ERR_PRINT("GDSQlite Error: Did not find required key \"sql\" in the supplied json-file");
+			return false;
+		}
+
+		if (type == "table") {
+			new_object.type = TABLE;
+			if (!has_row_array) {
+				/* Did not find the necessary key! */
+				ERR_PRINT("GDSQlite Error: Did not find required key \"row_array\" in the supplied json-file");
+				return false;
+			}
+		} else if (type == "index") {
+			new_object.type = INDEX;
+		} else if (type == "view") {
+			new_object.type = VIEW;
+		} else if (type == "trigger") {
+			new_object.type = TRIGGER;
+		} else if (type.is_empty()) {
+			/* Did not find the necessary key! */
+			ERR_PRINT("GDSQlite Error: Did not find required key \"type\" in the supplied json-file");
+			return false;
+		} else {
+			ERR_PRINT("GDSQlite Error: The value of key \"type\" is restricted to \"table\", \"index\", \"view\" or \"trigger\"");
+			return false;
+		}
+
+		r_objects.push_back(new_object);
+	}
+
+	if (token != JSON_END_ARRAY) {
+		print_json_parse_error(p_reader, "Expected an object or the end of the array");
+		return false;
+	}
+	return true;
+}
+
+/*
+** Second pass: go through the document again and insert the rows of every
+** table. The structure was already validated during the first pass.
+*/
+bool SQLite::import_json_rows(gdsqlite_json_reader &p_reader, const std::vector<object_struct> &p_objects) {
+	p_reader.rewind();
+	p_reader.next();
+
+	for (const object_struct &object : p_objects) {
+		p_reader.next();
+
+		JSON_TOKEN token;
+		while ((token = p_reader.next()) == JSON_STRING) {
+			bool is_row_array = p_reader.get_string() == "row_array";
+			token = p_reader.next();
+			if (is_row_array && object.type == TABLE) {
+				if (!import_json_table_rows(p_reader, object)) {
+					return false;
+				}
+			} else if (!p_reader.skip_value(token)) {
+				print_json_parse_error(p_reader, "The document changed while it was being imported");
+				return false;
+			}
+		}
+	}
+	return true;
+}
+
+/*
+** Insert all rows of the row_array that the reader is positioned in. Every
+** distinct set of columns gets its own prepared statement, which is reused
+** for all following rows with the same columns.
+*/
+bool SQLite::import_json_table_rows(gdsqlite_json_reader &p_reader, const object_struct &p_object) {
+	std::unordered_map<std::string, sqlite3_stmt *> statements;
+	std::vector<cell_struct> cells;
+	std::string signature;
+	String table_name = sanitize_identifier(p_object.name);
+
+	bool success = true;
+	JSON_TOKEN token;
+	while (success && (token = p_reader.next()) == JSON_BEGIN_OBJECT) {
+		/* Read the complete row first, as the statement depends on its columns */
+		size_t column_count = 0;
+		signature.clear();
+		while ((token = p_reader.next()) == JSON_STRING) {
+			if (column_count == cells.size()) {
+				cells.emplace_back();
+			}
+			cell_struct &cell = cells[column_count++];
+			cell.column = p_reader.get_string();
+			signature += cell.column;
+			signature += '\0';
+
+			cell.token = p_reader.next();
+			if (cell.token == JSON_STRING) {
+				cell.text = p_reader.get_string();
+				cell.is_blob = p_object.base64_columns.count(cell.column) > 0;
+				if (cell.is_blob && !gdsqlite_base64_decode(cell.text.data(), cell.text.length(), cell.blob)) {
+					print_json_parse_error(p_reader, "Invalid base64 value for column \"" + String::utf8(cell.column.c_str()) + "\" of table \"" + p_object.name + "\"");
+					success = false;
+					break;
+				}
+			} else if (cell.token == JSON_INTEGER) {
+				cell.integer = p_reader.get_integer();
+			} else if (cell.token == JSON_REAL) {
+				cell.real = p_reader.get_real();
+			} else if (cell.token != JSON_TRUE && cell.token != JSON_FALSE && cell.token != JSON_NULL) {
+				print_json_parse_error(p_reader, "Unsupported value for column \"" + String::utf8(cell.column.c_str()) + "\" of table \"" + p_object.name + "\"");
+				success = false;
+				break;
+			}
+		}
+		if (!success) {
+			break;
+		}
+		if (token != JSON_END_OBJECT) {
+			print_json_parse_error(p_reader, "Expected a key or the end of the row");
+			success = false;
+			break;
+		}
+
+		sqlite3_stmt *stmt;
+		auto it = statements.find(signature);
+		if (it != statements.end()) {
+			stmt = it->second;
+		} else {
+			String query_string;
+			if (column_count == 0) {
+				query_string = vformat("INSERT INTO %s DEFAULT VALUES;", table_name);
+			} else {
+				PackedStringArray key_strings;
+				PackedStringArray value_strings;
+				for (size_t i = 0; i < column_count; i++) {
+					key_strings.append(sanitize_identifier(String::utf8(cells[i].column.c_str())));
+					value_strings.append("?");
+				}
+				query_string = vformat("INSERT INTO %s (%s) VALUES (%s);", table_name, String(", ").join(key_strings), String(", ").join(value_strings));
+			}
+			const CharString dummy_query = query_string.utf8();
+			if (!prepare_statement(dummy_query, &stmt, nullptr)) {
+				success = false;
+				break;
+			}
+			statements.emplace(signature, stmt);
+		}
+
+		for (size_t i = 0; i < column_count; i++) {
+			const cell_struct &cell = cells[i];
+			int index = (int)i + 1;
+			switch (cell.token) {
+				case JSON_STRING:
+					if (cell.is_blob) {
+						sqlite3_bind_blob64(stmt, index, cell.blob.data(), cell.blob.size(), SQLITE_STATIC);
+					} else {
+						sqlite3_bind_text64(stmt, index, cell.text.data(), cell.text.length(), SQLITE_STATIC, SQLITE_UTF8);
+					}
+					break;
+				case JSON_INTEGER:
+					sqlite3_bind_int64(stmt, index, cell.integer);
+					break;
+				case JSON_REAL:
+					sqlite3_bind_double(stmt, index, cell.real);
+					break;
+				case JSON_TRUE:
+				case JSON_FALSE:
+					sqlite3_bind_int(stmt, index, cell.token == JSON_TRUE);
+					break;
+				default:
+					sqlite3_bind_null(stmt, index);
+					break;
+			}
+		}
+
+		int rc = sqlite3_step(stmt);
+		sqlite3_reset(stmt);
+		if (rc != SQLITE_DONE) {
+			update_error_message(rc);
+			ERR_PRINT(" --> SQL error: " + error_message);
+			success = false;
+		}
+	}
+
+	if (success && token != JSON_END_ARRAY) {
+		print_json_parse_error(p_reader, "Expected a row or the end of the row_array array");
+		success = false;
+	}
+
+	for (auto &statement : statements) {
+		sqlite3_finalize(statement.second);
+	}
+	return success;
+}
+
+PackedByteArray SQLite::export_to_buffer(bool p_compact) {
+	call_guard guard(this);
+	PackedByteArray json_buffer;
+	gdsqlite_json_writer writer(Ref<FileAccess>(), p_compact);
+	if (!write_json(writer)) {
+		return json_buffer;
+	}
+
+	const std::string &buffer = writer.get_buffer();
+	json_buffer.resize(buffer.size());
+	memcpy(json_buffer.ptrw(), buffer.data(), buffer.size());
+	return json_buffer;
+}
+
+/*
+** Write the value of a single column of the current row of the statement.
+** The storage class of every cell decides how it's encoded, as SQLite doesn't
+** enforce the declared type of a column. Blobs are base64-encoded, in which
+** case the column is marked so it can be listed in the "base64_columns" of
+** the table.
+*/
+static void write_json_column(gdsqlite_json_writer &p_writer, sqlite3_stmt *p_stmt, int p_column, std::vector<bool> &r_base64_columns) {
+	switch (sqlite3_column_type(p_stmt, p_column)) {
+		case SQLITE_INTEGER:
+			p_writer.int_value(sqlite3_column_int64(p_stmt, p_column));
+			break;
+
+		case SQLITE_FLOAT:
+			p_writer.real_value(sqlite3_column_double(p_stmt, p_column));
+			break;
+
+		case SQLITE_TEXT:
+			p_writer.string_value(reinterpret_cast<const char *>(sqlite3_column_text(p_stmt, p_column)), sqlite3_column_bytes(p_stmt, p_column));
+			break;
+
+		case SQLITE_BLOB:
+			p_writer.base64_value(reinterpret_cast<const uint8_t *>(sqlite3_column_blob(p_stmt, p_column)), sqlite3_column_bytes(p_stmt, p_column));
+			r_base64_columns[p_column] = true;
+			break;
+
+		default:
+			p_writer.null_value();
+			break;
+	}
+}
+
+/*
+** Write a single object of the schema to the writer, including all of its
+** rows if it's a table. The rows are stepped through one at a time and are
+** handed to the writer immediately. Only the given connection is used, such
+** that tables can also be written by worker threads with connections of
+** their own.
+*/
+static bool write_json_object(sqlite3 *p_db, gdsqlite_json_writer &p_writer, const export_object_struct &p_object, String &r_error) {
+	p_writer.begin_object();
+	p_writer.key("name");
+	p_writer.string_value(p_object.name);
+	p_writer.key("sql");
+	if (p_object.has_sql) {
+		p_writer.string_value(p_object.sql);
+	} else {
+		p_writer.null_value();
+	}
+	p_writer.key("type");
+	p_writer.string_value(p_object.type);
+
+	if (p_object.type != "table") {
+		p_writer.end_object();
+		return true;
+	}
+
+	String query_string = vformat("SELECT * FROM %s;", SQLite::sanitize_identifier(p_object.name));
+	const CharString dummy_query = query_string.utf8();
+	sqlite3_stmt *stmt;
+	int rc = sqlite3_prepare_v2(p_db, dummy_query.get_data(), -1, &stmt, nullptr);
+	if (rc != SQLITE_OK) {
+		r_error = String::utf8(sqlite3_errmsg(p_db));
+		p_writer.end_object();
+		return false;
+	}
+
+	int column_count = sqlite3_column_count(stmt);
+	std::vector<bool> base64_columns(column_count, false);
+
+	p_writer.key("row_array");
+	p_writer.begin_array();
+	while ((rc = sqlite3_step(stmt)) == SQLITE_ROW) {
+		p_writer.begin_object();
+		for (int column = 0; column < column_count; column++) {
+			p_writer.key(sqlite3_column_name(stmt, column));
+			write_json_column(p_writer, stmt, column, base64_columns);
+		}
+		p_writer.end_object();
+	}
+	p_writer.end_array();
+
+	if (rc != SQLITE_DONE) {
+		r_error = String::utf8(sqlite3_errmsg(p_db));
+	}
+
+	/* Only known after all rows have been written, so this key comes last */
+	if (std::find(base64_columns.begin(), base64_columns.end(), true) != base64_columns.end()) {
+		p_writer.key("base64_columns");
+		p_writer.begin_array();
+		for (int column = 0; column < column_count; column++) {
+			if (base64_columns[column]) {
+				const char *column_name = sqlite3_column_name(stmt, column);
+				p_writer.string_value(column_name, strlen(column_name));
+			}
+		}
+		p_writer.end_array();
+	}
+	sqlite3_finalize(stmt);
+
+	p_writer.end_object();
+	return rc == SQLITE_DONE;
+}
+
+/*
+** Write the schema and the contents of all tables to the writer, so the
+** database never has to be held in memory as a whole. All tables are read
+** inside of a single savepoint to get a consistent view. When tables are
+** exported in parallel, each table is written to a fragment of its own first,
+** after which the fragments are inserted in their original order.
+*/
+bool SQLite::write_json(gdsqlite_json_writer &p_writer) {
+	if (db == nullptr) {
+		ERR_PRINT("GDSQLite Error: Can't export database if connection is not open!");
+		return false;
+	}
+
+	bool parallel = can_export_in_parallel();
+	sqlite3_exec(db, "SAVEPOINT gdsqlite_export;", NULL, NULL, NULL);
+
+	std::vector<export_object_struct> objects;
+	bool success = get_exported_objects(objects);
+	if (success && parallel) {
+		success = run_parallel_export(objects, false, p_writer.is_compact());
+	}
+
+	if (success) {
+		p_writer.begin_array();
+		for (export_object_struct &object : objects) {
+			if (parallel && object.type == "table") {
+				p_writer.raw_value(object.json);
+				object.json = std::string();
+				continue;
+			}
+			String object_error;
+			if (!write_json_object(db, p_writer, object, object_error)) {
+				error_message = object_error;
+				ERR_PRINT(" --> SQL error: " + error_message);
+				success = false;
+				break;
+			}
+		}
+		p_writer.end_array();
+	}
+
+	sqlite3_exec(db, "RELEASE gdsqlite_export;", NULL, NULL, NULL);
+	return success;
+}
+
+static bool object_type_from_string(const String &p_type, OBJECT_TYPE &r_type) {
+	if (p_type == "table") {
+		r_type = TABLE;
+	} else if (p_type == "index") {
+		r_type = INDEX;
+	} else if (p_type == "view") {
+		r_type = VIEW;
+	} else if (p_type == "trigger") {
+		r_type = TRIGGER;
+	} else {
+		return false;
+	}
+	return true;
+}
+
+PackedByteArray SQLite::export_to_binary(bool p_compress) {
+	call_guard guard(this);
+	PackedByteArray binary_buffer;
+	if (db == nullptr) {
+		ERR_PRINT("GDSQLite Error: Can't export database if connection is not open!");
+		return binary_buffer;
+	}
+
+	bool parallel = can_export_in_parallel();
+	sqlite3_exec(db, "SAVEPOINT gdsqlite_export;", NULL, NULL, NULL);
+
+	std::vector<export_object_struct> objects;
+	bool success = get_exported_objects(objects);
+	if (success && parallel) {
+		success = run_parallel_export(objects, true, false);
+	}
+
+	gdsqlite_binary_writer payload;
+	payload.put_u32(objects.size());
+	for (size_t i = 0; i < objects.size() && success; i++) {
+		export_object_struct &object = objects[i];
+		OBJECT_TYPE type;
+		if (!object_type_from_string(object.type, type)) {
+			ERR_PRINT("GDSQLite Error: Unknown object type \"" + object.type + "\"");
+			success = false;
+			break;
+		}
+
+		payload.put_u8(type);
+		payload.put_string(object.name);
+		if (object.has_sql) {
+			payload.put_string(object.sql);
+		} else {
+			payload.put_u32(BINARY_NULL_LENGTH);
+		}
+
+		if (type != TABLE) {
+			continue;
+		}
+		if (parallel) {
+			payload.append(object.binary);
+			object.binary = gdsqlite_binary_writer();
+			continue;
+		}
+		String object_error;
+		if (!write_binary_table(db, payload, object.name, object_error)) {
+			error_message = object_error;
+			ERR_PRINT(" --> SQL error: " + error_message);
+			success = false;
+		}
+	}
+
+	sqlite3_exec(db, "RELEASE gdsqlite_export;", NULL, NULL, NULL);
+	if (!success) {
+		return binary_buffer;
+	}
+
+	gdsqlite_binary_writer header;
+	header.put_bytes(BINARY_MAGIC, BINARY_MAGIC_SIZE);
+	if (p_compress) {
+		PackedByteArray uncompressed;
+		uncompressed.resize(payload.size());
+		memcpy(uncompressed.ptrw(), payload.data(), payload.size());
+		PackedByteArray compressed = uncompressed.compress(FileAccess::COMPRESSION_ZSTD);
+
+		header.put_u8(FileAccess::COMPRESSION_ZSTD);
+		header.put_u64(payload.size());
+		binary_buffer.resize(header.size() + compressed.size());
+		memcpy(binary_buffer.ptrw(), header.data(), header.size());
+		memcpy(binary_buffer.ptrw() + header.size(), compressed.ptr(), compressed.size());
+	} else {
+		header.put_u8(BINARY_UNCOMPRESSED);
+		header.put_u64(payload.size());
+		binary_buffer.resize(header.size() + payload.size());
+		memcpy(binary_buffer.ptrw(), header.data(), header.size());
+		memcpy(binary_buffer.ptrw() + header.size(), payload.data(), payload.size());
+	}
+	return binary_buffer;
+}
+
+/*
+** Write the columns and all rows of a table. Rows are gathered in groups of
+** BINARY_ROW_GROUP_SIZE, of which every column is written as a single block.
+** Like write_json_object(), only the given connection is used.
+*/
+bool SQLite::write_binary_table(sqlite3 *p_db, gdsqlite_binary_writer &p_writer, const String &p_name, String &r_error) {
+	String query_string = vformat("SELECT * FROM %s;", sanitize_identifier(p_name));
+	const CharString dummy_query = query_string.utf8();
+	sqlite3_stmt *stmt;
+	if (sqlite3_prepare_v2(p_db, dummy_query.get_data(), -1, &stmt, nullptr) != SQLITE_OK) {
+		r_error = String::utf8(sqlite3_errmsg(p_db));
+		return false;
+	}
+
+	int column_count = sqlite3_column_count(stmt);
+	p_writer.put_u32(column_count);
+	for (int column = 0; column < column_count; column++) {
+		const char *column_name = sqlite3_column_name(stmt, column);
+		p_writer.put_string(column_name, strlen(column_name));
+	}
+
+	std::vector<std::vector<uint8_t>> storage_classes(column_count);
+	std::vector<gdsqlite_binary_writer> values(column_count);
+	uint32_t row_count = 0;
+
+	auto write_row_group = [&]() {
+		p_writer.put_u32(row_count);
+		for (int column = 0; column < column_count; column++) {
+			p_writer.put_bytes(storage_classes[column].data(), row_count);
+			p_writer.put_u64(values[column].size());
+			p_writer.append(values[column]);
+			storage_classes[column].clear();
+			values[column].clear();
+		}
+		row_count = 0;
+	};
+
+	int rc;
+	while ((rc = sqlite3_step(stmt)) == SQLITE_ROW) {
+		for (int column = 0; column < column_count; column++) {
+			int storage_class = sqlite3_column_type(stmt, column);
+			storage_classes[column].push_back(storage_class);
+			switch (storage_class) {
+				case SQLITE_INTEGER:
+					values[column].put_u64((uint64_t)sqlite3_column_int64(stmt, column));
+					break;
+				case SQLITE_FLOAT:
+					values[column].put_double(sqlite3_column_double(stmt, column));
+					break;
+				case SQLITE_TEXT:
+					values[column].put_string(reinterpret_cast<const char *>(sqlite3_column_text(stmt, column)), sqlite3_column_bytes(stmt, column));
+					break;
+				case SQLITE_BLOB:
+					values[column].put_string(reinterpret_cast<const char *>(sqlite3_column_blob(stmt, column)), sqlite3_column_bytes(stmt, column));
+					break;
+				default:
+					break;
+			}
+		}
+		if (++row_count == BINARY_ROW_GROUP_SIZE) {
+			write_row_group();
+		}
+	}
+
+	if (rc != SQLITE_DONE) {
+		r_error = String::utf8(sqlite3_errmsg(p_db));
+		sqlite3_finalize(stmt);
+		return false;
+	}
+	if (row_count > 0) {
+		write_row_group();
+	}
+	/* An empty row group marks the end of the table */
+	p_writer.put_u32(0);
+
+	sqlite3_finalize(stmt);
+	return true;
+}
+
+/*
+** Tables can only be exported in parallel when all connections are
+** guaranteed to see the same state of the database. This is the case when
+** this connection holds a read transaction in rollback journal mode, which
+** blocks all writers until the export completes. In WAL mode, writers aren't
+** blocked by readers and every connection could end up seeing a different
+** state, while uncommitted changes of this connection aren't visible to
+** other connections at all. The state of the export is shared by all calls,
+** so only the main connection exports in parallel.
+*/
+bool SQLite::can_export_in_parallel() {
+	if (export_thread_count <= 1 || path.find(":memory:") != -1 || on_thread_connection() || !sqlite3_get_autocommit(db)) {
+		return false;
+	}
+
+	sqlite3_stmt *stmt;
+	if (sqlite3_prepare_v2(db, "PRAGMA journal_mode;", -1, &stmt, nullptr) != SQLITE_OK) {
+		return false;
+	}
+	bool wal = false;
+	if (sqlite3_step(stmt) == SQLITE_ROW) {
+		const char *journal_mode = reinterpret_cast<const char *>(sqlite3_column_text(stmt, 0));
+		wal = journal_mode && sqlite3_stricmp(journal_mode, "wal") == 0;
+	}
+	sqlite3_finalize(stmt);
+	return !wal;
+}
+
+/*
+** Export all tables of the objects on the WorkerThreadPool, using up to
+** export_thread_count read-only connections to the same database file. The
+** output of every table is stored in its export_object_struct.
+*/
+bool SQLite::run_parallel_export(std::vector<export_object_struct> &r_objects, bool p_binary, bool p_compact) {
+	export_table_indices.clear();
+	for (size_t i = 0; i < r_objects.size(); i++) {
+		if (r_objects[i].type == "table") {
+			export_table_indices.push_back(i);
+		}
+	}
+	if (export_table_indices.empty()) {
+		return true;
+	}
+
+	/* Open the connections with the same VFS as this connection */
+	sqlite3_vfs *vfs = nullptr;
+	sqlite3_file_control(db, "main", SQLITE_FCNTL_VFS_POINTER, &vfs);
+	const char *filename = sqlite3_db_filename(db, "main");
+
+	int64_t connection_count = MIN(export_thread_count, (int64_t)export_table_indices.size());
+	std::vector<sqlite3 *> connections;
+	for (int64_t i = 0; i < connection_count; i++) {
+		sqlite3 *connection = nullptr;
+		int rc = sqlite3_open_v2(filename, &connection, SQLITE_OPEN_READONLY, vfs ? vfs->zName : NULL);
+		if (rc != SQLITE_OK) {
+			ERR_PRINT("GDSQLite Error: Can't open connection for parallel export: " + String::utf8(sqlite3_errstr(rc)));
+			sqlite3_close(connection);
+			for (sqlite3 *opened_connection : connections) {
+				sqlite3_close(opened_connection);
+			}
+			return false;
+		}
+		connections.push_back(connection);
+	}
+
+	export_objects = &r_objects;
+	export_binary = p_binary;
+	export_compact = p_compact;
+	export_connection_pool = connections;
+
+	WorkerThreadPool *pool = WorkerThreadPool::get_singleton();
+	int64_t group_id = pool->add_group_task(callable_mp(this, &SQLite::export_table_task), export_table_indices.size(), connection_count, false, "GDSQLite export");
+	pool->wait_for_group_task_completion(group_id);
+
+	export_objects = nullptr;
+	export_connection_pool.clear();
+	for (sqlite3 *connection : connections) {
+		sqlite3_close(connection);
+	}
+
+	for (size_t index : export_table_indices) {
+		const export_object_struct &object = r_objects[index];
+		if (!object.success) {
+			error_message = object.error;
+			ERR_PRINT(" --> SQL error: " + error_message);
+			return false;
+		}
+	}
+	return true;
+}
+
+/*
+** Runs on a worker thread, borrowing one of the connections from the pool.
+** There are never more tasks running than there are connections.
+*/
+void SQLite::export_table_task(uint32_t p_index) {
+	sqlite3 *connection;
+	{
+		std::lock_guard<std::mutex> guard(export_mutex);
+		connection = export_connection_pool.back();
+		export_connection_pool.pop_back();
+	}
+
+	export_object_struct &object = (*export_objects)[export_table_indices[p_index]];
+	if (export_binary) {
+		object.success = write_binary_table(connection, object.binary, object.name, object.error);
+	} else {
+		/* The fragment ends up inside of the top-level array of the document */
+		gdsqlite_json_writer writer(Ref<FileAccess>(), export_compact, 1);
+		object.success = write_json_object(connection, writer, object, object.error);
+		writer.take_buffer(object.json);
+	}
+
+	std::lock_guard<std::mutex> guard(export_mutex);
+	export_connection_pool.push_back(connection);
+}
+
+bool SQLite::import_from_binary(PackedByteArray binary_buffer) {
+	call_guard guard(this);
+	if (binary_buffer.size() < BINARY_HEADER_SIZE) {
+		ERR_PRINT("GDSQLite Error: The buffer doesn't contain a binary export of a database!");
+		return false;
+	}
+	gdsqlite_binary_reader header(binary_buffer.ptr(), binary_buffer.size());
+	const uint8_t *magic = header.get_bytes(BINARY_MAGIC_SIZE);
+	uint8_t compression_mode = header.get_u8();
+	uint64_t payload_size = header.get_u64();
+	if (!header.is_valid() || memcmp(magic, BINARY_MAGIC, BINARY_MAGIC_SIZE) != 0) {
+		ERR_PRINT("GDSQLite Error: The buffer doesn't contain a binary export of a database!");
+		return false;
+	}
+
+	/* Only modes that can be decompressed are accepted, BROTLI can't be compressed by Godot */
+	bool valid_mode = compression_mode == BINARY_UNCOMPRESSED || compression_mode <= FileAccess::COMPRESSION_GZIP;
+	if (!valid_mode) {
+		ERR_PRINT("GDSQLite Error: The binary export uses an unknown compression mode (" + String::num_int64(compression_mode) + ")!");
+		return false;
+	}
+	if (payload_size > BINARY_MAX_PAYLOAD_SIZE) {
+		ERR_PRINT("GDSQLite Error: The binary export claims a payload of " + String::num_uint64(payload_size) + " bytes, which exceeds the maximum of " + String::num_int64(BINARY_MAX_PAYLOAD_SIZE) + " bytes!");
+		return false;
+	}
+
+	/* Uncompressed exports are read in-place */
+	PackedByteArray decompressed;
+	const uint8_t *payload = binary_buffer.ptr() + BINARY_HEADER_SIZE;
+	uint64_t available_size = binary_buffer.size() - BINARY_HEADER_SIZE;
+	if (compression_mode != BINARY_UNCOMPRESSED) {
+		if (available_size == 0) {
+			ERR_PRINT("GDSQLite Error: The binary export is truncated or failed to decompress!");
+			return false;
+		}
+		decompressed = binary_buffer.slice(BINARY_HEADER_SIZE).decompress(payload_size, compression_mode);
+		payload = decompressed.ptr();
+		available_size = decompressed.size();
+	}
+	if (available_size != payload_size) {
+		ERR_PRINT("GDSQLite Error: The binary export is truncated or failed to decompress!");
+		return false;
+	}
+
+	/* Go through the complete export once before dropping the current contents of the database */
+	gdsqlite_binary_reader validation_reader(payload, payload_size);
+	if (!read_binary_objects(validation_reader, false)) {
+		ERR_PRINT("GDSQLite Error: The binary export is corrupt!");
+		return false;
+	}
+
+	/* Clearing and importing happen in a single savepoint, so a failed import leaves the database untouched */
+	if (db == nullptr && !open_db()) {
+		return false;
+	}
+	bool outermost;
+	if (!begin_helper_savepoint(outermost)) {
+		return false;
+	}
+	/* foreign_keys cannot be enforced until after all rows have been added! */
+	query("PRAGMA defer_foreign_keys=on;");
+
+	gdsqlite_binary_reader reader(payload, payload_size);
+	bool success = clear_database() && read_binary_objects(reader, true);
+
+	/* Only a complete import is kept, anything else is rolled back */
+	return end_helper_savepoint(success, outermost);
+}
+
+/*
+** Read all objects of a binary export. Without p_import, the export is only
+** validated and the database isn't touched at all. Tables are created and
+** filled in the order in which they appear, while indexes, views and
+** triggers are only created once all rows are in place.
+*/
+bool SQLite::read_binary_objects(gdsqlite_binary_reader &p_reader, bool p_import) {
+	uint32_t object_count = p_reader.get_u32();
+	std::vector<String> deferred_sql;
+
+	for (uint32_t i = 0; i < object_count && p_reader.is_valid(); i++) {
+		uint8_t type = p_reader.get_u8();
+		String name = p_reader.get_string();
+		const char *sql;
+		uint32_t sql_length;
+		bool has_sql = p_reader.get_string(&sql, &sql_length);
+		if (type > TRIGGER || (type == TABLE && !has_sql)) {
+			return false;
+		}
+
+		if (type == TABLE) {
+			if (p_import && !query(String::utf8(sql, sql_length))) {
+				return false;
+			}
+			if (!read_binary_table(p_reader, name, p_import)) {
+				return false;
+			}
+		} else if (has_sql && p_import) {
+			deferred_sql.push_back(String::utf8(sql, sql_length));
+		}
+	}
+
+	for (const String &sql_string : deferred_sql) {
+		if (!query(sql_string)) {
+			return false;
+		}
+	}
+	return p_reader.is_valid() && p_reader.is_at_end();
+}
+
+/*
+** Read a single value of the given storage class and bind it to the
+** statement, unless the statement is a nullptr.
+*/
+static bool read_binary_value(gdsqlite_binary_reader &p_reader, uint8_t p_storage_class, sqlite3_stmt *p_stmt, int p_index) {
+	switch (p_storage_class) {
+		case SQLITE_INTEGER: {
+			int64_t value = (int64_t)p_reader.get_u64();
+			if (p_stmt) {
+				sqlite3_bind_int64(p_stmt, p_index, value);
+			}
+			break;
+		}
+		case SQLITE_FLOAT: {
+			double value = p_reader.get_double();
+			if (p_stmt) {
+				sqlite3_bind_double(p_stmt, p_index, value);
+			}
+			break;
+		}
+		case SQLITE_TEXT:
+		case SQLITE_BLOB: {
+			const char *data;
+			uint32_t length;
+			if (!p_reader.get_string(&data, &length)) {
+				return false;
+			}
+			if (p_stmt == nullptr) {
+				break;
+			}
+			/* The buffer outlives the statement, so the data doesn't have to be copied */
+			if (p_storage_class == SQLITE_TEXT) {
+				sqlite3_bind_text(p_stmt, p_index, length > 0 ? data : "", length, SQLITE_STATIC);
+			} else if (length > 0) {
+				sqlite3_bind_blob(p_stmt, p_index, data, length, SQLITE_STATIC);
+			} else {
+				sqlite3_bind_zeroblob(p_stmt, p_index, 0);
+			}
+			break;
+		}
+		case SQLITE_NULL:
+			if (p_stmt) {
+				sqlite3_bind_null(p_stmt, p_index);
+			}
+			break;
+		default:
+			return false;
+	}
+	return p_reader.is_valid();
+}
+
+bool SQLite::read_binary_table(gdsqlite_binary_reader &p_reader, const String &p_name, bool p_import) {
+	uint32_t column_count = p_reader.get_u32();
+	if (!p_reader.is_valid() || column_count == 0 || column_count > BINARY_MAX_COLUMNS) {
+		return false;
+	}
+
+	PackedStringArray key_strings;
+	PackedStringArray value_strings;
+	for (uint32_t column = 0; column < column_count; column++) {
+		key_strings.append(sanitize_identifier(p_reader.get_string()));
+		value_strings.append("?");
+	}
+	if (!p_reader.is_valid()) {
+		return false;
+	}
+
+	sqlite3_stmt *stmt = nullptr;
+	if (p_import) {
+		String query_string = vformat("INSERT INTO %s (%s) VALUES (%s);", sanitize_identifier(p_name), String(", ").join(key_strings), String(", ").join(value_strings));
+		const CharString dummy_query = query_string.utf8();
+		if (!prepare_statement(dummy_query, &stmt, nullptr)) {
+			return false;
+		}
+	}
+
+	std::vector<const uint8_t *> storage_classes(column_count);
+	std::vector<gdsqlite_binary_reader> values(column_count);
+	bool success = true;
+	while (success) {
+		uint32_t row_count = p_reader.get_u32();
+		if (!p_reader.is_valid() || row_count == 0) {
+			success = p_reader.is_valid();
+			break;
+		}
+
+		for (uint32_t column = 0; column < column_count; column++) {
+			storage_classes[column] = p_reader.get_bytes(row_count);
+			values[column] = p_reader.sub_reader(p_reader.get_u64());
+		}
+		if (!p_reader.is_valid()) {
+			success = false;
+			break;
+		}
+
+		for (uint32_t row = 0; row < row_count && success; row++) {
+			for (uint32_t column = 0; column < column_count && success; column++) {
+				success = read_binary_value(values[column], storage_classes[column][row], stmt, column + 1);
+			}
+			if (!success || stmt == nullptr) {
+				continue;
+			}
+
+			int rc = sqlite3_step(stmt);
+			sqlite3_reset(stmt);
+			if (rc != SQLITE_DONE) {
+				update_error_message(rc);
+				ERR_PRINT(" --> SQL error: " + error_message);
+				success = false;
+			}
+		}
+
+		for (uint32_t column = 0; column < column_count && success; column++) {
+			success = values[column].is_at_end();
+		}
+	}
+
+	sqlite3_finalize(stmt);
+	return success;
+}
+
+enum CSV_TYPE {
+	CSV_INFER,
+	CSV_INTEGER,
+	CSV_REAL,
+	CSV_TEXT,
+	CSV_BLOB
+};
+
+static bool get_csv_character(const Dictionary &p_options, const String &p_key, char p_default, char &r_character) {
+	String value = p_options.get(p_key, String::chr(p_default));
+	if (value.length() != 1 || value[0] > 127) {
+		ERR_PRINT("GDSQLite Error: The \"" + p_key + "\"-option should consist of a single ASCII character");
+		return false;
+	}
+	r_character = (char)value[0];
+	return true;
+}
+
+static bool get_csv_type(const Variant &p_type, CSV_TYPE &r_type) {
+	String type = String(p_type).to_upper();
+	if (type.is_empty()) {
+		r_type = CSV_INFER;
+	} else if (type == "INTEGER") {
+		r_type = CSV_INTEGER;
+	} else if (type == "REAL") {
+		r_type = CSV_REAL;
+	} else if (type == "TEXT") {
+		r_type = CSV_TEXT;
+	} else if (type == "BLOB") {
+		r_type = CSV_BLOB;
+	} else {
+		ERR_PRINT("GDSQLite Error: The column types are restricted to \"INTEGER\", \"REAL\", \"TEXT\" or \"BLOB\"");
+		return false;
+	}
+	return true;
+}
+
+/*
+** Bind a single CSV field. Empty fields without quotes are NULL, except for
+** TEXT columns. Unless a column type is given, quoted fields are always text
+** and other fields become numbers whenever they can be parsed as such.
+*/
+static void bind_csv_field(sqlite3_stmt *p_stmt, int p_index, const gdsqlite_csv_field &p_field, CSV_TYPE p_type, std::vector<uint8_t> &r_blob) {
+	if (p_type == CSV_TEXT) {
+		sqlite3_bind_text(p_stmt, p_index, p_field.text.data(), p_field.text.length(), SQLITE_STATIC);
+		return;
+	}
+	if (!p_field.quoted && p_field.text.empty()) {
+		sqlite3_bind_null(p_stmt, p_index);
+		return;
+	}
+	if (p_type == CSV_BLOB) {
+		/* Fields that aren't valid base64 are kept as text instead of being lost */
+		if (gdsqlite_base64_decode(p_field.text.data(), p_field.text.length(), r_blob)) {
+			sqlite3_bind_blob64(p_stmt, p_index, r_blob.data(), r_blob.size(), SQLITE_TRANSIENT);
+		} else {
+			sqlite3_bind_text(p_stmt, p_index, p_field.text.data(), p_field.text.length(), SQLITE_STATIC);
+		}
+		return;
+	}
+
+	if (!p_field.quoted || p_type != CSV_INFER) {
+		int64_t integer;
+		double real;
+		if (p_type != CSV_REAL && p_field.to_integer(integer)) {
+			sqlite3_bind_int64(p_stmt, p_index, integer);
+			return;
+		}
+		if (p_field.to_real(real)) {
+			sqlite3_bind_double(p_stmt, p_index, real);
+			return;
+		}
+	}
+	sqlite3_bind_text(p_stmt, p_index, p_field.text.data(), p_field.text.length(), SQLITE_STATIC);
+}
+
+bool SQLite::table_exists(const String &p_name) {
+	sqlite3_stmt *stmt;
+	if (sqlite3_prepare_v2(db, "SELECT 1 FROM sqlite_master WHERE type = 'table' AND name = ?;", -1, &stmt, nullptr) != SQLITE_OK) {
+		return false;
+	}
+	const CharString dummy_name = p_name.utf8();
+	sqlite3_bind_text(stmt, 1, dummy_name.get_data(), -1, SQLITE_STATIC);
+	bool exists = sqlite3_step(stmt) == SQLITE_ROW;
+	sqlite3_finalize(stmt);
+	return exists;
+}
+
+/*
+** Import the rows of a CSV file into a table, creating the table from the
+** header of the file if it doesn't exist yet. The file is tokenized while it
+** is being read and all rows go through a single prepared statement inside
+** of a savepoint, so a failed import leaves the table untouched and doesn't
+** leave behind a table that it created either.
+*/
+bool SQLite::import_csv(const String &p_table_name, String p_import_path, const Dictionary &p_options) {
+	call_guard guard(this);
+	if (db == nullptr) {
+		ERR_PRINT("GDSQLite Error: Can't import CSV if connection is not open!");
+		return false;
+	}
+
+	char delimiter, quote;
+	if (!get_csv_character(p_options, "delimiter", ',', delimiter) || !get_csv_character(p_options, "quote", '"', quote)) {
+		return false;
+	}
+	bool has_header = p_options.get("header", true);
+	Dictionary column_types_dict = p_options.get("column_types", Dictionary());
+
+	/* Find the real path */
+	p_import_path = ProjectSettings::get_singleton()->globalize_path(p_import_path.strip_edges());
+	Ref<FileAccess> file = FileAccess::open(p_import_path, FileAccess::READ);
+	if (file.is_null()) {
+		ERR_PRINT("GDSQLite Error: Can't open file for reading, error code " + String::num_int64(FileAccess::get_open_error()) + " (" + p_import_path + ")");
+		return false;
+	}
+
+	gdsqlite_csv_reader reader(file, delimiter, quote);
+	std::vector<gdsqlite_csv_field> fields;
+	std::vector<uint8_t> blob;
+	size_t field_count = 0;
+
+	PackedStringArray column_names;
+	if (has_header) {
+		if (!reader.next_row(fields, field_count)) {
+			ERR_PRINT("GDSQLite Error: The CSV file doesn't contain a header (" + p_import_path + ")");
+			return false;
+		}
+		for (size_t i = 0; i < field_count; i++) {
+			column_names.append(String::utf8(fields[i].text.c_str(), fields[i].text.length()));
+		}
+	}
+
+	/* Column types are looked up by name or, in absence of a header, by index */
+	std::vector<CSV_TYPE> column_types;
+	auto resolve_column_types = [&](size_t p_column_count) {
+		column_types.resize(p_column_count);
+		for (size_t i = 0; i < p_column_count; i++) {
+			Variant type = column_types_dict.get((int64_t)i, "");
+			if (i < (size_t)column_names.size()) {
+				type = column_types_dict.get(column_names[i], type);
+			}
+			if (!get_csv_type(type, column_types[i])) {
+				return false;
+			}
+		}
+		return true;
+	};
+
+	String table_name = sanitize_identifier(p_table_name);
+	bool create_table = !table_exists(p_table_name);
+	if (create_table) {
+		if (!has_header) {
+			ERR_PRINT("GDSQLite Error: Can't create table \"" + p_table_name + "\" from a CSV file without header!");
+			return false;
+		}
+		if (!resolve_column_types(column_names.size())) {
+			return false;
+		}
+	}
+
+	bool outermost;
+	if (!begin_helper_savepoint(outermost)) {
+		return false;
+	}
+
+	bool success = true;
+	if (create_table) {
+		static const char *declared_types[] = { "", " INTEGER", " REAL", " TEXT", " BLOB" };
+		PackedStringArray column_definitions;
+		for (int64_t i = 0; i < column_names.size(); i++) {
+			column_definitions.append(sanitize_identifier(column_names[i]) + declared_types[column_types[i]]);
+		}
+		success = query(vformat("CREATE TABLE %s (%s);", table_name, String(", ").join(column_definitions)));
+	}
+
+	sqlite3_stmt *stmt = nullptr;
+	size_t column_count = 0;
+	int64_t row_count = 0;
+	while (success && reader.next_row(fields, field_count)) {
+		/* Skip blank lines */
+		if (field_count == 1 && fields[0].text.empty() && !fields[0].quoted) {
+			continue;
+		}
+
+		/* The statement is prepared once the number of columns is known */
+		if (stmt == nullptr) {
+			column_count = has_header ? column_names.size() : field_count;
+			if (column_types.size() != column_count && !resolve_column_types(column_count)) {
+				success = false;
+				break;
+			}
+
+			PackedStringArray value_strings;
+			value_strings.resize(column_count);
+			value_strings.fill("?");
+			String query_string;
+			if (has_header) {
+				PackedStringArray key_strings;
+				for (int64_t i = 0; i < column_names.size(); i++) {
+					key_strings.append(sanitize_identifier(column_names[i]));
+				}
+				query_string = vformat("INSERT INTO %s (%s) VALUES (%s);", table_name, String(", ").join(key_strings), String(", ").join(value_strings));
+			} else {
+				query_string = vformat("INSERT INTO %s VALUES (%s);", table_name, String(", ").join(value_strings));
+			}
+			const CharString dummy_query = query_string.utf8();
+			if (!prepare_statement(dummy_query, &stmt, nullptr)) {
+				stmt = nullptr;
+				success = false;
+				break;
+			}
+		}
+
+		if (field_count != column_count) {
+			ERR_PRINT("GDSQLite Error: Expected " + String::num_int64(column_count) + " fields but found " + String::num_int64(field_count) + ", before line " + String::num_int64(reader.get_line()) + " (" + p_import_path + ")");
+			success = false;
+			break;
+		}
+
+		for (size_t i = 0; i < column_count; i++) {
+			bind_csv_field(stmt, i + 1, fields[i], column_types[i], blob);
+		}
+		int rc = sqlite3_step(stmt);
+		sqlite3_reset(stmt);
+		if (rc != SQLITE_DONE) {
+			update_error_message(rc);
+			ERR_PRINT(" --> SQL error: " + error_message);
+			success = false;
+		}
+		row_count++;
+	}
+
+	if (success && reader.is_malformed()) {
+		ERR_PRINT("GDSQLite Error: Malformed quoted field, before line " + String::num_int64(reader.get_line()) + " (" + p_import_path + ")");
+		success = false;
+	}
+	sqlite3_finalize(stmt);
+
+	/* Only a complete import is kept, anything else is rolled back */
+	if (!end_helper_savepoint(success, outermost)) {
+		return false;
+	}
+	if (verbosity_level > VerbosityLevel::NORMAL) {
+		UtilityFunctions::print("Imported " + String::num_int64(row_count) + " rows into table \"" + p_table_name + "\"");
+	}
+	return true;
+}
+
+/*
+** Write the result of a query to a CSV file, one row at a time. NULLs are
+** written as empty fields, while empty strings are written as a pair of
+** quotes so both can be told apart when importing the file again.
+*/
+bool SQLite::export_csv(const String &p_query, String p_export_path, const Dictionary &p_options) {
+	call_guard guard(this);
+	if (db == nullptr) {
+		ERR_PRINT("GDSQLite Error: Can't export CSV if connection is not open!");
+		return false;
+	}
+
+	char delimiter, quote;
+	if (!get_csv_character(p_options, "delimiter", ',', delimiter) || !get_csv_character(p_options, "quote", '"', quote)) {
+		return false;
+	}
+	bool has_header = p_options.get("header", true);
+
+	const CharString dummy_query = p_query.utf8();
+	sqlite3_stmt *stmt;
+	if (!prepare_statement(dummy_query, &stmt, nullptr)) {
+		return false;
+	}
+
+	/* Find the real path */
+	p_export_path = ProjectSettings::get_singleton()->globalize_path(p_export_path.strip_edges());
+	Ref<FileAccess> file = FileAccess::open(p_export_path, FileAccess::WRITE);
+	if (file.is_null()) {
+		ERR_PRINT("GDSQLite Error: Can't open file for writing, error code " + String::num_int64(FileAccess::get_open_error()) + " (" + p_export_path + ")");
+		sqlite3_finalize(stmt);
+		return false;
+	}
+
+	gdsqlite_csv_writer writer(file, delimiter, quote);
+	std::string encoded_blob;
+	int column_count = sqlite3_column_count(stmt);
+	if (has_header) {
+		for (int column = 0; column < column_count; column++) {
+			const char *column_name = sqlite3_column_name(stmt, column);
+			writer.field(column_name, strlen(column_name));
+		}
+		writer.end_row();
+	}
+
+	int rc;
+	while ((rc = sqlite3_step(stmt)) == SQLITE_ROW) {
+		for (int column = 0; column < column_count; column++) {
+			switch (sqlite3_column_type(stmt, column)) {
+				case SQLITE_INTEGER:
+					writer.integer_field(sqlite3_column_int64(stmt, column));
+					break;
+				case SQLITE_FLOAT:
+					writer.real_field(sqlite3_column_double(stmt, column));
+					break;
+				case SQLITE_TEXT: {
+					int bytes = sqlite3_column_bytes(stmt, column);
+					writer.field(reinterpret_cast<const char *>(sqlite3_column_text(stmt, column)), bytes, bytes == 0);
+					break;
+				}
+				case SQLITE_BLOB: {
+					int bytes = sqlite3_column_bytes(stmt, column);
+					encoded_blob.resize(gdsqlite_base64_encoded_size(bytes));
+					gdsqlite_base64_encode(reinterpret_cast<const uint8_t *>(sqlite3_column_blob(stmt, column)), bytes, &encoded_blob[0]);
+					writer.field(encoded_blob.data(), encoded_blob.length(), true);
+					break;
 				}
+				default:
+					writer.empty_field();
+					break;
 			}
 		}
+		writer.end_row();
+	}
+
+	bool success = rc == SQLITE_DONE;
+	if (!success) {
+		update_error_message(rc);
+		ERR_PRINT(" --> SQL error: " + error_message);
+	}
+	sqlite3_finalize(stmt);
+
+	if (!writer.finish()) {
+		ERR_PRINT("GDSQLite Error: Failed to write to file (" + p_export_path + ")");
+		success = false;
+	}
+	return success;
+}
+
+/*
+** Drop all tables and views of the database, as done before every import.
+** The database is opened first if this hasn't happened yet.
+*/
+bool SQLite::clear_database() {
+	/* Check if the database is open and, if not, attempt to open it */
+	if (db == nullptr) {
+		/* Open the database using the open_db method */
+		if (!open_db()) {
+			return false;
+		}
+	}
+
+	/* Find all views that are present in this database */
+	query(String("SELECT name FROM sqlite_master WHERE type = 'view';"));
+	TypedArray<Dictionary> old_view_array = query_result.get().duplicate(true);
+	int64_t old_number_of_views = old_view_array.size();
+	/* Drop all old views present in the database */
+	for (int64_t i = 0; i <= old_number_of_views - 1; i++) {
+		Dictionary view_dict = old_view_array[i];
+		String view_name = view_dict["name"];
+		String query_string = "DROP VIEW " + view_name + ";";
+
+		query(query_string);
+	}
+
+	/* Find all tables that are present in this database */
+	/* We don't care about indexes or triggers here since they get dropped automatically when their table is dropped */
+	query(String("SELECT name,type FROM sqlite_master WHERE type = 'table' AND name NOT LIKE 'sqlite_%';"));
+	TypedArray<Dictionary> old_table_array = query_result.get().duplicate(true);
+#ifdef SQLITE_ENABLE_FTS5
+	/* FTS5 creates a bunch of shadow tables that cannot be dropped manually! */
+	/* The virtual table is responsible for dropping these tables itself */
+	remove_shadow_tables(old_table_array);
+#endif
+	int64_t old_number_of_tables = old_table_array.size();
+	/* Drop all old tables present in the database */
+	for (int64_t i = 0; i <= old_number_of_tables - 1; i++) {
+		Dictionary table_dict = old_table_array[i];
+		String table_name = sanitize_identifier(table_dict["name"]);
 
-		int64_t number_of_rows = object.row_array.size();
-		for (int64_t i = 0; i <= number_of_rows - 1; i++) {
-			if (object.row_array[i].get_type() != Variant::DICTIONARY) {
-				ERR_PRINT("GDSQLite Error: All elements of the Array should be of type Dictionary");
-				return false;
-			}
-			String table_name = sanitize_identifier(object.name);
-			if (!insert_row(table_name, object.row_array[i])) {
-				/* Don't forget to close the transaction! */
-				/* Stop the error_message from being overwritten! */
-				String previous_error_message = error_message;
-				query("END TRANSACTION;");
-				error_message = previous_error_message;
-				return false;
-			}
-		}
+		drop_table(table_name);
 	}
-	query("END TRANSACTION;");
 	return true;
 }
 
-PackedByteArray SQLite::export_to_buffer() {
+/*
+** Get the type, name and sql template of all objects that should be exported.
+*/
+bool SQLite::get_exported_objects(std::vector<export_object_struct> &r_objects) {
 	/* Get all names and sql templates for all tables present in the database */
-	query(String("SELECT type,name,sql FROM sqlite_master WHERE name NOT LIKE 'sqlite_%';"));
-	TypedArray<Dictionary> database_array = query_result.duplicate(true);
+	if (!query(String("SELECT type,name,sql FROM sqlite_master WHERE name NOT LIKE 'sqlite_%';"))) {
+		return false;
+	}
+	Array database_array = query_result.get().duplicate(true);
 #ifdef SQLITE_ENABLE_FTS5
 	/* FTS5 creates a bunch of shadow tables that should NOT be exported! */
 	remove_shadow_tables(database_array);
 #endif
-	int64_t number_of_objects = database_array.size();
-	/* Construct a Dictionary for each table, convert it to JSON and write it to String */
-	for (int64_t i = 0; i <= number_of_objects - 1; i++) {
-		Dictionary object_dict = database_array[i];
-
-		if (object_dict["type"] == String("table")) {
-			String object_name = object_dict["name"];
-			String query_string;
-
-			query_string = vformat("SELECT * FROM %s;", sanitize_identifier((const String &)object_name));
-			query(query_string);
-
-			/* Encode all columns of type PoolByteArray to base64 */
-			if (!query_result.is_empty()) {
-				/* First identify the columns that are of this type! */
-				Array base64_columns = Array();
-				Dictionary initial_row = query_result[0];
-				Array keys = initial_row.keys();
-				for (int k = 0; k <= keys.size() - 1; k++) {
-					String key = keys[k];
-					Variant value = initial_row[key];
-					if (value.get_type() == Variant::PACKED_BYTE_ARRAY) {
-						base64_columns.append(key);
-					}
-				}
-
-				/* Now go through all the rows and encode the relevant columns */
-				for (int k = 0; k <= base64_columns.size() - 1; k++) {
-					String key = base64_columns[k];
-					for (int j = 0; j <= query_result.size() - 1; j++) {
-						Dictionary row = query_result[j];
-						PackedByteArray arr = ((const PackedByteArray &)row[key]);
-						String encoded_string = Marshalls::get_singleton()->raw_to_base64(arr);
-
-						row.erase(key);
-						row[key] = encoded_string;
-					}
-				}
-
-				if (!base64_columns.is_empty()) {
-					object_dict["base64_columns"] = base64_columns;
-				}
-			}
-			object_dict["row_array"] = query_result.duplicate(true);
-		}
-	}
-
-	Ref<JSON> json;
-	json.instantiate();
-	String json_string = json->stringify(database_array, "\t");
-	PackedByteArray json_buffer = json_string.to_utf8_buffer();
-	return json_buffer;
-}
-
-bool SQLite::validate_json(const Array &database_array, std::vector<object_struct> &objects_to_import) {
-	/* Start going through all the tables and checking their validity */
-	int64_t number_of_objects = database_array.size();
-	for (int64_t i = 0; i <= number_of_objects - 1; i++) {
-		/* Create a new object_struct */
-		object_struct new_object;
-
-		Dictionary temp_dict = database_array[i];
-		/* Get the name of the object */
-		if (!temp_dict.has("name")) {
-			/* Did not find the necessary key! */
-			ERR_PRINT("GDSQlite Error: Did not find required key \"name\" in the supplied json-file");
-			return false;
-		}
-		new_object.name = temp_dict["name"];
-
-		/* Extract the sql template for generating the object */
-		if (!temp_dict.has("sql")) {
-			/* Did not find the necessary key! */
-			ERR_PRINT("GDSQlite Error: Did not find required key \"sql\" in the supplied json-file");
-			return false;
-		}
-		new_object.sql = temp_dict["sql"];
-
-		if (!temp_dict.has("type")) {
-			/* Did not find the necessary key! */
-			ERR_PRINT("GDSQlite Error: Did not find required key \"type\" in the supplied json-file");
-			return false;
-		}
-		if (temp_dict["type"] == String("table")) {
-			new_object.type = TABLE;
-
-			/* Add the optional base64_columns if defined! */
-			new_object.base64_columns = temp_dict.get("base64_columns", Array());
 
-			if (!temp_dict.has("row_array")) {
-				/* Did not find the necessary key! */
-				ERR_PRINT("GDSQlite Error: Did not find required key \"row_array\" in the supplied json-file");
-				return false;
-			} else if (Variant(temp_dict["row_array"]).get_type() != Variant::ARRAY) {
-				ERR_PRINT("GDSQlite Error: The value of the key \"row_array\" should consist of an array of rows");
-				return false;
-			}
-			new_object.row_array = temp_dict["row_array"];
-		} else if (temp_dict["type"] == String("index")) {
-			new_object.type = INDEX;
-		} else if (temp_dict["type"] == String("view")) {
-			new_object.type = TRIGGER;
-		} else if (temp_dict["type"] == String("trigger")) {
-			new_object.type = TRIGGER;
-		} else {
-			/* Did not find the necessary key! */
-			ERR_PRINT("GDSQlite Error: The value of key \"type\" is restricted to \"table\", \"index\", \"view\" or \"trigger\"");
-			return false;
+	r_objects.clear();
+	r_objects.resize(database_array.size());
+	for (int64_t i = 0; i < database_array.size(); i++) {
+		Dictionary object_dict = database_array[i];
+		export_object_struct &object = r_objects[i];
+		object.type = object_dict["type"];
+		object.name = object_dict["name"];
+		object.has_sql = object_dict["sql"].get_type() != Variant::NIL;
+		if (object.has_sql) {
+			object.sql = object_dict["sql"];
 		}
-
-		/* Add the table or trigger to the new objects vector */
-		objects_to_import.insert(objects_to_import.end(), new_object);
 	}
 	return true;
 }
@@ -1215,8 +3628,8 @@ bool SQLite::validate_json(const Array &database_array, std::vector<object_struc
 void SQLite::remove_shadow_tables(Array &p_array) {
 	/* The rootpage of virtual tables is always zero!*/
 	query(String("SELECT name FROM sqlite_master WHERE type = 'table' AND rootpage = 0;"));
-	int number_of_objects = query_result.size();
-	Array database_array = query_result.duplicate(true);
+	int number_of_objects = query_result.get().size();
+	Array database_array = query_result.get().duplicate(true);
 
 	/* Make an array of all the expected shadow table names */
 	Array shadow_table_names = Array();
@@ -1252,12 +3665,18 @@ void SQLite::remove_shadow_tables(Array &p_array) {
 
 // Properties.
 void SQLite::set_last_insert_rowid(const int64_t &p_last_insert_rowid) {
+	call_guard guard(this);
 	if (db) {
 		sqlite3_set_last_insert_rowid(db, p_last_insert_rowid);
 	}
 }
 
 int64_t SQLite::get_last_insert_rowid() const {
+	std::lock_guard<std::mutex> lock(state_mutex);
+	const thread_state_struct *state = get_thread_state();
+	if (state) {
+		return state->last_insert_rowid;
+	}
 	if (db) {
 		return sqlite3_last_insert_rowid(db);
 	}
@@ -1289,6 +3708,114 @@ bool SQLite::get_read_only() const {
 	return read_only;
 }
 
+void SQLite::set_prefetch(const bool &p_prefetch) {
+	prefetch = p_prefetch;
+}
+
+bool SQLite::get_prefetch() const {
+	return prefetch;
+}
+
+void SQLite::set_change_notifications(const int64_t &p_change_notifications) {
+	call_guard guard(this, false);
+	int64_t mode = CLAMP(p_change_notifications, (int64_t)CHANGE_NOTIFICATIONS_NONE, (int64_t)CHANGE_NOTIFICATIONS_VALUES);
+	if (mode == CHANGE_NOTIFICATIONS_VALUES) {
+#ifndef SQLITE_ENABLE_PREUPDATE_HOOK
+		ERR_PRINT("GDSQLite Error: CHANGE_NOTIFICATIONS_VALUES requires the enable_preupdate_hook compile-time option!");
+		return;
+#else
+		if (!sessions.empty()) {
+			ERR_PRINT("GDSQLite Error: CHANGE_NOTIFICATIONS_VALUES can't be used while sessions are open!");
+			return;
+		}
+#endif
+	}
+	change_notifications = mode;
+	update_hooks();
+}
+
+int64_t SQLite::get_change_notifications() const {
+	return change_notifications;
+}
+
+void SQLite::set_auto_vacuum(const int64_t &p_auto_vacuum) {
+	auto_vacuum = CLAMP(p_auto_vacuum, (int64_t)AUTO_VACUUM_UNCHANGED, (int64_t)AUTO_VACUUM_INCREMENTAL);
+}
+
+int64_t SQLite::get_auto_vacuum() const {
+	return auto_vacuum;
+}
+
+void SQLite::set_pragma_preset(const String &p_pragma_preset) {
+	pragma_preset = p_pragma_preset;
+}
+
+String SQLite::get_pragma_preset() const {
+	return pragma_preset;
+}
+
+void SQLite::set_pragmas(const Dictionary &p_pragmas) {
+	pragmas = p_pragmas.duplicate();
+}
+
+Dictionary SQLite::get_pragmas() const {
+	return pragmas;
+}
+
+Dictionary SQLite::get_effective_pragmas() const {
+	std::lock_guard<std::mutex> lock(state_mutex);
+	return effective_pragmas;
+}
+
+void SQLite::set_export_thread_count(const int64_t &p_export_thread_count) {
+	export_thread_count = MAX(p_export_thread_count, (int64_t)1);
+}
+
+int64_t SQLite::get_export_thread_count() const {
+	return export_thread_count;
+}
+
+void SQLite::set_write_batching(const bool &p_write_batching) {
+	call_guard guard(this, false);
+	write_batching = p_write_batching;
+	if (!write_batching && write_batch_open) {
+		flush();
+	}
+}
+
+bool SQLite::get_write_batching() const {
+	return write_batching;
+}
+
+void SQLite::set_write_batch_size(const int64_t &p_write_batch_size) {
+	write_batch_size = MAX(p_write_batch_size, (int64_t)0);
+}
+
+int64_t SQLite::get_write_batch_size() const {
+	return write_batch_size;
+}
+
+void SQLite::set_write_batch_msec(const int64_t &p_write_batch_msec) {
+	write_batch_msec = MAX(p_write_batch_msec, (int64_t)0);
+}
+
+int64_t SQLite::get_write_batch_msec() const {
+	return write_batch_msec;
+}
+
+void SQLite::set_threading_mode(const int64_t &p_threading_mode) {
+	call_guard guard(this, false);
+	if (db) {
+		ERR_PRINT("GDSQLite Error: Can't change the threading mode while the connection is open!");
+		return;
+	}
+	threading_mode = CLAMP(p_threading_mode, (int64_t)THREADING_MODE_SINGLE_THREAD, (int64_t)THREADING_MODE_MULTI_THREAD);
+}
+
+int64_t SQLite::get_threading_mode() const {
+	return threading_mode;
+}
+
 void SQLite::set_path(const String &p_path) {
 	path = p_path;
 }
@@ -1308,11 +3835,14 @@ void SQLite::update_error_message(int rc) {
 }
 
 void SQLite::set_error_message(const String &p_error_message) {
+	call_guard guard(this, false);
 	error_message = p_error_message;
 }
 
 String SQLite::get_error_message() const {
-	return error_message;
+	std::lock_guard<std::mutex> lock(state_mutex);
+	const thread_state_struct *state = get_thread_state();
+	return state ? state->error_message : error_message.get();
 }
 
 void SQLite::set_default_extension(const String &p_default_extension) {
@@ -1324,18 +3854,70 @@ String SQLite::get_default_extension() const {
 }
 
 void SQLite::set_query_result(const TypedArray<Dictionary> &p_query_result) {
+	call_guard guard(this, false);
 	query_result = p_query_result;
 }
 
 TypedArray<Dictionary> SQLite::get_query_result() const {
-	return query_result.duplicate(true);
+	std::lock_guard<std::mutex> lock(state_mutex);
+	const thread_state_struct *state = get_thread_state();
+	return state ? state->query_result.duplicate(true) : query_result.get().duplicate(true);
 }
 
 TypedArray<Dictionary> SQLite::get_query_result_by_reference() const {
-	return query_result;
+	std::lock_guard<std::mutex> lock(state_mutex);
+	const thread_state_struct *state = get_thread_state();
+	return state ? state->query_result : query_result.get();
+}
+
+/*
+** Get the results of the latest call that was made by the calling thread, or
+** nullptr if the members of the object itself should be used instead. This
+** is the case outside of the threaded modes and while being inside of a call,
+** as the members either resolve to the state of the thread already or are
+** only copied to it once the outermost call returns. Requires state_mutex to
+** be locked.
+*/
+const thread_state_struct *SQLite::get_thread_state() const {
+	if (threading_mode == THREADING_MODE_SINGLE_THREAD || find_call_frame() != nullptr) {
+		return nullptr;
+	}
+	static const thread_state_struct empty_state;
+	auto it = thread_states.find(std::this_thread::get_id());
+	return it != thread_states.end() ? &it->second : &empty_state;
+}
+
+/*
+** Find the outermost call of the calling thread on this object, if any.
+*/
+call_frame_struct *SQLite::find_call_frame() const {
+	for (call_frame_struct *frame = current_call_frame; frame; frame = frame->previous) {
+		if (frame->sqlite == this) {
+			return frame;
+		}
+	}
+	return nullptr;
+}
+
+/*
+** Get the state of the calling thread if it's running on a connection of its
+** own, which the members that are kept per thread resolve to.
+*/
+thread_state_struct *SQLite::get_call_state() const {
+	call_frame_struct *frame = find_call_frame();
+	return frame ? frame->state : nullptr;
+}
+
+/*
+** Returns true if the calling thread is using a connection of its own, in
+** which case the features that are tied to the main connection are skipped.
+*/
+bool SQLite::on_thread_connection() const {
+	return get_call_state() != nullptr;
 }
 
 int SQLite::get_autocommit() const {
+	call_guard guard(const_cast<SQLite *>(this));
 	if (db) {
 		return sqlite3_get_autocommit(db);
 	}
@@ -1349,7 +3931,352 @@ int SQLite::compileoption_used(const String &option_name) const {
 	return sqlite3_compileoption_used(char_name);
 }
 
+/*
+** Get the I/O counters of the database or journal file of the connection.
+** Only files that are opened through the godot VFS keep track of these.
+*/
+static gdsqlite_io_stats *get_file_io_stats(sqlite3 *p_db, int p_pointer_op) {
+	sqlite3_file *file = nullptr;
+	if (sqlite3_file_control(p_db, "main", p_pointer_op, &file) != SQLITE_OK || file == nullptr) {
+		return nullptr;
+	}
+	/* Files of other VFSes, such as in-memory journals, don't necessarily implement xFileControl() at all */
+	if (file->pMethods != gdsqlite_file_io_methods() && file->pMethods != gdsqlite_compressed_file_io_methods()) {
+		return nullptr;
+	}
+
+	gdsqlite_io_stats *io_stats = nullptr;
+	if (file->pMethods->xFileControl(file, GDSQLITE_FCNTL_IO_STATS, &io_stats) != SQLITE_OK) {
+		return nullptr;
+	}
+	return io_stats;
+}
+
+Dictionary SQLite::get_io_stats() const {
+	call_guard guard(const_cast<SQLite *>(this));
+	Dictionary io_stats;
+	if (db == nullptr) {
+		return io_stats;
+	}
+
+	gdsqlite_io_stats *main_stats = get_file_io_stats(db, SQLITE_FCNTL_FILE_POINTER);
+	if (main_stats) {
+		io_stats["main"] = main_stats->to_dictionary();
+	}
+	gdsqlite_io_stats *journal_stats = get_file_io_stats(db, SQLITE_FCNTL_JOURNAL_POINTER);
+	if (journal_stats) {
+		io_stats["journal"] = journal_stats->to_dictionary();
+	}
+	return io_stats;
+}
+
+void SQLite::reset_io_stats() {
+	call_guard guard(this);
+	if (db == nullptr) {
+		return;
+	}
+
+	gdsqlite_io_stats *main_stats = get_file_io_stats(db, SQLITE_FCNTL_FILE_POINTER);
+	if (main_stats) {
+		main_stats->reset();
+	}
+	gdsqlite_io_stats *journal_stats = get_file_io_stats(db, SQLITE_FCNTL_JOURNAL_POINTER);
+	if (journal_stats) {
+		journal_stats->reset();
+	}
+}
+
+int64_t SQLite::get_page_size() {
+	return get_pragma_integer("PRAGMA page_size;");
+}
+
+/*
+** Get the value of a pragma that returns a single integer, or -1 if the
+** pragma can't be queried.
+*/
+int64_t SQLite::get_pragma_integer(const char *p_pragma) {
+	sqlite3_stmt *stmt;
+	if (sqlite3_prepare_v2(db, p_pragma, -1, &stmt, nullptr) != SQLITE_OK) {
+		return -1;
+	}
+	int64_t value = -1;
+	if (sqlite3_step(stmt) == SQLITE_ROW) {
+		value = sqlite3_column_int64(stmt, 0);
+	}
+	sqlite3_finalize(stmt);
+	return value;
+}
+
+/*
+** Apply the pragmas of the pragma_preset and the pragmas-property in order,
+** and read back their effective values. Some pragmas are silently ignored by
+** SQLite, e.g. in-memory databases don't support WAL, which is only worth a
+** warning as the connection is still perfectly usable.
+*/
+bool SQLite::apply_pragmas(sqlite3 *p_db, const std::vector<gdsqlite_pragma_setting> &p_settings, Dictionary &r_effective_pragmas) {
+	r_effective_pragmas.clear();
+	for (const gdsqlite_pragma_setting &setting : p_settings) {
+		String query_string = vformat("PRAGMA %s=%s;", setting.name, setting.value);
+		const CharString dummy_query = query_string.utf8();
+		int rc = sqlite3_exec(p_db, dummy_query.get_data(), NULL, NULL, NULL);
+		if (rc != SQLITE_OK) {
+			error_message = String::utf8(sqlite3_errmsg(p_db));
+			ERR_PRINT("GDSQLite Error: Can't apply pragma " + String(setting.name) + ": " + error_message);
+			r_effective_pragmas.clear();
+			return false;
+		}
+
+		Variant effective_value;
+		sqlite3_stmt *stmt;
+		query_string = vformat("PRAGMA %s;", setting.name);
+		const CharString dummy_read_query = query_string.utf8();
+		if (sqlite3_prepare_v2(p_db, dummy_read_query.get_data(), -1, &stmt, nullptr) == SQLITE_OK) {
+			if (sqlite3_step(stmt) == SQLITE_ROW) {
+				if (sqlite3_column_type(stmt, 0) == SQLITE_INTEGER) {
+					effective_value = (int64_t)sqlite3_column_int64(stmt, 0);
+				} else {
+					effective_value = String::utf8((const char *)sqlite3_column_text(stmt, 0));
+				}
+			}
+			sqlite3_finalize(stmt);
+		}
+		r_effective_pragmas[setting.name] = effective_value;
+
+		if (!gdsqlite_pragma_matches(setting, effective_value)) {
+			WARN_PRINT(vformat("GDSQLite Warning: Pragma %s is %s instead of %s (%s)", setting.name, effective_value, setting.value, path));
+		} else if (verbosity_level > VerbosityLevel::NORMAL) {
+			UtilityFunctions::print(vformat("Applied pragma %s=%s", setting.name, effective_value));
+		}
+	}
+	return true;
+}
+
+/*
+** Switch the database to the configured auto_vacuum mode. Switching from or
+** to AUTO_VACUUM_NONE only takes effect immediately for empty databases,
+** while all other databases have to be rebuilt with a VACUUM first.
+*/
+bool SQLite::apply_auto_vacuum() {
+	if (get_pragma_integer("PRAGMA auto_vacuum;") == auto_vacuum) {
+		return true;
+	}
+	if (read_only) {
+		ERR_PRINT("GDSQLite Error: Can't change the auto_vacuum mode of a read-only database!");
+		return false;
+	}
+
+	String query_string = vformat("PRAGMA auto_vacuum=%d;", auto_vacuum);
+	const CharString dummy_query = query_string.utf8();
+	int rc = sqlite3_exec(db, dummy_query.get_data(), NULL, NULL, NULL);
+	if (rc == SQLITE_OK && get_pragma_integer("PRAGMA auto_vacuum;") != auto_vacuum) {
+		if (verbosity_level > VerbosityLevel::QUIET) {
+			UtilityFunctions::print("Rebuilding database to change its auto_vacuum mode (" + path + ")");
+		}
+		rc = sqlite3_exec(db, "VACUUM;", NULL, NULL, NULL);
+	}
+	if (rc != SQLITE_OK) {
+		update_error_message(rc);
+		ERR_PRINT("GDSQLite Error: Can't change auto_vacuum mode: " + error_message);
+		return false;
+	}
+	return true;
+}
+
+/*
+** Called by SQLite every couple of virtual machine instructions while
+** compacting. The size of the destination file is used as a measure of the
+** progress, which is only checked a couple of times per second. The signal
+** is deferred as the VACUUM is still running, so handlers aren't allowed to
+** use the connection yet.
+*/
+int SQLite::compaction_progress_callback(void *p_context) {
+	compaction_struct *compaction = static_cast<compaction_struct *>(p_context);
+	uint64_t ticks = Time::get_singleton()->get_ticks_msec();
+	if (ticks - compaction->ticks < COMPACTION_PROGRESS_INTERVAL) {
+		return 0;
+	}
+	compaction->ticks = ticks;
+
+	Ref<FileAccess> file = FileAccess::open(compaction->path, FileAccess::READ);
+	if (file.is_valid() && compaction->size > 0) {
+		double progress = MIN((double)file->get_length() / compaction->size, 1.0);
+		compaction->sqlite->call_deferred("emit_signal", "compaction_progress", progress);
+	}
+	return 0;
+}
+
+/*
+** Write a compacted copy of the database to the given path with VACUUM INTO,
+** without modifying the database itself. The destination shouldn't exist yet.
+*/
+bool SQLite::compact_to(String destination_path) {
+	call_guard guard(this);
+	if (db == nullptr) {
+		ERR_PRINT("GDSQLite Error: Can't compact database if connection is not open!");
+		return false;
+	}
+	flush();
+
+	/* The godot VFS of read-only databases is also used for the destination */
+	if (!read_only) {
+		destination_path = ProjectSettings::get_singleton()->globalize_path(destination_path.strip_edges());
+	}
+	/* Kept on the stack, as compactions on the connections of different threads may run at the same time */
+	compaction_struct compaction;
+	compaction.sqlite = this;
+	compaction.path = destination_path;
+	compaction.size = (get_pragma_integer("PRAGMA page_count;") - get_pragma_integer("PRAGMA freelist_count;")) * get_page_size();
+	compaction.ticks = Time::get_singleton()->get_ticks_msec();
+
+	Array param_bindings;
+	param_bindings.append(destination_path);
+	sqlite3_progress_handler(db, COMPACTION_PROGRESS_INSTRUCTIONS, compaction_progress_callback, &compaction);
+	bool success = query_with_bindings("VACUUM INTO ?;", param_bindings);
+	sqlite3_progress_handler(db, 0, NULL, NULL);
+
+	if (success) {
+		/* Deferred as well, such that it arrives after all other progress values */
+		call_deferred("emit_signal", "compaction_progress", 1.0);
+	}
+	return success;
+}
+
+/*
+** Move up to page_count free pages to the end of the database file and
+** truncate them, which only works for databases in AUTO_VACUUM_INCREMENTAL
+** mode. The pages are released in small batches, such that this can be
+** spread across idle frames. Returns the number of free pages that remain,
+** or -1 on failure.
+*/
+int64_t SQLite::incremental_vacuum(int64_t p_page_count) {
+	call_guard guard(this);
+	if (db == nullptr) {
+		ERR_PRINT("GDSQLite Error: Can't vacuum database if connection is not open!");
+		return -1;
+	}
+	if (get_pragma_integer("PRAGMA auto_vacuum;") != AUTO_VACUUM_INCREMENTAL) {
+		ERR_PRINT("GDSQLite Error: Incremental vacuum requires the database to be in AUTO_VACUUM_INCREMENTAL mode!");
+		return -1;
+	}
+
+	int64_t free_pages = get_pragma_integer("PRAGMA freelist_count;");
+	int64_t total = MIN(p_page_count, free_pages);
+	int64_t released = 0;
+	while (released < total) {
+		int64_t batch = MIN(total - released, (int64_t)INCREMENTAL_VACUUM_BATCH_SIZE);
+		String query_string = vformat("PRAGMA incremental_vacuum(%d);", batch);
+		const CharString dummy_query = query_string.utf8();
+		int rc = sqlite3_exec(db, dummy_query.get_data(), NULL, NULL, NULL);
+		if (rc != SQLITE_OK) {
+			update_error_message(rc);
+			ERR_PRINT(" --> SQL error: " + error_message);
+			return -1;
+		}
+		released += batch;
+		emit_signal("compaction_progress", (double)released / total);
+	}
+
+	return get_pragma_integer("PRAGMA freelist_count;");
+}
+
+/*
+** Ask the prefetcher to read the given pages of the main database file.
+** Pages are numbered starting from 1, as is the case everywhere in SQLite.
+*/
+bool SQLite::request_prefetch(sqlite3_int64 p_first_page, sqlite3_int64 p_page_count, int64_t p_page_size) {
+	gdsqlite_prefetch_range range;
+	range.offset = (p_first_page - 1) * p_page_size;
+	range.length = p_page_count * p_page_size;
+	int rc = sqlite3_file_control(db, "main", GDSQLITE_FCNTL_PREFETCH_RANGE, &range);
+	if (rc != SQLITE_OK) {
+		ERR_PRINT("GDSQLite Error: Can't prefetch pages, is the database opened in read-only mode with prefetch enabled?");
+		return false;
+	}
+	return true;
+}
+
+bool SQLite::prefetch_pages(int64_t p_first_page, int64_t p_page_count) {
+	call_guard guard(this);
+	if (db == nullptr) {
+		ERR_PRINT("GDSQLite Error: Can't prefetch pages if connection is not open!");
+		return false;
+	}
+	if (p_first_page < 1 || p_page_count < 1) {
+		ERR_PRINT("GDSQLite Error: Pages are numbered starting from 1 and at least one page has to be prefetched!");
+		return false;
+	}
+
+	int64_t page_size = get_page_size();
+	if (page_size <= 0) {
+		ERR_PRINT("GDSQLite Error: Can't determine the page size of the database!");
+		return false;
+	}
+	return request_prefetch(p_first_page, p_page_count, page_size);
+}
+
+/*
+** Prefetch all pages that belong to the given tables and/or indexes. The
+** pages are looked up with the dbstat virtual table, so consecutive pages
+** are merged into a single request.
+*/
+bool SQLite::prefetch_objects(const PackedStringArray &p_names) {
+	call_guard guard(this);
+#ifdef SQLITE_ENABLE_DBSTAT_VTAB
+	if (db == nullptr) {
+		ERR_PRINT("GDSQLite Error: Can't prefetch objects if connection is not open!");
+		return false;
+	}
+
+	int64_t page_size = get_page_size();
+	if (page_size <= 0) {
+		ERR_PRINT("GDSQLite Error: Can't determine the page size of the database!");
+		return false;
+	}
+
+	sqlite3_stmt *stmt;
+	if (sqlite3_prepare_v2(db, "SELECT pageno FROM dbstat WHERE name = ? ORDER BY pageno;", -1, &stmt, nullptr) != SQLITE_OK) {
+		ERR_PRINT("GDSQLite Error: " + String::utf8(sqlite3_errmsg(db)));
+		return false;
+	}
+
+	bool success = true;
+	for (int64_t i = 0; i < p_names.size() && success; i++) {
+		const CharString name = p_names[i].utf8();
+		sqlite3_bind_text(stmt, 1, name.get_data(), -1, SQLITE_TRANSIENT);
+
+		sqlite3_int64 first_page = 0;
+		sqlite3_int64 page_count = 0;
+		while (sqlite3_step(stmt) == SQLITE_ROW) {
+			sqlite3_int64 page = sqlite3_column_int64(stmt, 0);
+			if (page_count > 0 && page == first_page + page_count) {
+				page_count++;
+				continue;
+			}
+			if (page_count > 0 && !request_prefetch(first_page, page_count, page_size)) {
+				success = false;
+				break;
+			}
+			first_page = page;
+			page_count = 1;
+		}
+		if (success && page_count > 0) {
+			success = request_prefetch(first_page, page_count, page_size);
+		}
+
+		sqlite3_reset(stmt);
+		sqlite3_clear_bindings(stmt);
+	}
+
+	sqlite3_finalize(stmt);
+	return success;
+#else
+	ERR_PRINT("GDSQLite Error: Prefetching objects requires the dbstat virtual table, which isn't enabled in this build!");
+	return false;
+#endif
+}
+
 int SQLite::enable_load_extension(const bool &p_onoff) {
+	call_guard guard(this);
 	int rc;
 	if (p_onoff == true) {
 		rc = sqlite3_enable_load_extension(db, 1);
@@ -1362,7 +4289,31 @@ int SQLite::enable_load_extension(const bool &p_onoff) {
 	return rc;
 }
 
+/*
+** Start a session that records the changes made through this connection, see
+** the SQLiteSession class for more details.
+*/
+Ref<SQLiteSession> SQLite::create_session(const String &p_database_name) {
+	call_guard guard(this, false);
+	if (db == nullptr) {
+		ERR_PRINT("GDSQLite Error: Can't create session if connection is not open!");
+		return Ref<SQLiteSession>();
+	}
+	if (change_notifications == CHANGE_NOTIFICATIONS_VALUES) {
+		ERR_PRINT("GDSQLite Error: Can't create session while change_notifications is set to CHANGE_NOTIFICATIONS_VALUES!");
+		return Ref<SQLiteSession>();
+	}
+
+	Ref<SQLiteSession> session;
+	session.instantiate();
+	if (!session->start(Ref<SQLite>(this), p_database_name)) {
+		return Ref<SQLiteSession>();
+	}
+	return session;
+}
+
 int SQLite::load_extension(const String &p_path, const String &entrypoint) {
+	call_guard guard(this);
 	int rc;
 
 	char *zErrMsg = nullptr;
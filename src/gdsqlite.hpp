@@ -8,17 +8,42 @@
 
 #include <godot_cpp/classes/global_constants.hpp>
 #include <godot_cpp/classes/json.hpp>
-#include <godot_cpp/classes/marshalls.hpp>
 #include <godot_cpp/classes/project_settings.hpp>
-
+#include <godot_cpp/classes/time.hpp>
+#include <godot_cpp/classes/worker_thread_pool.hpp>
+#include <godot_cpp/variant/callable_method_pointer.hpp>
+
+#include <gdsqlite_base64.hpp>
+#include <gdsqlite_binary.hpp>
+#include <gdsqlite_csv.hpp>
+#include <gdsqlite_json.hpp>
+#include <gdsqlite_pragmas.hpp>
 #include <sqlite/sqlite3.h>
+#include <vfs/gdsqlite_compressed_vfs.hpp>
 #include <vfs/gdsqlite_vfs.hpp>
+#include <algorithm>
 #include <cstring>
-#include <fstream>
 #include <memory>
-#include <sstream>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
 #include <vector>
 
+/*
+** While compacting, the progress is checked every couple of thousand virtual
+** machine instructions but only reported once per interval (in milliseconds).
+*/
+#define COMPACTION_PROGRESS_INSTRUCTIONS 10000
+#define COMPACTION_PROGRESS_INTERVAL 100
+
+/*
+** The number of pages that are released at once by incremental_vacuum().
+*/
+#define INCREMENTAL_VACUUM_BATCH_SIZE 64
+
 namespace godot {
 enum OBJECT_TYPE {
 	TABLE,
@@ -29,34 +54,264 @@ enum OBJECT_TYPE {
 struct object_struct {
 	String name, sql;
 	OBJECT_TYPE type;
-	Array base64_columns, row_array;
+	std::unordered_set<std::string> base64_columns;
+};
+struct export_object_struct {
+	String type, name, sql;
+	bool has_sql = false;
+
+	/* Output of the table when it's exported by a worker thread */
+	bool success = false;
+	String error;
+	std::string json;
+	gdsqlite_binary_writer binary;
+};
+struct cell_struct {
+	std::string column, text;
+	JSON_TOKEN token;
+	int64_t integer;
+	double real;
+	/* Decoded contents of strings in one of the base64_columns */
+	bool is_blob = false;
+	std::vector<uint8_t> blob;
+};
+
+struct thread_state_struct {
+	/* Connection of the thread in THREADING_MODE_MULTI_THREAD, if it isn't the main thread */
+	sqlite3 *db = nullptr;
+	TypedArray<Dictionary> query_result;
+	String error_message;
+	int64_t last_insert_rowid = 0;
+	int64_t helper_savepoint_depth = 0;
+};
+
+struct table_changes_struct {
+	std::vector<int64_t> inserted, updated, deleted;
+};
+
+struct table_change_counts_struct {
+	size_t inserted = 0, updated = 0, deleted = 0;
+};
+
+/* Number of pending changes when a savepoint was started, such that rolling
+** back to the savepoint also discards the changes that were made since */
+struct savepoint_marker_struct {
+	String name;
+	std::unordered_map<std::string, table_change_counts_struct> change_counts;
+	int64_t row_change_count = 0;
+};
+
+struct subscription_struct {
+	Callable callable;
+	int64_t kinds;
+};
+
+struct table_subscriptions_struct {
+	std::vector<subscription_struct> subscribers;
+	/* Union of the kinds of all subscribers, checked by the update hook */
+	int64_t kinds = 0;
+};
+
+class SQLite;
+class SQLiteBackup;
+class SQLiteLiveQuery;
+class SQLiteSession;
+class SQLiteSnapshot;
+
+/* Outermost call of a thread that is running on an SQLite object, see SQLite::call_guard */
+struct call_frame_struct {
+	const SQLite *sqlite = nullptr;
+	/* State of the thread while it's running on a connection of its own, nullptr otherwise */
+	thread_state_struct *state = nullptr;
+	call_frame_struct *previous = nullptr;
+};
+
+/* State of a compaction that is running, passed to its progress handler */
+struct compaction_struct {
+	SQLite *sqlite = nullptr;
+	String path;
+	int64_t size = 0;
+	uint64_t ticks = 0;
 };
 
 class SQLite : public RefCounted {
 	GDCLASS(SQLite, RefCounted)
 
+	friend class SQLiteBackup;
+	friend class SQLiteLiveQuery;
+	friend class SQLiteSession;
+
 private:
-	bool validate_json(const Array &import_json, std::vector<object_struct> &tables_to_import);
+	/*
+	** Serializes all calls when threading_mode isn't THREADING_MODE_SINGLE_THREAD
+	** and keeps track of the results per thread. In THREADING_MODE_MULTI_THREAD,
+	** calls from other threads than the one that opened the database are
+	** executed on a connection of their own instead, without waiting for any
+	** other calls. Only opening and closing the database waits for them.
+	*/
+	class call_guard {
+		SQLite *sqlite;
+		call_frame_struct frame;
+		std::shared_lock<std::shared_mutex> connection_lock;
+
+	public:
+		call_guard(SQLite *p_sqlite, bool p_thread_connection = true);
+		~call_guard();
+	};
+
+	/*
+	** Member that belongs to the calling thread while it's running on a
+	** connection of its own, see call_guard. All other calls share it.
+	*/
+	template <typename T, T thread_state_struct::*P_MEMBER>
+	class thread_member {
+		const SQLite *sqlite;
+		T shared;
+
+	public:
+		thread_member(const SQLite *p_sqlite, const T &p_value) :
+				sqlite(p_sqlite), shared(p_value) {}
+
+		T &get() {
+			thread_state_struct *state = sqlite->get_call_state();
+			return state ? state->*P_MEMBER : shared;
+		}
+		const T &get() const {
+			const thread_state_struct *state = sqlite->get_call_state();
+			return state ? state->*P_MEMBER : shared;
+		}
+		T &get_shared() { return shared; }
+		const T &get_shared() const { return shared; }
+
+		operator T &() { return get(); }
+		operator const T &() const { return get(); }
+		thread_member &operator=(const T &p_value) {
+			get() = p_value;
+			return *this;
+		}
+	};
+
+	int open_connection(sqlite3 **r_db);
+	sqlite3 *open_thread_connection();
+	call_frame_struct *find_call_frame() const;
+	thread_state_struct *get_call_state() const;
+	bool on_thread_connection() const;
+	const thread_state_struct *get_thread_state() const;
+	bool import_json(gdsqlite_json_reader &p_reader);
+	bool read_json_schema(gdsqlite_json_reader &p_reader, std::vector<object_struct> &r_objects);
+	bool import_json_rows(gdsqlite_json_reader &p_reader, const std::vector<object_struct> &p_objects);
+	bool import_json_table_rows(gdsqlite_json_reader &p_reader, const object_struct &p_object);
 	bool validate_table_dict(const Dictionary &p_table_dict);
 	int backup_database(sqlite3 *source_db, sqlite3 *destination_db);
+	static int open_backup_db(const String &p_path, bool p_read_only, sqlite3 **r_db);
 	void remove_shadow_tables(Array &p_array);
+	bool write_json(gdsqlite_json_writer &p_writer);
+	static bool write_binary_table(sqlite3 *p_db, gdsqlite_binary_writer &p_writer, const String &p_name, String &r_error);
+	bool read_binary_objects(gdsqlite_binary_reader &p_reader, bool p_import);
+	bool read_binary_table(gdsqlite_binary_reader &p_reader, const String &p_name, bool p_import);
+	bool clear_database();
+	bool get_exported_objects(std::vector<export_object_struct> &r_objects);
+	bool can_export_in_parallel();
+	bool run_parallel_export(std::vector<export_object_struct> &r_objects, bool p_binary, bool p_compact);
+	void export_table_task(uint32_t p_index);
+	bool table_exists(const String &p_name);
 	bool prepare_statement(const CharString &p_query, sqlite3_stmt **out_stmt, const char** pzTail);
 	bool bind_parameter(Variant binding_value, sqlite3_stmt *stmt, int i);
 	bool execute_statement(sqlite3_stmt *stmt);
+	static int read_statement_rows(sqlite3_stmt *stmt, TypedArray<Dictionary> &r_rows);
 	void update_error_message(int rc);
+	bool request_prefetch(sqlite3_int64 p_first_page, sqlite3_int64 p_page_count, int64_t p_page_size);
+	int64_t get_page_size();
+	int64_t get_pragma_integer(const char *p_pragma);
+	bool apply_auto_vacuum();
+	bool apply_pragmas(sqlite3 *p_db, const std::vector<gdsqlite_pragma_setting> &p_settings, Dictionary &r_effective_pragmas);
+	static int compaction_progress_callback(void *p_context);
+	bool execute_transaction_statement(const String &p_statement);
+	bool begin_helper_savepoint(bool &r_outermost);
+	bool end_helper_savepoint(bool p_success, bool p_outermost);
+	bool prepare_write_batch(sqlite3_stmt *p_stmt);
+	bool begin_write_batch();
+	bool is_write_batch_full() const;
+	void finish_write_batch(bool p_success);
+	void flush_scheduled_write_batch();
+
+	static void update_hook_callback(void *db_ref, int notif_type, char const *db_name, char const *table_name, sqlite3_int64 row_id);
+	static int commit_hook_callback(void *db_ref);
+	static void rollback_hook_callback(void *db_ref);
+	void push_savepoint_marker(const String &p_name);
+	void release_savepoint_marker(const String &p_name);
+	void rollback_savepoint_marker(const String &p_name);
+#ifdef SQLITE_ENABLE_PREUPDATE_HOOK
+	static void preupdate_hook_callback(void *db_ref, sqlite3 *db, int notif_type, char const *db_name, char const *table_name, sqlite3_int64 old_row_id, sqlite3_int64 new_row_id);
+#endif
+	void update_hooks();
+	void flush_committed_changes();
+	static void update_subscribed_kinds(table_subscriptions_struct &p_table);
 
 	String normalize_path(const String p_path, const bool read_only) const;
 
-	sqlite3 *db;
+	thread_member<sqlite3 *, &thread_state_struct::db> db{ this, nullptr };
 	std::vector<std::unique_ptr<Callable>> function_registry;
+	/* Backups, live queries and sessions have to be released before the connection can be closed */
+	std::vector<SQLiteBackup *> backups;
+	std::vector<SQLiteLiveQuery *> live_queries;
+	std::vector<SQLiteSession *> sessions;
 
 	int64_t verbosity_level = 1;
 	bool foreign_keys = false;
 	bool read_only = false;
+	bool prefetch = false;
+	int64_t export_thread_count = 1;
+	int64_t auto_vacuum = -1;
+	String pragma_preset = "";
+	Dictionary pragmas;
+	Dictionary effective_pragmas;
+	int64_t change_notifications = 0;
+	int64_t threading_mode = 0;
+	bool write_batching = false;
+	int64_t write_batch_size = 1000;
+	int64_t write_batch_msec = 0;
 	String path = "default";
-	String error_message = "";
+	thread_member<String, &thread_state_struct::error_message> error_message{ this, "" };
 	String default_extension = "db";
-	TypedArray<Dictionary> query_result = TypedArray<Dictionary>();
+	thread_member<TypedArray<Dictionary>, &thread_state_struct::query_result> query_result{ this, TypedArray<Dictionary>() };
+
+	/* State that is shared with the worker threads of a parallel export */
+	std::vector<export_object_struct> *export_objects = nullptr;
+	std::vector<size_t> export_table_indices;
+	std::vector<sqlite3 *> export_connection_pool;
+	std::mutex export_mutex;
+	bool export_binary = false;
+	bool export_compact = false;
+
+	/* Changes of the current transaction and of the committed transactions that
+	** haven't been reported yet, when change notifications are batched */
+	std::unordered_map<std::string, table_changes_struct> pending_changes;
+	std::unordered_map<std::string, table_changes_struct> committed_changes;
+	bool changes_flush_scheduled = false;
+	/* Row changes including their column values, grouped per transaction */
+	Array pending_row_changes;
+	Array committed_transactions;
+	std::vector<savepoint_marker_struct> savepoint_markers;
+	bool preupdate_hook_installed = false;
+	std::unordered_map<std::string, table_subscriptions_struct> subscriptions;
+
+	/* State that is kept per thread, see call_guard */
+	mutable std::recursive_mutex call_mutex;
+	/* Held shared by the calls on connections of other threads, exclusively while opening or closing */
+	std::shared_mutex connection_mutex;
+	/* Protects thread_states and effective_pragmas, which are read outside of calls as well */
+	mutable std::mutex state_mutex;
+	std::thread::id owner_thread;
+	std::unordered_map<std::thread::id, thread_state_struct> thread_states;
+
+	/* Implicit transaction that collects the writes of a frame when write_batching is enabled */
+	bool write_batch_open = false;
+	bool write_batch_flush_scheduled = false;
+	int64_t write_batch_statement_count = 0;
+	uint64_t write_batch_start_ticks = 0;
+	thread_member<int64_t, &thread_state_struct::helper_savepoint_depth> helper_savepoint_depth{ this, 0 };
+	std::vector<Callable> durability_callbacks;
 
 protected:
 	static void _bind_methods();
@@ -70,6 +325,39 @@ public:
 		VERY_VERBOSE = 3
 	};
 
+	enum ChangeNotifications {
+		CHANGE_NOTIFICATIONS_NONE = 0,
+		CHANGE_NOTIFICATIONS_ROW = 1,
+		CHANGE_NOTIFICATIONS_BATCHED = 2,
+		CHANGE_NOTIFICATIONS_VALUES = 3
+	};
+
+	enum ChangeKind {
+		CHANGE_INSERT = 1,
+		CHANGE_UPDATE = 2,
+		CHANGE_DELETE = 4,
+		CHANGE_ALL = 7
+	};
+
+	enum AutoVacuum {
+		AUTO_VACUUM_UNCHANGED = -1,
+		AUTO_VACUUM_NONE = 0,
+		AUTO_VACUUM_FULL = 1,
+		AUTO_VACUUM_INCREMENTAL = 2
+	};
+
+	enum ThreadingMode {
+		THREADING_MODE_SINGLE_THREAD = 0,
+		THREADING_MODE_SERIALIZED = 1,
+		THREADING_MODE_MULTI_THREAD = 2
+	};
+
+	enum TransactionMode {
+		TRANSACTION_DEFERRED = 0,
+		TRANSACTION_IMMEDIATE = 1,
+		TRANSACTION_EXCLUSIVE = 2
+	};
+
 	SQLite();
 	~SQLite();
 
@@ -80,11 +368,28 @@ public:
 	bool query_with_bindings(const String &p_query, Array param_bindings);
 	bool query_with_named_bindings(const String &p_query, Dictionary param_bindings);
 
+	bool begin(int64_t p_mode);
+	bool commit();
+	bool rollback();
+	bool savepoint(const String &p_name);
+	bool release(const String &p_name);
+	bool rollback_to(const String &p_name);
+
+	Ref<SQLiteSnapshot> snapshot_open(const String &p_database_name);
+	bool begin_read_snapshot(const Ref<SQLiteSnapshot> &p_snapshot);
+
+	bool flush();
+	void call_when_durable(const Callable &p_callable);
+
 	bool create_table(const String &p_name, const Dictionary &p_table_dict);
 	bool drop_table(const String &p_name);
 
 	bool backup_to(String destination_path);
 	bool restore_from(String source_path);
+	PackedByteArray backup_to_buffer();
+	bool restore_from_buffer(const PackedByteArray &p_database_buffer);
+	Ref<SQLiteBackup> begin_backup_to(const String &p_destination_path);
+	Ref<SQLiteBackup> begin_restore_from(const String &p_source_path);
 
 	bool insert_row(const String &p_name, const Dictionary &p_row_dict);
 	bool insert_rows(const String &p_name, const Array &p_row_array);
@@ -96,18 +401,42 @@ public:
 	bool create_function(const String &p_name, const Callable &p_callable, int p_argc);
 
 	bool import_from_json(String import_path);
-	bool export_to_json(String export_path);
+	bool export_to_json(String export_path, bool p_compact);
 
 	bool import_from_buffer(PackedByteArray json_buffer);
-	PackedByteArray export_to_buffer();
+	PackedByteArray export_to_buffer(bool p_compact);
+
+	bool import_from_binary(PackedByteArray binary_buffer);
+	PackedByteArray export_to_binary(bool p_compress);
+
+	bool import_csv(const String &p_table_name, String p_import_path, const Dictionary &p_options);
+	bool export_csv(const String &p_query, String p_export_path, const Dictionary &p_options);
 
 	int get_autocommit() const;
 	int compileoption_used(const String &option_name) const;
 
+	Ref<SQLiteLiveQuery> watch_query(const String &p_query, const Array &p_param_bindings);
+
+	bool subscribe_changes(const String &p_table_name, const Callable &p_callable, BitField<ChangeKind> p_kinds);
+	bool unsubscribe_changes(const String &p_table_name, const Callable &p_callable);
+	void flush_changes();
+
+	Dictionary get_io_stats() const;
+	void reset_io_stats();
+
+	bool prefetch_pages(int64_t p_first_page, int64_t p_page_count);
+	bool prefetch_objects(const PackedStringArray &p_names);
+
+	bool compact_to(String destination_path);
+	int64_t incremental_vacuum(int64_t p_page_count);
+
+	Ref<SQLiteSession> create_session(const String &p_database_name);
+
 	int load_extension(const String &p_path, const String &p_init_func_name);
 	int enable_load_extension(const bool &p_onoff);
 
 	static String sanitize_identifier(const String &p_name);
+	static bool compress_database(const String &p_source_path, const String &p_destination_path, int64_t p_block_size, int64_t p_compression_mode);
 
 	// Properties.
 	void set_last_insert_rowid(const int64_t &p_last_insert_rowid);
@@ -122,6 +451,38 @@ public:
 	void set_read_only(const bool &p_read_only);
 	bool get_read_only() const;
 
+	void set_prefetch(const bool &p_prefetch);
+	bool get_prefetch() const;
+
+	void set_export_thread_count(const int64_t &p_export_thread_count);
+	int64_t get_export_thread_count() const;
+
+	void set_change_notifications(const int64_t &p_change_notifications);
+	int64_t get_change_notifications() const;
+
+	void set_threading_mode(const int64_t &p_threading_mode);
+	int64_t get_threading_mode() const;
+
+	void set_write_batching(const bool &p_write_batching);
+	bool get_write_batching() const;
+
+	void set_write_batch_size(const int64_t &p_write_batch_size);
+	int64_t get_write_batch_size() const;
+
+	void set_write_batch_msec(const int64_t &p_write_batch_msec);
+	int64_t get_write_batch_msec() const;
+
+	void set_auto_vacuum(const int64_t &p_auto_vacuum);
+	int64_t get_auto_vacuum() const;
+
+	void set_pragma_preset(const String &p_pragma_preset);
+	String get_pragma_preset() const;
+
+	void set_pragmas(const Dictionary &p_pragmas);
+	Dictionary get_pragmas() const;
+
+	Dictionary get_effective_pragmas() const;
+
 	void set_path(const String &p_path);
 	String get_path() const;
 
@@ -140,5 +501,10 @@ public:
 } //namespace godot
 
 VARIANT_ENUM_CAST(SQLite::VerbosityLevel);
+VARIANT_ENUM_CAST(SQLite::ChangeNotifications);
+VARIANT_BITFIELD_CAST(SQLite::ChangeKind);
+VARIANT_ENUM_CAST(SQLite::AutoVacuum);
+VARIANT_ENUM_CAST(SQLite::TransactionMode);
+VARIANT_ENUM_CAST(SQLite::ThreadingMode);
 
 #endif // ! SQLITE_CLASS_H
@@ -0,0 +1,238 @@
+#include "gdsqlite_backup.hpp"
+#include "gdsqlite.hpp"
+
+#include <godot_cpp/classes/worker_thread_pool.hpp>
+#include <godot_cpp/variant/callable_method_pointer.hpp>
+
+#include <algorithm>
+
+using namespace godot;
+
+void SQLiteBackup::_bind_methods() {
+	// Methods.
+	ClassDB::bind_method(D_METHOD("step", "page_count"), &SQLiteBackup::step, DEFVAL(64));
+	ClassDB::bind_method(D_METHOD("run_in_background", "pages_per_step", "sleep_msec"), &SQLiteBackup::run_in_background, DEFVAL(64), DEFVAL(0));
+	ClassDB::bind_method(D_METHOD("cancel"), &SQLiteBackup::cancel);
+
+	ClassDB::bind_method(D_METHOD("is_finished"), &SQLiteBackup::is_finished);
+	ClassDB::bind_method(D_METHOD("get_remaining"), &SQLiteBackup::get_remaining);
+	ClassDB::bind_method(D_METHOD("get_page_count"), &SQLiteBackup::get_page_count);
+
+	// Signals.
+	ADD_SIGNAL(MethodInfo("progress", PropertyInfo(Variant::INT, "remaining"), PropertyInfo(Variant::INT, "page_count")));
+	ADD_SIGNAL(MethodInfo("completed", PropertyInfo(Variant::BOOL, "success")));
+}
+
+SQLiteBackup::SQLiteBackup() {
+}
+
+SQLiteBackup::~SQLiteBackup() {
+	release();
+}
+
+/*
+** Open the file on the other end of the backup and initialize the backup
+** itself. When restoring, the file is the source and the connection of the
+** SQLite object is the destination, and vice versa.
+*/
+bool SQLiteBackup::start(const Ref<SQLite> &p_database, const String &p_path, bool p_restore) {
+	file_path = p_path;
+	int rc = SQLite::open_backup_db(p_path, p_restore, &file_db);
+	if (rc != SQLITE_OK) {
+		/* Without a connection, the reason has already been printed */
+		if (file_db == nullptr) {
+			return false;
+		}
+		ERR_PRINT("GDSQLite Error: Can't open database: " + String::utf8(sqlite3_errmsg(file_db)) + " (" + file_path + ")");
+		sqlite3_close_v2(file_db);
+		file_db = nullptr;
+		return false;
+	}
+
+	sqlite3 *source_db = p_restore ? file_db : p_database->db;
+	sqlite3 *destination_db = p_restore ? p_database->db : file_db;
+	backup = sqlite3_backup_init(destination_db, "main", source_db, "main");
+	if (backup == nullptr) {
+		ERR_PRINT("GDSQLite Error: Can't start backup: " + String::utf8(sqlite3_errmsg(destination_db)));
+		sqlite3_close_v2(file_db);
+		file_db = nullptr;
+		return false;
+	}
+
+	database = p_database;
+	database->backups.push_back(this);
+	return true;
+}
+
+/*
+** Copy up to p_page_count pages, or all remaining pages if negative. The
+** backup is finished as soon as all pages have been copied or an error
+** occurs. Busy or locked databases are simply retried by the next step.
+*/
+int SQLiteBackup::step_backup(int64_t p_page_count) {
+	int rc = sqlite3_backup_step(backup, (int)CLAMP(p_page_count, (int64_t)-1, (int64_t)INT32_MAX));
+	remaining = sqlite3_backup_remaining(backup);
+	page_count = sqlite3_backup_pagecount(backup);
+	if (rc == SQLITE_OK || rc == SQLITE_BUSY || rc == SQLITE_LOCKED) {
+		return rc;
+	}
+
+	int finish_rc = sqlite3_backup_finish(backup);
+	backup = nullptr;
+	if (rc == SQLITE_DONE && finish_rc != SQLITE_OK) {
+		rc = finish_rc;
+	}
+	if (rc != SQLITE_DONE) {
+		ERR_PRINT("GDSQLite Error: Backup failed: " + String::utf8(sqlite3_errstr(rc)) + " (" + file_path + ")");
+	}
+	result = rc;
+	finish_backup();
+	return rc;
+}
+
+/*
+** Abort the backup if it's still running and close the file.
+*/
+void SQLiteBackup::finish_backup() {
+	if (backup) {
+		sqlite3_backup_finish(backup);
+		backup = nullptr;
+	}
+	if (file_db) {
+		sqlite3_close_v2(file_db);
+		file_db = nullptr;
+	}
+	finished = true;
+}
+
+int SQLiteBackup::step(int64_t p_page_count) {
+	if (finished) {
+		return result;
+	}
+	if (task_id != -1) {
+		ERR_PRINT("GDSQLite Error: Can't step through a backup that is running in the background!");
+		return SQLITE_MISUSE;
+	}
+
+	int rc = step_backup(p_page_count);
+	emit_signal("progress", remaining.load(), page_count.load());
+	if (finished) {
+		emit_signal("completed", rc == SQLITE_DONE);
+	}
+	return rc;
+}
+
+/*
+** Copy the remaining pages on the WorkerThreadPool. Sleeping in between steps
+** gives other connections the chance to write to the source database. The
+** signals are emitted on the main thread.
+*/
+bool SQLiteBackup::run_in_background(int64_t p_pages_per_step, int64_t p_sleep_msec) {
+	if (finished) {
+		ERR_PRINT("GDSQLite Error: Can't run a backup that has already finished!");
+		return false;
+	}
+	if (task_id != -1) {
+		ERR_PRINT("GDSQLite Error: Backup is already running in the background!");
+		return false;
+	}
+	if (database.is_valid() && database->threading_mode == SQLite::THREADING_MODE_MULTI_THREAD) {
+		/* The connection isn't protected by SQLite's mutexes in this mode */
+		ERR_PRINT("GDSQLite Error: Backups can't run in the background on connections that use THREADING_MODE_MULTI_THREAD!");
+		return false;
+	}
+
+	pages_per_step = p_pages_per_step;
+	sleep_msec = p_sleep_msec;
+	task_reference = Ref<SQLiteBackup>(this);
+	task_id = WorkerThreadPool::get_singleton()->add_task(callable_mp(this, &SQLiteBackup::run_task), false, "GDSQLite backup");
+	return true;
+}
+
+/*
+** Busy or locked databases are always retried after a short while, instead
+** of spinning until the other connection is done.
+*/
+void SQLiteBackup::run_task() {
+	while (!finished) {
+		if (cancelled) {
+			result = SQLITE_ABORT;
+			finish_backup();
+			break;
+		}
+		int rc = step_backup(pages_per_step);
+		call_deferred("emit_signal", "progress", remaining.load(), page_count.load());
+		if (finished) {
+			break;
+		}
+		if (rc == SQLITE_BUSY || rc == SQLITE_LOCKED) {
+			sqlite3_sleep((int)MAX(sleep_msec, (int64_t)BACKUP_BUSY_SLEEP_MSEC));
+		} else if (sleep_msec > 0) {
+			sqlite3_sleep((int)sleep_msec);
+		}
+	}
+	callable_mp(this, &SQLiteBackup::complete_task).call_deferred(result == SQLITE_DONE);
+}
+
+/*
+** Runs on the main thread once the task has stopped. The reference of the
+** task might be the last one, so it's only dropped after emitting.
+*/
+void SQLiteBackup::complete_task(bool p_success) {
+	if (task_id != -1) {
+		WorkerThreadPool::get_singleton()->wait_for_task_completion(task_id);
+		task_id = -1;
+	}
+	Ref<SQLiteBackup> reference = task_reference;
+	task_reference.unref();
+	emit_signal("completed", p_success);
+}
+
+/*
+** Stop the backup if it's still running. Returns true if the completed signal
+** still has to be emitted, as a background task emits it by itself.
+*/
+bool SQLiteBackup::abort_backup() {
+	cancelled = true;
+	if (task_id != -1) {
+		WorkerThreadPool::get_singleton()->wait_for_task_completion(task_id);
+		task_id = -1;
+		return false;
+	}
+	if (finished) {
+		return false;
+	}
+	result = SQLITE_ABORT;
+	finish_backup();
+	return true;
+}
+
+void SQLiteBackup::cancel() {
+	if (abort_backup()) {
+		emit_signal("completed", false);
+	}
+}
+
+/*
+** Stop the backup, which has to happen before its connection is closed.
+*/
+void SQLiteBackup::release() {
+	abort_backup();
+	if (database.is_valid()) {
+		std::vector<SQLiteBackup *> &backups = database->backups;
+		backups.erase(std::remove(backups.begin(), backups.end(), this), backups.end());
+		database.unref();
+	}
+}
+
+bool SQLiteBackup::is_finished() const {
+	return finished;
+}
+
+int64_t SQLiteBackup::get_remaining() const {
+	return remaining;
+}
+
+int64_t SQLiteBackup::get_page_count() const {
+	return page_count;
+}
@@ -0,0 +1,79 @@
+#ifndef SQLITE_BACKUP_CLASS_H
+#define SQLITE_BACKUP_CLASS_H
+
+#include <godot_cpp/classes/ref_counted.hpp>
+#include <godot_cpp/core/binder_common.hpp>
+#include <godot_cpp/core/class_db.hpp>
+
+#include <sqlite/sqlite3.h>
+
+#include <atomic>
+
+/*
+** Minimum time that a background backup waits before retrying a step on a
+** busy or locked database, even when no sleep_msec was requested.
+*/
+#define BACKUP_BUSY_SLEEP_MSEC 10
+
+namespace godot {
+class SQLite;
+
+/*
+** Copies a database to or from a file a couple of pages at a time, using
+** SQLite's online backup API. The backup is either stepped through manually,
+** for example once per frame, or runs on the WorkerThreadPool. Changes made
+** to the source database in the meantime are picked up automatically.
+** Backups are created with SQLite::begin_backup_to() and
+** SQLite::begin_restore_from().
+*/
+class SQLiteBackup : public RefCounted {
+	GDCLASS(SQLiteBackup, RefCounted)
+
+	friend class SQLite;
+
+private:
+	Ref<SQLite> database;
+	sqlite3 *file_db = nullptr;
+	sqlite3_backup *backup = nullptr;
+	String file_path;
+
+	std::atomic<int64_t> remaining{ 0 };
+	std::atomic<int64_t> page_count{ 0 };
+	std::atomic<bool> finished{ false };
+	std::atomic<bool> cancelled{ false };
+	int result = SQLITE_OK;
+
+	/* Keeps the backup alive while its task is running on the WorkerThreadPool */
+	Ref<SQLiteBackup> task_reference;
+	int64_t task_id = -1;
+	int64_t pages_per_step = 64;
+	int64_t sleep_msec = 0;
+
+	bool start(const Ref<SQLite> &p_database, const String &p_path, bool p_restore);
+	int step_backup(int64_t p_page_count);
+	void finish_backup();
+	bool abort_backup();
+	void run_task();
+	void complete_task(bool p_success);
+	void release();
+
+protected:
+	static void _bind_methods();
+
+public:
+	SQLiteBackup();
+	~SQLiteBackup();
+
+	// Functions.
+	int step(int64_t p_page_count);
+	bool run_in_background(int64_t p_pages_per_step, int64_t p_sleep_msec);
+	void cancel();
+
+	bool is_finished() const;
+	int64_t get_remaining() const;
+	int64_t get_page_count() const;
+};
+
+} //namespace godot
+
+#endif // ! SQLITE_BACKUP_CLASS_H
@@ -0,0 +1,143 @@
+#include "gdsqlite_base64.hpp"
+
+using namespace godot;
+
+#define BASE64_INVALID 0xFF
+#define BASE64_WHITESPACE 0xFE
+#define BASE64_PADDING 0xFD
+
+namespace {
+struct base64_tables {
+	/* Both characters for every possible 12-bit group */
+	char pairs[4096][2];
+	/* Value of every character, or one of the markers defined above */
+	uint8_t values[256];
+
+	base64_tables() {
+		static const char alphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+		for (int i = 0; i < 4096; i++) {
+			pairs[i][0] = alphabet[i >> 6];
+			pairs[i][1] = alphabet[i & 0x3F];
+		}
+		for (int i = 0; i < 256; i++) {
+			values[i] = BASE64_INVALID;
+		}
+		for (int i = 0; i < 64; i++) {
+			values[(uint8_t)alphabet[i]] = (uint8_t)i;
+		}
+		values[(uint8_t)' '] = BASE64_WHITESPACE;
+		values[(uint8_t)'\t'] = BASE64_WHITESPACE;
+		values[(uint8_t)'\r'] = BASE64_WHITESPACE;
+		values[(uint8_t)'\n'] = BASE64_WHITESPACE;
+		values[(uint8_t)'='] = BASE64_PADDING;
+	}
+};
+
+/* Built on first use, which is thread-safe as export workers encode in parallel */
+const base64_tables &get_tables() {
+	static const base64_tables tables;
+	return tables;
+}
+} //namespace
+
+size_t godot::gdsqlite_base64_encoded_size(size_t p_size) {
+	return (p_size + 2) / 3 * 4;
+}
+
+void godot::gdsqlite_base64_encode(const uint8_t *p_data, size_t p_size, char *r_output) {
+	const base64_tables &tables = get_tables();
+
+	size_t i = 0;
+	for (; i + 3 <= p_size; i += 3) {
+		uint32_t group = ((uint32_t)p_data[i] << 16) | ((uint32_t)p_data[i + 1] << 8) | p_data[i + 2];
+		const char *high = tables.pairs[group >> 12];
+		const char *low = tables.pairs[group & 0xFFF];
+		r_output[0] = high[0];
+		r_output[1] = high[1];
+		r_output[2] = low[0];
+		r_output[3] = low[1];
+		r_output += 4;
+	}
+
+	size_t remaining = p_size - i;
+	if (remaining > 0) {
+		uint32_t group = (uint32_t)p_data[i] << 16;
+		if (remaining == 2) {
+			group |= (uint32_t)p_data[i + 1] << 8;
+		}
+		const char *high = tables.pairs[group >> 12];
+		const char *low = tables.pairs[group & 0xFFF];
+		r_output[0] = high[0];
+		r_output[1] = high[1];
+		r_output[2] = remaining == 2 ? low[0] : '=';
+		r_output[3] = '=';
+	}
+}
+
+bool godot::gdsqlite_base64_decode(const char *p_data, size_t p_size, std::vector<uint8_t> &r_output) {
+	const base64_tables &tables = get_tables();
+	const uint8_t *input = reinterpret_cast<const uint8_t *>(p_data);
+
+	r_output.resize(p_size / 4 * 3 + 3);
+	uint8_t *output = r_output.data();
+
+	/* Fast path for groups of four valid characters, which covers everything
+	** but the padding at the end of well-formed input */
+	size_t i = 0;
+	for (; i + 4 <= p_size; i += 4) {
+		uint8_t a = tables.values[input[i]];
+		uint8_t b = tables.values[input[i + 1]];
+		uint8_t c = tables.values[input[i + 2]];
+		uint8_t d = tables.values[input[i + 3]];
+		if ((a | b | c | d) & 0xC0) {
+			break;
+		}
+		uint32_t group = ((uint32_t)a << 18) | ((uint32_t)b << 12) | ((uint32_t)c << 6) | d;
+		output[0] = (uint8_t)(group >> 16);
+		output[1] = (uint8_t)(group >> 8);
+		output[2] = (uint8_t)group;
+		output += 3;
+	}
+
+	/* Whatever remains is decoded one character at a time */
+	uint32_t group = 0;
+	int count = 0;
+	bool padded = false;
+	for (; i < p_size; i++) {
+		uint8_t value = tables.values[input[i]];
+		if (value == BASE64_WHITESPACE) {
+			continue;
+		}
+		if (value == BASE64_PADDING) {
+			padded = true;
+			continue;
+		}
+		if (value == BASE64_INVALID || padded) {
+			r_output.clear();
+			return false;
+		}
+		group = (group << 6) | value;
+		if (++count == 4) {
+			output[0] = (uint8_t)(group >> 16);
+			output[1] = (uint8_t)(group >> 8);
+			output[2] = (uint8_t)group;
+			output += 3;
+			group = 0;
+			count = 0;
+		}
+	}
+
+	if (count == 1) {
+		r_output.clear();
+		return false;
+	}
+	if (count == 2) {
+		*output++ = (uint8_t)(group >> 4);
+	} else if (count == 3) {
+		*output++ = (uint8_t)(group >> 10);
+		*output++ = (uint8_t)(group >> 2);
+	}
+
+	r_output.resize(output - r_output.data());
+	return true;
+}
@@ -0,0 +1,27 @@
+#ifndef GDSQLITE_BASE64_H
+#define GDSQLITE_BASE64_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace godot {
+/*
+** Base64 (RFC 4648) encoding and decoding of blobs, writing straight into the
+** buffers of the caller instead of going through PackedByteArray and String.
+** Both directions are table-driven: the encoder emits two characters per
+** lookup and the decoder converts four characters into three bytes at once.
+*/
+size_t gdsqlite_base64_encoded_size(size_t p_size);
+void gdsqlite_base64_encode(const uint8_t *p_data, size_t p_size, char *r_output);
+
+/*
+** Decode into r_output, which is resized to the number of decoded bytes.
+** Whitespace is skipped and padding is optional. Returns false if the input
+** contains any other characters that aren't part of the alphabet.
+*/
+bool gdsqlite_base64_decode(const char *p_data, size_t p_size, std::vector<uint8_t> &r_output);
+
+} //namespace godot
+
+#endif
@@ -0,0 +1,157 @@
+#include "gdsqlite_binary.hpp"
+
+using namespace godot;
+
+void gdsqlite_binary_writer::put_u8(uint8_t p_value) {
+	buffer.push_back(p_value);
+}
+
+void gdsqlite_binary_writer::put_u32(uint32_t p_value) {
+	for (int i = 0; i < 4; i++) {
+		buffer.push_back((uint8_t)(p_value >> (8 * i)));
+	}
+}
+
+void gdsqlite_binary_writer::put_u64(uint64_t p_value) {
+	for (int i = 0; i < 8; i++) {
+		buffer.push_back((uint8_t)(p_value >> (8 * i)));
+	}
+}
+
+void gdsqlite_binary_writer::put_double(double p_value) {
+	uint64_t bits;
+	memcpy(&bits, &p_value, sizeof(bits));
+	put_u64(bits);
+}
+
+void gdsqlite_binary_writer::put_bytes(const void *p_data, size_t p_size) {
+	const uint8_t *bytes = reinterpret_cast<const uint8_t *>(p_data);
+	buffer.insert(buffer.end(), bytes, bytes + p_size);
+}
+
+void gdsqlite_binary_writer::put_string(const char *p_data, size_t p_size) {
+	put_u32((uint32_t)p_size);
+	put_bytes(p_data, p_size);
+}
+
+void gdsqlite_binary_writer::put_string(const String &p_string) {
+	const CharString utf8_string = p_string.utf8();
+	put_string(utf8_string.get_data(), utf8_string.length());
+}
+
+void gdsqlite_binary_writer::append(const gdsqlite_binary_writer &p_other) {
+	buffer.insert(buffer.end(), p_other.buffer.begin(), p_other.buffer.end());
+}
+
+void gdsqlite_binary_writer::clear() {
+	buffer.clear();
+}
+
+size_t gdsqlite_binary_writer::size() const {
+	return buffer.size();
+}
+
+const uint8_t *gdsqlite_binary_writer::data() const {
+	return buffer.data();
+}
+
+gdsqlite_binary_reader::gdsqlite_binary_reader(const uint8_t *p_data, size_t p_size) :
+		data(p_data), size(p_size) {
+}
+
+bool gdsqlite_binary_reader::require(size_t p_size) {
+	if (!valid || p_size > size - position) {
+		valid = false;
+		return false;
+	}
+	return true;
+}
+
+uint8_t gdsqlite_binary_reader::get_u8() {
+	if (!require(1)) {
+		return 0;
+	}
+	return data[position++];
+}
+
+uint32_t gdsqlite_binary_reader::get_u32() {
+	if (!require(4)) {
+		return 0;
+	}
+	uint32_t value = 0;
+	for (int i = 3; i >= 0; i--) {
+		value = (value << 8) | data[position + i];
+	}
+	position += 4;
+	return value;
+}
+
+uint64_t gdsqlite_binary_reader::get_u64() {
+	if (!require(8)) {
+		return 0;
+	}
+	uint64_t value = 0;
+	for (int i = 7; i >= 0; i--) {
+		value = (value << 8) | data[position + i];
+	}
+	position += 8;
+	return value;
+}
+
+double gdsqlite_binary_reader::get_double() {
+	uint64_t bits = get_u64();
+	double value;
+	memcpy(&value, &bits, sizeof(value));
+	return value;
+}
+
+const uint8_t *gdsqlite_binary_reader::get_bytes(size_t p_size) {
+	if (!require(p_size)) {
+		return nullptr;
+	}
+	const uint8_t *bytes = data + position;
+	position += p_size;
+	return bytes;
+}
+
+/*
+** Get a pointer to a string (or blob) inside of the buffer, without copying
+** it. Returns false for strings that are stored as missing.
+*/
+bool gdsqlite_binary_reader::get_string(const char **r_data, uint32_t *r_size) {
+	*r_size = get_u32();
+	*r_data = nullptr;
+	if (*r_size == BINARY_NULL_LENGTH) {
+		*r_size = 0;
+		return false;
+	}
+	*r_data = reinterpret_cast<const char *>(get_bytes(*r_size));
+	return valid;
+}
+
+String gdsqlite_binary_reader::get_string() {
+	const char *string;
+	uint32_t length;
+	if (!get_string(&string, &length)) {
+		return String();
+	}
+	return String::utf8(string, length);
+}
+
+/*
+** Split off the next p_size bytes into a reader of their own.
+*/
+gdsqlite_binary_reader gdsqlite_binary_reader::sub_reader(size_t p_size) {
+	const uint8_t *bytes = get_bytes(p_size);
+	gdsqlite_binary_reader reader(bytes, bytes ? p_size : 0);
+	reader.valid = valid;
+	return reader;
+}
+
+bool gdsqlite_binary_reader::is_valid() const {
+	return valid;
+}
+
+bool gdsqlite_binary_reader::is_at_end() const {
+	return position == size;
+}
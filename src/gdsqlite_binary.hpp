@@ -0,0 +1,106 @@
+#ifndef GDSQLITE_BINARY_H
+#define GDSQLITE_BINARY_H
+
+#include <godot_cpp/variant/packed_byte_array.hpp>
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+/*
+** Layout of a binary dump (all integers are little-endian):
+**
+**   header:   magic (8 bytes), compression_mode (u8), payload_size (u64)
+**   payload:  object_count (u32) x object, compressed as a whole unless the
+**             compression_mode equals BINARY_UNCOMPRESSED
+**
+**   object:   type (u8, see OBJECT_TYPE), name (string), sql (string)
+**             tables are followed by column_count (u32) x column name
+**             (string) and by their row groups, terminated by an empty one
+**   group:    row_count (u32), followed by column_count x column block
+**   column:   row_count x storage class (u8), values_size (u64), values
+**
+** Storage classes use SQLite's own codes, from SQLITE_INTEGER up to and
+** including SQLITE_NULL. Strings and blobs are stored as a u32 length
+** followed by the raw bytes, integers as i64 and reals as f64. NULLs have no
+** value at all. Missing sql templates have a length of BINARY_NULL_LENGTH.
+*/
+#define BINARY_MAGIC "GDSQLB01"
+#define BINARY_MAGIC_SIZE 8
+#define BINARY_HEADER_SIZE (BINARY_MAGIC_SIZE + 1 + 8)
+#define BINARY_UNCOMPRESSED 0xFF
+#define BINARY_NULL_LENGTH 0xFFFFFFFF
+
+/*
+** Upper bound on the payload_size of a binary dump. The header can't be
+** trusted, so anything larger than a PackedByteArray can hold is rejected
+** before any memory is allocated for the decompressed payload.
+*/
+#define BINARY_MAX_PAYLOAD_SIZE 0x7FFFFFFF
+
+/*
+** Upper bound on the number of columns of a table, as defined by SQLite.
+*/
+#define BINARY_MAX_COLUMNS 32767
+
+/*
+** The number of rows that are stored together in a single row group.
+*/
+#define BINARY_ROW_GROUP_SIZE 1024
+
+namespace godot {
+/*
+** Appends little-endian values to a growing buffer.
+*/
+class gdsqlite_binary_writer {
+	std::vector<uint8_t> buffer;
+
+public:
+	void put_u8(uint8_t p_value);
+	void put_u32(uint32_t p_value);
+	void put_u64(uint64_t p_value);
+	void put_double(double p_value);
+	void put_bytes(const void *p_data, size_t p_size);
+	void put_string(const char *p_data, size_t p_size);
+	void put_string(const String &p_string);
+
+	void append(const gdsqlite_binary_writer &p_other);
+	void clear();
+	size_t size() const;
+	const uint8_t *data() const;
+};
+
+/*
+** Reads little-endian values from a buffer. Reading beyond the end of the
+** buffer makes all subsequent reads fail, which has to be checked with
+** is_valid() before any of the read values are used.
+*/
+class gdsqlite_binary_reader {
+	const uint8_t *data = nullptr;
+	size_t size = 0;
+	size_t position = 0;
+	bool valid = true;
+
+	bool require(size_t p_size);
+
+public:
+	gdsqlite_binary_reader() {}
+	gdsqlite_binary_reader(const uint8_t *p_data, size_t p_size);
+
+	uint8_t get_u8();
+	uint32_t get_u32();
+	uint64_t get_u64();
+	double get_double();
+	const uint8_t *get_bytes(size_t p_size);
+	bool get_string(const char **r_data, uint32_t *r_size);
+	String get_string();
+
+	gdsqlite_binary_reader sub_reader(size_t p_size);
+	bool is_valid() const;
+	bool is_at_end() const;
+};
+
+} //namespace godot
+
+#endif
@@ -0,0 +1,225 @@
+#include "gdsqlite_csv.hpp"
+
+#include <sqlite/sqlite3.h>
+
+#include <cerrno>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+using namespace godot;
+
+/*
+** Fields are only converted to numbers when they consist of nothing but the
+** number itself, so that e.g. " 12" or "nan" are kept as text.
+*/
+static bool looks_like_number(const std::string &p_text) {
+	if (p_text.empty()) {
+		return false;
+	}
+	char c = p_text[0];
+	return (c >= '0' && c <= '9') || c == '-' || c == '+' || c == '.';
+}
+
+bool gdsqlite_csv_field::to_integer(int64_t &r_value) const {
+	if (!looks_like_number(text)) {
+		return false;
+	}
+	char *end;
+	errno = 0;
+	r_value = strtoll(text.c_str(), &end, 10);
+	return errno == 0 && *end == '\0';
+}
+
+bool gdsqlite_csv_field::to_real(double &r_value) const {
+	if (!looks_like_number(text)) {
+		return false;
+	}
+	/* Unlike strtod(), Godot's parser doesn't depend on the C locale */
+	String real_string = String::utf8(text.c_str(), text.length());
+	if (!real_string.is_valid_float()) {
+		return false;
+	}
+	r_value = real_string.to_float();
+	return std::isfinite(r_value);
+}
+
+gdsqlite_csv_reader::gdsqlite_csv_reader(const Ref<FileAccess> &p_file, char p_delimiter, char p_quote) :
+		file(p_file), delimiter(p_delimiter), quote(p_quote) {
+	buffer.resize(CSV_BUFFER_SIZE);
+}
+
+int gdsqlite_csv_reader::peek() {
+	if (position == buffer_size) {
+		buffer_size = file->get_buffer(buffer.data(), buffer.size());
+		position = 0;
+		if (buffer_size == 0) {
+			return -1;
+		}
+	}
+	return buffer[position];
+}
+
+int gdsqlite_csv_reader::get() {
+	int c = peek();
+	if (c != -1) {
+		position++;
+		if (c == '\n') {
+			line++;
+		}
+	}
+	return c;
+}
+
+/*
+** Read the next row into r_fields, of which the first r_field_count entries
+** are valid afterwards. The entries are reused between rows to avoid
+** reallocating their strings. Returns false once the end of the file has been
+** reached or when the file is malformed, which can be checked with
+** is_malformed().
+*/
+bool gdsqlite_csv_reader::next_row(std::vector<gdsqlite_csv_field> &r_fields, size_t &r_field_count) {
+	r_field_count = 0;
+	if (malformed || peek() == -1) {
+		return false;
+	}
+
+	while (true) {
+		if (r_field_count == r_fields.size()) {
+			r_fields.emplace_back();
+		}
+		gdsqlite_csv_field &field = r_fields[r_field_count++];
+		field.text.clear();
+		field.quoted = peek() == quote;
+
+		int c;
+		if (field.quoted) {
+			get();
+			while (true) {
+				c = get();
+				if (c == -1) {
+					malformed = true;
+					return false;
+				}
+				if (c == quote) {
+					if (peek() != quote) {
+						break;
+					}
+					get();
+				}
+				field.text += (char)c;
+			}
+			c = get();
+		} else {
+			/* Copy everything up to the next delimiter or line break in one go */
+			while (true) {
+				size_t start = position;
+				while (position < buffer_size && buffer[position] != delimiter && buffer[position] != '\n' && buffer[position] != '\r') {
+					position++;
+				}
+				field.text.append(reinterpret_cast<const char *>(buffer.data() + start), position - start);
+				if (position < buffer_size || peek() == -1) {
+					break;
+				}
+			}
+			c = get();
+		}
+
+		if (c == delimiter) {
+			continue;
+		}
+		if (c == '\r' && peek() == '\n') {
+			c = get();
+		}
+		if (c == '\n' || c == '\r' || c == -1) {
+			return true;
+		}
+
+		/* Only a delimiter or a line break may follow the closing quote */
+		malformed = true;
+		return false;
+	}
+}
+
+bool gdsqlite_csv_reader::is_malformed() const {
+	return malformed;
+}
+
+int64_t gdsqlite_csv_reader::get_line() const {
+	return line;
+}
+
+gdsqlite_csv_writer::gdsqlite_csv_writer(const Ref<FileAccess> &p_file, char p_delimiter, char p_quote) :
+		file(p_file), delimiter(p_delimiter), quote(p_quote) {
+	buffer.reserve(CSV_BUFFER_SIZE);
+}
+
+void gdsqlite_csv_writer::field(const char *p_data, size_t p_length, bool p_force_quotes) {
+	if (!first_field) {
+		buffer += delimiter;
+	}
+	first_field = false;
+
+	bool needs_quotes = p_force_quotes;
+	for (size_t i = 0; i < p_length && !needs_quotes; i++) {
+		char c = p_data[i];
+		needs_quotes = c == delimiter || c == quote || c == '\n' || c == '\r';
+	}
+	if (!needs_quotes) {
+		buffer.append(p_data, p_length);
+		return;
+	}
+
+	buffer += quote;
+	for (size_t i = 0; i < p_length; i++) {
+		if (p_data[i] == quote) {
+			buffer += quote;
+		}
+		buffer += p_data[i];
+	}
+	buffer += quote;
+}
+
+void gdsqlite_csv_writer::integer_field(int64_t p_value) {
+	char number[32];
+	int length = snprintf(number, sizeof(number), "%lld", (long long)p_value);
+	field(number, length);
+}
+
+/*
+** Reals always contain a decimal point, so they aren't mistaken for integers
+** when the file is imported again. SQLite's formatter ignores the C locale,
+** so the decimal point is never replaced by a comma.
+*/
+void gdsqlite_csv_writer::real_field(double p_value) {
+	char number[40];
+	sqlite3_snprintf(sizeof(number), number, "%!.17g", p_value);
+	field(number, strlen(number));
+}
+
+void gdsqlite_csv_writer::empty_field() {
+	field("", 0);
+}
+
+void gdsqlite_csv_writer::end_row() {
+	buffer += '\n';
+	first_field = true;
+	if (buffer.size() >= CSV_BUFFER_SIZE) {
+		file->store_buffer(reinterpret_cast<const uint8_t *>(buffer.data()), buffer.size());
+		buffer.clear();
+	}
+}
+
+/*
+** Write whatever remains in the buffer to the file. Returns false if any of
+** the writes to the file failed.
+*/
+bool gdsqlite_csv_writer::finish() {
+	if (!buffer.empty()) {
+		file->store_buffer(reinterpret_cast<const uint8_t *>(buffer.data()), buffer.size());
+		buffer.clear();
+	}
+	file->flush();
+	return file->get_error() == OK;
+}
@@ -0,0 +1,74 @@
+#ifndef GDSQLITE_CSV_H
+#define GDSQLITE_CSV_H
+
+#include <godot_cpp/classes/file_access.hpp>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/*
+** Both the reader and the writer go through the file in chunks of this size.
+*/
+#define CSV_BUFFER_SIZE (256 * 1024)
+
+namespace godot {
+struct gdsqlite_csv_field {
+	std::string text;
+	bool quoted = false;
+
+	bool to_integer(int64_t &r_value) const;
+	bool to_real(double &r_value) const;
+};
+
+/*
+** Splits a CSV file into rows of fields, following RFC 4180: fields that
+** contain delimiters, quotes or line breaks are enclosed in quotes, and quotes
+** inside of such fields are escaped by doubling them. Both "\n" and "\r\n"
+** are accepted as line breaks.
+*/
+class gdsqlite_csv_reader {
+	Ref<FileAccess> file;
+	std::vector<uint8_t> buffer;
+	size_t buffer_size = 0;
+	size_t position = 0;
+	char delimiter;
+	char quote;
+	int64_t line = 1;
+	bool malformed = false;
+
+	int peek();
+	int get();
+
+public:
+	gdsqlite_csv_reader(const Ref<FileAccess> &p_file, char p_delimiter, char p_quote);
+
+	bool next_row(std::vector<gdsqlite_csv_field> &r_fields, size_t &r_field_count);
+	bool is_malformed() const;
+	int64_t get_line() const;
+};
+
+/*
+** Writes rows of fields to a CSV file, quoting fields only when required.
+*/
+class gdsqlite_csv_writer {
+	Ref<FileAccess> file;
+	std::string buffer;
+	char delimiter;
+	char quote;
+	bool first_field = true;
+
+public:
+	gdsqlite_csv_writer(const Ref<FileAccess> &p_file, char p_delimiter, char p_quote);
+
+	void field(const char *p_data, size_t p_length, bool p_force_quotes = false);
+	void integer_field(int64_t p_value);
+	void real_field(double p_value);
+	void empty_field();
+	void end_row();
+	bool finish();
+};
+
+} //namespace godot
+
+#endif
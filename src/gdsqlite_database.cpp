@@ -0,0 +1,404 @@
+#include "gdsqlite_database.hpp"
+#include "gdsqlite.hpp"
+#include "gdsqlite_snapshot.hpp"
+
+#include <algorithm>
+#include <iterator>
+
+using namespace godot;
+
+void SQLiteDatabase::_bind_methods() {
+	// Methods.
+	ClassDB::bind_method(D_METHOD("open", "path"), &SQLiteDatabase::open);
+	ClassDB::bind_method(D_METHOD("close"), &SQLiteDatabase::close);
+	ClassDB::bind_method(D_METHOD("is_open"), &SQLiteDatabase::is_open);
+
+	ClassDB::bind_method(D_METHOD("queue_write", "query_string", "param_bindings", "callback"), &SQLiteDatabase::queue_write, DEFVAL(Array()), DEFVAL(Callable()));
+	ClassDB::bind_method(D_METHOD("wait_for_writes"), &SQLiteDatabase::wait_for_writes);
+	ClassDB::bind_method(D_METHOD("read", "query_string", "param_bindings", "snapshot"), &SQLiteDatabase::read, DEFVAL(Array()), DEFVAL(Variant()));
+	ClassDB::bind_method(D_METHOD("snapshot_open"), &SQLiteDatabase::snapshot_open);
+
+	// Properties.
+	ClassDB::bind_method(D_METHOD("set_reader_count", "reader_count"), &SQLiteDatabase::set_reader_count);
+	ClassDB::bind_method(D_METHOD("get_reader_count"), &SQLiteDatabase::get_reader_count);
+	ADD_PROPERTY(PropertyInfo(Variant::INT, "reader_count"), "set_reader_count", "get_reader_count");
+
+	ClassDB::bind_method(D_METHOD("set_max_batch_size", "max_batch_size"), &SQLiteDatabase::set_max_batch_size);
+	ClassDB::bind_method(D_METHOD("get_max_batch_size"), &SQLiteDatabase::get_max_batch_size);
+	ADD_PROPERTY(PropertyInfo(Variant::INT, "max_batch_size"), "set_max_batch_size", "get_max_batch_size");
+
+	ClassDB::bind_method(D_METHOD("set_verbosity_level", "verbosity_level"), &SQLiteDatabase::set_verbosity_level);
+	ClassDB::bind_method(D_METHOD("get_verbosity_level"), &SQLiteDatabase::get_verbosity_level);
+	ADD_PROPERTY(PropertyInfo(Variant::INT, "verbosity_level"), "set_verbosity_level", "get_verbosity_level");
+
+	// Signals.
+	ADD_SIGNAL(MethodInfo("write_failed", PropertyInfo(Variant::STRING, "query_string"), PropertyInfo(Variant::STRING, "error_message")));
+	ADD_SIGNAL(MethodInfo("read_failed", PropertyInfo(Variant::STRING, "query_string"), PropertyInfo(Variant::STRING, "error_message")));
+}
+
+SQLiteDatabase::SQLiteDatabase() {
+}
+
+SQLiteDatabase::~SQLiteDatabase() {
+	close();
+}
+
+/*
+** Open the write connection, which switches the database to WAL mode, and
+** afterwards the pool of read connections. Readers in WAL mode never block
+** the writer and vice versa, so neither of them has to wait for the other.
+*/
+bool SQLiteDatabase::open(const String &p_path) {
+	if (writer.is_valid()) {
+		ERR_PRINT("GDSQLite Error: Can't open database if connection is already open!");
+		return false;
+	}
+	if (p_path.contains(":memory:")) {
+		/* Every connection to an in-memory database would see a database of its own */
+		ERR_PRINT("GDSQLite Error: In-memory databases are not supported by SQLiteDatabase!");
+		return false;
+	}
+
+	Ref<SQLite> write_connection;
+	write_connection.instantiate();
+	write_connection->set_path(p_path);
+	write_connection->set_verbosity_level(verbosity_level);
+	Dictionary write_pragmas;
+	write_pragmas["journal_mode"] = "WAL";
+	write_pragmas["synchronous"] = "NORMAL";
+	write_pragmas["busy_timeout"] = 5000;
+	write_connection->set_pragmas(write_pragmas);
+	if (!write_connection->open_db()) {
+		return false;
+	}
+
+	/* The path has been normalized by now, so the readers open the exact same file */
+	for (int64_t i = 0; i < reader_count; i++) {
+		Ref<SQLite> read_connection = open_read_connection(write_connection->get_path());
+		if (read_connection.is_null()) {
+			for (const Ref<SQLite> &reader : readers) {
+				reader->close_db();
+			}
+			readers.clear();
+			free_readers.clear();
+			write_connection->close_db();
+			return false;
+		}
+		readers.push_back(read_connection);
+		free_readers.push_back((size_t)i);
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(reader_mutex);
+		closed = false;
+	}
+	writer = write_connection;
+	{
+		std::lock_guard<std::mutex> lock(write_mutex);
+		stopping = false;
+	}
+	writer_thread = std::thread(&SQLiteDatabase::run_writer, this);
+	return true;
+}
+
+/*
+** Open a connection that can only read, such as the readers of the pool.
+*/
+Ref<SQLite> SQLiteDatabase::open_read_connection(const String &p_path) const {
+	Dictionary read_pragmas;
+	read_pragmas["query_only"] = true;
+	read_pragmas["busy_timeout"] = 5000;
+
+	Ref<SQLite> read_connection;
+	read_connection.instantiate();
+	read_connection->set_path(p_path);
+	read_connection->set_verbosity_level(verbosity_level);
+	read_connection->set_pragmas(read_pragmas);
+	if (!read_connection->open_db()) {
+		return Ref<SQLite>();
+	}
+	return read_connection;
+}
+
+/*
+** Execute all writes that are still queued, stop the writer thread and close
+** all connections. Reads that are still running on other threads are waited
+** for.
+*/
+void SQLiteDatabase::close() {
+	if (writer.is_null()) {
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(write_mutex);
+		stopping = true;
+	}
+	write_condition.notify_one();
+	writer_thread.join();
+	writer->close_db();
+	writer.unref();
+
+	{
+		std::unique_lock<std::mutex> lock(reader_mutex);
+		/* Reads that haven't acquired a reader yet fail instead of waiting for one forever */
+		closed = true;
+		reader_condition.notify_all();
+		reader_condition.wait(lock, [this] { return free_readers.size() == readers.size(); });
+		for (const Ref<SQLite> &reader : readers) {
+			reader->close_db();
+		}
+		readers.clear();
+		free_readers.clear();
+	}
+}
+
+bool SQLiteDatabase::is_open() const {
+	return writer.is_valid();
+}
+
+/*
+** Queue a write for the writer thread. The callback is called on the main
+** thread, with whether the write succeeded and the error message if it
+** didn't, once the transaction that contains the write has been committed.
+** Writes are rejected as soon as the database starts closing, as the writer
+** thread might have drained the queue for the last time already.
+*/
+bool SQLiteDatabase::queue_write(const String &p_query_string, const Array &p_param_bindings, const Callable &p_callback) {
+	{
+		std::lock_guard<std::mutex> lock(write_mutex);
+		if (stopping) {
+			ERR_PRINT("GDSQLite Error: Can't queue a write if the database isn't open!");
+			return false;
+		}
+		write_queue.push_back({ p_query_string, p_param_bindings.duplicate(), p_callback });
+	}
+	write_condition.notify_one();
+	return true;
+}
+
+/*
+** Block until all writes that have been queued so far are committed. Their
+** callbacks and signals are still deferred to the main thread.
+*/
+void SQLiteDatabase::wait_for_writes() {
+	std::unique_lock<std::mutex> lock(write_mutex);
+	idle_condition.wait(lock, [this] { return write_queue.empty() && !writer_busy; });
+}
+
+/*
+** Take one of the readers out of the pool, waiting for one to come free
+** when all readers are in use by other threads. Fails if the database isn't
+** open, or is closed while waiting.
+*/
+bool SQLiteDatabase::acquire_reader(size_t &r_index) {
+	std::unique_lock<std::mutex> lock(reader_mutex);
+	reader_condition.wait(lock, [this] { return closed || !free_readers.empty(); });
+	if (closed) {
+		return false;
+	}
+	r_index = free_readers.back();
+	free_readers.pop_back();
+	return true;
+}
+
+void SQLiteDatabase::release_reader(size_t p_index) {
+	{
+		std::lock_guard<std::mutex> lock(reader_mutex);
+		free_readers.push_back(p_index);
+	}
+	/* Notify all waiters since close() might be waiting for the last reader as well */
+	reader_condition.notify_all();
+}
+
+/*
+** Execute a query on one of the read connections and return its rows. Only
+** committed writes are visible to the readers. When a snapshot is given, the
+** query sees the database exactly as it was when the snapshot was taken, no
+** matter which reader executes it. Failing reads emit read_failed, which
+** tells them apart from queries that simply didn't return any rows.
+*/
+TypedArray<Dictionary> SQLiteDatabase::read(const String &p_query_string, const Array &p_param_bindings, const Ref<SQLiteSnapshot> &p_snapshot) {
+	TypedArray<Dictionary> result;
+	size_t index;
+	if (!acquire_reader(index)) {
+		ERR_PRINT("GDSQLite Error: Can't read if the database isn't open!");
+		call_deferred("emit_signal", "read_failed", p_query_string, "The database isn't open");
+		return result;
+	}
+
+	const Ref<SQLite> &reader = readers[index];
+	bool success = false;
+	if (p_snapshot.is_null() || reader->begin_read_snapshot(p_snapshot)) {
+		success = reader->query_with_bindings(p_query_string, p_param_bindings);
+		if (success) {
+			/* Detach the rows from the reader, such that the next read can't modify them */
+			result = reader->get_query_result_by_reference();
+			reader->set_query_result(TypedArray<Dictionary>());
+		}
+		if (p_snapshot.is_valid()) {
+			reader->commit();
+		}
+	}
+	String error_message = success ? String() : reader->get_error_message();
+	release_reader(index);
+
+	if (!success) {
+		call_deferred("emit_signal", "read_failed", p_query_string, error_message);
+	}
+	return result;
+}
+
+/*
+** Take a snapshot of the committed state of the database, which can then be
+** passed to read() by multiple threads to read the same state in parallel.
+** Checkpoints can't restart the WAL while any connection is reading, so the
+** snapshot is taken by a connection of its own that keeps its read
+** transaction open until the snapshot is freed. Otherwise, the snapshot
+** would expire as soon as the writer checkpoints the WAL.
+*/
+Ref<SQLiteSnapshot> SQLiteDatabase::snapshot_open() {
+	size_t index;
+	if (!acquire_reader(index)) {
+		ERR_PRINT("GDSQLite Error: Can't take snapshot if the database isn't open!");
+		return Ref<SQLiteSnapshot>();
+	}
+	String path = readers[index]->get_path();
+	release_reader(index);
+
+	Ref<SQLite> pin_connection = open_read_connection(path);
+	if (pin_connection.is_null()) {
+		return Ref<SQLiteSnapshot>();
+	}
+	Ref<SQLiteSnapshot> snapshot;
+	/* The transaction only starts reading once the database is accessed */
+	if (pin_connection->begin(SQLite::TRANSACTION_DEFERRED) && pin_connection->query("PRAGMA schema_version;")) {
+		snapshot = pin_connection->snapshot_open("main");
+	}
+	if (snapshot.is_null()) {
+		pin_connection->close_db();
+		return snapshot;
+	}
+	snapshot->pin_connection = pin_connection;
+	return snapshot;
+}
+
+/*
+** Keep draining the queue until the database is closed. All writes that were
+** queued while the previous batch was executing end up in the same batch,
+** so a burst of writes only costs a single commit.
+*/
+void SQLiteDatabase::run_writer() {
+	std::vector<write_job_struct> jobs;
+	while (true) {
+		{
+			std::unique_lock<std::mutex> lock(write_mutex);
+			write_condition.wait(lock, [this] { return stopping || !write_queue.empty(); });
+			if (write_queue.empty()) {
+				return;
+			}
+			size_t count = std::min(write_queue.size(), (size_t)max_batch_size);
+			jobs.assign(std::make_move_iterator(write_queue.begin()), std::make_move_iterator(write_queue.begin() + count));
+			write_queue.erase(write_queue.begin(), write_queue.begin() + count);
+			writer_busy = true;
+		}
+
+		execute_jobs(jobs);
+		jobs.clear();
+
+		{
+			std::lock_guard<std::mutex> lock(write_mutex);
+			writer_busy = false;
+		}
+		idle_condition.notify_all();
+	}
+}
+
+/*
+** Execute a batch of writes in a single transaction. Every write gets a
+** savepoint of its own, so a failing write is rolled back without affecting
+** the other writes of the batch. Some errors, such as SQLITE_FULL or a
+** RAISE(ROLLBACK), roll back the whole transaction instead, in which case
+** the earlier writes of the batch fail as well and the remaining writes
+** continue in a new transaction.
+*/
+void SQLiteDatabase::execute_jobs(std::vector<write_job_struct> &p_jobs) {
+	std::vector<String> errors(p_jobs.size());
+	std::vector<bool> succeeded(p_jobs.size(), false);
+
+	bool in_transaction = writer->begin(SQLite::TRANSACTION_IMMEDIATE);
+	for (size_t i = 0; i < p_jobs.size(); i++) {
+		if (in_transaction) {
+			writer->savepoint("gdsqlite_job");
+		}
+		succeeded[i] = writer->query_with_bindings(p_jobs[i].query_string, p_jobs[i].param_bindings);
+		if (!succeeded[i]) {
+			errors[i] = writer->get_error_message();
+		}
+		if (in_transaction && !succeeded[i] && writer->get_autocommit()) {
+			for (size_t j = 0; j < i; j++) {
+				if (succeeded[j]) {
+					succeeded[j] = false;
+					errors[j] = errors[i];
+				}
+			}
+			in_transaction = writer->begin(SQLite::TRANSACTION_IMMEDIATE);
+			continue;
+		}
+		if (in_transaction) {
+			if (!succeeded[i]) {
+				writer->rollback_to("gdsqlite_job");
+			}
+			writer->release("gdsqlite_job");
+		}
+	}
+
+	if (in_transaction && !writer->commit()) {
+		String error_message = writer->get_error_message();
+		writer->rollback();
+		for (size_t i = 0; i < p_jobs.size(); i++) {
+			if (succeeded[i]) {
+				succeeded[i] = false;
+				errors[i] = error_message;
+			}
+		}
+	}
+
+	for (size_t i = 0; i < p_jobs.size(); i++) {
+		if (!succeeded[i]) {
+			call_deferred("emit_signal", "write_failed", p_jobs[i].query_string, errors[i]);
+		}
+		if (p_jobs[i].callback.is_valid()) {
+			p_jobs[i].callback.call_deferred(succeeded[i], errors[i]);
+		}
+	}
+}
+
+void SQLiteDatabase::set_reader_count(const int64_t &p_reader_count) {
+	if (writer.is_valid()) {
+		ERR_PRINT("GDSQLite Error: Can't change the reader count while the database is open!");
+		return;
+	}
+	reader_count = CLAMP(p_reader_count, (int64_t)1, (int64_t)64);
+}
+
+int64_t SQLiteDatabase::get_reader_count() const {
+	return reader_count;
+}
+
+void SQLiteDatabase::set_max_batch_size(const int64_t &p_max_batch_size) {
+	std::lock_guard<std::mutex> lock(write_mutex);
+	max_batch_size = MAX(p_max_batch_size, (int64_t)1);
+}
+
+int64_t SQLiteDatabase::get_max_batch_size() const {
+	return max_batch_size;
+}
+
+void SQLiteDatabase::set_verbosity_level(const int64_t &p_verbosity_level) {
+	verbosity_level = p_verbosity_level;
+}
+
+int64_t SQLiteDatabase::get_verbosity_level() const {
+	return verbosity_level;
+}
@@ -0,0 +1,97 @@
+#ifndef SQLITE_DATABASE_CLASS_H
+#define SQLITE_DATABASE_CLASS_H
+
+#include <godot_cpp/classes/ref_counted.hpp>
+#include <godot_cpp/core/binder_common.hpp>
+#include <godot_cpp/core/class_db.hpp>
+#include <godot_cpp/variant/typed_array.hpp>
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace godot {
+class SQLite;
+class SQLiteSnapshot;
+
+struct write_job_struct {
+	String query_string;
+	Array param_bindings;
+	Callable callback;
+};
+
+/*
+** Manages a database in WAL mode with a single writer and multiple readers.
+** All writes are queued and executed by a dedicated thread that owns the
+** only write connection, which groups the queued writes in transactions.
+** Reads are executed immediately on the calling thread, using one of the
+** read-only connections of the pool, and never block on the writer.
+*/
+class SQLiteDatabase : public RefCounted {
+	GDCLASS(SQLiteDatabase, RefCounted)
+
+private:
+	Ref<SQLite> writer;
+	std::vector<Ref<SQLite>> readers;
+
+	/* Writes that haven't been picked up by the writer thread yet */
+	std::deque<write_job_struct> write_queue;
+	std::mutex write_mutex;
+	std::condition_variable write_condition;
+	std::condition_variable idle_condition;
+	bool writer_busy = false;
+	/* Set while the writer thread doesn't accept any jobs, only accessed while holding write_mutex */
+	bool stopping = true;
+	std::thread writer_thread;
+
+	/* Indices of the readers that aren't in use by any thread */
+	std::vector<size_t> free_readers;
+	std::mutex reader_mutex;
+	std::condition_variable reader_condition;
+	/* Set while the readers are unusable, only accessed while holding reader_mutex */
+	bool closed = true;
+
+	int64_t reader_count = 2;
+	int64_t max_batch_size = 1000;
+	int64_t verbosity_level = 1;
+
+	Ref<SQLite> open_read_connection(const String &p_path) const;
+	bool acquire_reader(size_t &r_index);
+	void release_reader(size_t p_index);
+
+	void run_writer();
+	void execute_jobs(std::vector<write_job_struct> &p_jobs);
+
+protected:
+	static void _bind_methods();
+
+public:
+	SQLiteDatabase();
+	~SQLiteDatabase();
+
+	// Functions.
+	bool open(const String &p_path);
+	void close();
+	bool is_open() const;
+
+	bool queue_write(const String &p_query_string, const Array &p_param_bindings, const Callable &p_callback);
+	void wait_for_writes();
+	TypedArray<Dictionary> read(const String &p_query_string, const Array &p_param_bindings, const Ref<SQLiteSnapshot> &p_snapshot);
+	Ref<SQLiteSnapshot> snapshot_open();
+
+	// Properties.
+	void set_reader_count(const int64_t &p_reader_count);
+	int64_t get_reader_count() const;
+
+	void set_max_batch_size(const int64_t &p_max_batch_size);
+	int64_t get_max_batch_size() const;
+
+	void set_verbosity_level(const int64_t &p_verbosity_level);
+	int64_t get_verbosity_level() const;
+};
+
+} //namespace godot
+
+#endif // ! SQLITE_DATABASE_CLASS_H
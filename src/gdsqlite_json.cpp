@@ -0,0 +1,528 @@
+#include "gdsqlite_json.hpp"
+#include "gdsqlite_base64.hpp"
+
+#include <sqlite/sqlite3.h>
+
+#include <cerrno>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+using namespace godot;
+
+gdsqlite_json_writer::gdsqlite_json_writer(const Ref<FileAccess> &p_file, bool p_compact, int p_base_depth) :
+		file(p_file), compact(p_compact), base_depth(p_base_depth) {
+	buffer.reserve(JSON_WRITE_BUFFER_SIZE);
+}
+
+/*
+** Write the separator and indentation that precede a value, unless the value
+** directly follows its key.
+*/
+void gdsqlite_json_writer::begin_value() {
+	if (after_key) {
+		after_key = false;
+		return;
+	}
+	if (!scopes.empty()) {
+		if (!scopes.back()) {
+			buffer += ',';
+		}
+		scopes.back() = false;
+		newline();
+	}
+}
+
+void gdsqlite_json_writer::newline() {
+	if (compact) {
+		return;
+	}
+	buffer += '\n';
+	buffer.append(base_depth + scopes.size(), '\t');
+}
+
+/*
+** Write a quoted string, escaping all characters that aren't allowed in JSON.
+** Multi-byte UTF-8 sequences are copied as-is.
+*/
+void gdsqlite_json_writer::write_string(const char *p_string, size_t p_length) {
+	static const char hex_digits[] = "0123456789abcdef";
+
+	buffer += '"';
+	for (size_t i = 0; i < p_length; i++) {
+		unsigned char c = (unsigned char)p_string[i];
+		switch (c) {
+			case '"':
+				buffer += "\\\"";
+				break;
+			case '\\':
+				buffer += "\\\\";
+				break;
+			case '\b':
+				buffer += "\\b";
+				break;
+			case '\f':
+				buffer += "\\f";
+				break;
+			case '\n':
+				buffer += "\\n";
+				break;
+			case '\r':
+				buffer += "\\r";
+				break;
+			case '\t':
+				buffer += "\\t";
+				break;
+			default:
+				if (c < 0x20) {
+					buffer += "\\u00";
+					buffer += hex_digits[c >> 4];
+					buffer += hex_digits[c & 0xF];
+				} else {
+					buffer += (char)c;
+				}
+				break;
+		}
+	}
+	buffer += '"';
+}
+
+void gdsqlite_json_writer::flush_if_needed() {
+	if (file.is_valid() && buffer.size() >= JSON_WRITE_BUFFER_SIZE) {
+		file->store_buffer(reinterpret_cast<const uint8_t *>(buffer.data()), buffer.size());
+		buffer.clear();
+	}
+}
+
+void gdsqlite_json_writer::begin_object() {
+	begin_value();
+	buffer += '{';
+	scopes.push_back(true);
+}
+
+void gdsqlite_json_writer::end_object() {
+	bool empty = scopes.back();
+	scopes.pop_back();
+	if (!empty) {
+		newline();
+	}
+	buffer += '}';
+	flush_if_needed();
+}
+
+void gdsqlite_json_writer::begin_array() {
+	begin_value();
+	buffer += '[';
+	scopes.push_back(true);
+}
+
+void gdsqlite_json_writer::end_array() {
+	bool empty = scopes.back();
+	scopes.pop_back();
+	if (!empty) {
+		newline();
+	}
+	buffer += ']';
+	flush_if_needed();
+}
+
+void gdsqlite_json_writer::key(const char *p_key) {
+	begin_value();
+	write_string(p_key, strlen(p_key));
+	buffer += compact ? ":" : ": ";
+	after_key = true;
+}
+
+void gdsqlite_json_writer::string_value(const char *p_string, size_t p_length) {
+	begin_value();
+	write_string(p_string, p_length);
+}
+
+void gdsqlite_json_writer::string_value(const String &p_string) {
+	const CharString utf8_string = p_string.utf8();
+	string_value(utf8_string.get_data(), utf8_string.length());
+}
+
+void gdsqlite_json_writer::int_value(int64_t p_value) {
+	begin_value();
+	char number[32];
+	int length = snprintf(number, sizeof(number), "%lld", (long long)p_value);
+	buffer.append(number, length);
+}
+
+/*
+** Reals are written with enough digits to survive a round-trip and always
+** contain a decimal point, so that they can be told apart from integers.
+** SQLite's printf() is used since it doesn't depend on the C locale, which
+** might use a comma as decimal separator. The "!" flag allows for more than
+** 16 significant digits and forces the decimal point. JSON has no
+** representation for infinities or NaN, those become null.
+*/
+void gdsqlite_json_writer::real_value(double p_value) {
+	if (!std::isfinite(p_value)) {
+		null_value();
+		return;
+	}
+
+	begin_value();
+	char number[40];
+	sqlite3_snprintf(sizeof(number), number, "%!.17g", p_value);
+	buffer += number;
+}
+
+void gdsqlite_json_writer::null_value() {
+	begin_value();
+	buffer += "null";
+}
+
+/*
+** Write a blob as a base64-encoded string. The alphabet never needs escaping,
+** so the blob is encoded straight into the buffer.
+*/
+void gdsqlite_json_writer::base64_value(const uint8_t *p_data, size_t p_size) {
+	begin_value();
+	buffer += '"';
+	size_t start = buffer.size();
+	buffer.resize(start + gdsqlite_base64_encoded_size(p_size));
+	gdsqlite_base64_encode(p_data, p_size, &buffer[start]);
+	buffer += '"';
+	flush_if_needed();
+}
+
+/*
+** Insert a value that was written by another writer, with a base_depth equal
+** to the current depth of this writer.
+*/
+void gdsqlite_json_writer::raw_value(const std::string &p_json) {
+	begin_value();
+	buffer += p_json;
+	flush_if_needed();
+}
+
+/*
+** Write whatever remains in the buffer to the file. Returns false if any of
+** the writes to the file failed.
+*/
+bool gdsqlite_json_writer::finish() {
+	if (file.is_null()) {
+		return true;
+	}
+	if (!buffer.empty()) {
+		file->store_buffer(reinterpret_cast<const uint8_t *>(buffer.data()), buffer.size());
+		buffer.clear();
+	}
+	file->flush();
+	return file->get_error() == OK;
+}
+
+bool gdsqlite_json_writer::is_compact() const {
+	return compact;
+}
+
+const std::string &gdsqlite_json_writer::get_buffer() const {
+	return buffer;
+}
+
+void gdsqlite_json_writer::take_buffer(std::string &r_buffer) {
+	r_buffer.swap(buffer);
+	buffer.clear();
+}
+
+gdsqlite_json_reader::gdsqlite_json_reader(const Ref<FileAccess> &p_file) :
+		file(p_file) {
+	file_buffer.resize(JSON_READ_BUFFER_SIZE);
+}
+
+gdsqlite_json_reader::gdsqlite_json_reader(const uint8_t *p_data, size_t p_size) :
+		data(p_data), data_size(p_size) {
+}
+
+/*
+** Refill the buffer from the file once it has been consumed completely.
+** Returns false at the end of the document.
+*/
+bool gdsqlite_json_reader::fill() {
+	if (position < data_size) {
+		return true;
+	}
+	if (file.is_null()) {
+		return false;
+	}
+
+	data_size = file->get_buffer(file_buffer.data(), file_buffer.size());
+	data = file_buffer.data();
+	position = 0;
+	return data_size > 0;
+}
+
+int gdsqlite_json_reader::peek() {
+	return fill() ? data[position] : -1;
+}
+
+int gdsqlite_json_reader::get() {
+	if (!fill()) {
+		return -1;
+	}
+	int c = data[position++];
+	if (c == '\n') {
+		line++;
+	}
+	return c;
+}
+
+static void append_utf8(std::string &r_string, uint32_t p_codepoint) {
+	if (p_codepoint < 0x80) {
+		r_string += (char)p_codepoint;
+	} else if (p_codepoint < 0x800) {
+		r_string += (char)(0xC0 | (p_codepoint >> 6));
+		r_string += (char)(0x80 | (p_codepoint & 0x3F));
+	} else if (p_codepoint < 0x10000) {
+		r_string += (char)(0xE0 | (p_codepoint >> 12));
+		r_string += (char)(0x80 | ((p_codepoint >> 6) & 0x3F));
+		r_string += (char)(0x80 | (p_codepoint & 0x3F));
+	} else {
+		r_string += (char)(0xF0 | (p_codepoint >> 18));
+		r_string += (char)(0x80 | ((p_codepoint >> 12) & 0x3F));
+		r_string += (char)(0x80 | ((p_codepoint >> 6) & 0x3F));
+		r_string += (char)(0x80 | (p_codepoint & 0x3F));
+	}
+}
+
+/*
+** Read the remainder of a string, of which the opening quote has already been
+** consumed, and store it unescaped as UTF-8.
+*/
+bool gdsqlite_json_reader::read_string() {
+	string.clear();
+	while (true) {
+		/* Copy everything up to the next quote or escape in one go */
+		if (!fill()) {
+			return false;
+		}
+		size_t start = position;
+		while (position < data_size && data[position] != '"' && data[position] != '\\') {
+			if (data[position] == '\n') {
+				line++;
+			}
+			position++;
+		}
+		string.append(reinterpret_cast<const char *>(data + start), position - start);
+		if (position == data_size) {
+			continue;
+		}
+
+		int c = get();
+		if (c == '"') {
+			return true;
+		}
+
+		c = get();
+		switch (c) {
+			case '"':
+			case '\\':
+			case '/':
+				string += (char)c;
+				break;
+			case 'b':
+				string += '\b';
+				break;
+			case 'f':
+				string += '\f';
+				break;
+			case 'n':
+				string += '\n';
+				break;
+			case 'r':
+				string += '\r';
+				break;
+			case 't':
+				string += '\t';
+				break;
+			case 'u': {
+				uint32_t codepoint = 0;
+				for (int pair = 0; pair < 2; pair++) {
+					uint32_t unit = 0;
+					for (int i = 0; i < 4; i++) {
+						int digit = get();
+						if (digit >= '0' && digit <= '9') {
+							unit = (unit << 4) | (digit - '0');
+						} else if (digit >= 'a' && digit <= 'f') {
+							unit = (unit << 4) | (digit - 'a' + 10);
+						} else if (digit >= 'A' && digit <= 'F') {
+							unit = (unit << 4) | (digit - 'A' + 10);
+						} else {
+							return false;
+						}
+					}
+					if (pair == 0) {
+						codepoint = unit;
+						/* A high surrogate has to be followed by an escaped low surrogate */
+						if (unit < 0xD800 || unit > 0xDBFF) {
+							break;
+						}
+						if (get() != '\\' || get() != 'u') {
+							return false;
+						}
+					} else {
+						if (unit < 0xDC00 || unit > 0xDFFF) {
+							return false;
+						}
+						codepoint = 0x10000 + ((codepoint - 0xD800) << 10) + (unit - 0xDC00);
+					}
+				}
+				append_utf8(string, codepoint);
+				break;
+			}
+			default:
+				return false;
+		}
+	}
+}
+
+/*
+** Read a number of which the first character has already been consumed.
+** Numbers without a fraction or exponent that fit in 64 bits are integers,
+** all others are reals.
+*/
+JSON_TOKEN gdsqlite_json_reader::read_number(int p_first) {
+	char number[64];
+	size_t length = 0;
+	bool is_real = false;
+
+	number[length++] = (char)p_first;
+	while (true) {
+		int c = peek();
+		if (c == '.' || c == 'e' || c == 'E') {
+			is_real = true;
+		} else if (!(c >= '0' && c <= '9') && c != '-' && c != '+') {
+			break;
+		}
+		if (length >= sizeof(number) - 1) {
+			return JSON_ERROR;
+		}
+		number[length++] = (char)get();
+	}
+	number[length] = '\0';
+
+	char *end;
+	if (!is_real) {
+		errno = 0;
+		integer = strtoll(number, &end, 10);
+		if (errno == 0 && *end == '\0') {
+			return JSON_INTEGER;
+		}
+	}
+	/* Unlike strtod(), Godot's parser doesn't depend on the C locale */
+	String real_string = String(number);
+	if (!real_string.is_valid_float()) {
+		return JSON_ERROR;
+	}
+	real = real_string.to_float();
+	return JSON_REAL;
+}
+
+bool gdsqlite_json_reader::read_literal(const char *p_rest) {
+	for (const char *c = p_rest; *c; c++) {
+		if (get() != *c) {
+			return false;
+		}
+	}
+	return true;
+}
+
+JSON_TOKEN gdsqlite_json_reader::next() {
+	while (true) {
+		int c = get();
+		switch (c) {
+			case -1:
+				return JSON_END;
+			case ' ':
+			case '\t':
+			case '\n':
+			case '\r':
+			case ',':
+			case ':':
+				continue;
+			case '{':
+				return JSON_BEGIN_OBJECT;
+			case '}':
+				return JSON_END_OBJECT;
+			case '[':
+				return JSON_BEGIN_ARRAY;
+			case ']':
+				return JSON_END_ARRAY;
+			case '"':
+				return read_string() ? JSON_STRING : JSON_ERROR;
+			case 't':
+				return read_literal("rue") ? JSON_TRUE : JSON_ERROR;
+			case 'f':
+				return read_literal("alse") ? JSON_FALSE : JSON_ERROR;
+			case 'n':
+				return read_literal("ull") ? JSON_NULL : JSON_ERROR;
+			default:
+				if ((c >= '0' && c <= '9') || c == '-') {
+					return read_number(c);
+				}
+				return JSON_ERROR;
+		}
+	}
+}
+
+/*
+** Skip the value that starts with the given token, including everything
+** that's nested inside of it.
+*/
+bool gdsqlite_json_reader::skip_value(JSON_TOKEN p_token) {
+	int depth = 0;
+	JSON_TOKEN token = p_token;
+	while (true) {
+		switch (token) {
+			case JSON_BEGIN_OBJECT:
+			case JSON_BEGIN_ARRAY:
+				depth++;
+				break;
+			case JSON_END_OBJECT:
+			case JSON_END_ARRAY:
+				depth--;
+				break;
+			case JSON_END:
+			case JSON_ERROR:
+				return false;
+			default:
+				break;
+		}
+		if (depth <= 0) {
+			return depth == 0;
+		}
+		token = next();
+	}
+}
+
+/*
+** Go back to the start of the document.
+*/
+void gdsqlite_json_reader::rewind() {
+	if (file.is_valid()) {
+		file->seek(0);
+		data_size = 0;
+	}
+	position = 0;
+	line = 1;
+}
+
+const std::string &gdsqlite_json_reader::get_string() const {
+	return string;
+}
+
+int64_t gdsqlite_json_reader::get_integer() const {
+	return integer;
+}
+
+double gdsqlite_json_reader::get_real() const {
+	return real;
+}
+
+int64_t gdsqlite_json_reader::get_line() const {
+	return line;
+}
@@ -0,0 +1,120 @@
+#ifndef GDSQLITE_JSON_H
+#define GDSQLITE_JSON_H
+
+#include <godot_cpp/classes/file_access.hpp>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/*
+** The writer flushes its buffer to the file whenever it grows beyond this size,
+** while the reader refills its buffer from the file in chunks of this size.
+*/
+#define JSON_WRITE_BUFFER_SIZE (256 * 1024)
+#define JSON_READ_BUFFER_SIZE (256 * 1024)
+
+namespace godot {
+/*
+** Writes a JSON document piece by piece. Every value goes on a line of its
+** own, indented with tabs and with a space after each colon, or without any
+** whitespace at all in compact mode. Keys are written in the order in which
+** they are given. Without a file, the complete document is kept in memory and
+** can be retrieved with get_buffer() afterwards. Fragments that are nested
+** inside of another document start at a base_depth larger than zero.
+*/
+class gdsqlite_json_writer {
+	Ref<FileAccess> file;
+	std::string buffer;
+	bool compact;
+	int base_depth;
+
+	/* One entry per open array or object, true as long as it's still empty */
+	std::vector<bool> scopes;
+	bool after_key = false;
+
+	void begin_value();
+	void newline();
+	void write_string(const char *p_string, size_t p_length);
+	void flush_if_needed();
+
+public:
+	gdsqlite_json_writer(const Ref<FileAccess> &p_file, bool p_compact, int p_base_depth = 0);
+
+	void begin_object();
+	void end_object();
+	void begin_array();
+	void end_array();
+
+	void key(const char *p_key);
+	void string_value(const char *p_string, size_t p_length);
+	void string_value(const String &p_string);
+	void int_value(int64_t p_value);
+	void real_value(double p_value);
+	void null_value();
+	void base64_value(const uint8_t *p_data, size_t p_size);
+	void raw_value(const std::string &p_json);
+
+	bool finish();
+	bool is_compact() const;
+	const std::string &get_buffer() const;
+	void take_buffer(std::string &r_buffer);
+};
+
+enum JSON_TOKEN {
+	JSON_BEGIN_OBJECT,
+	JSON_END_OBJECT,
+	JSON_BEGIN_ARRAY,
+	JSON_END_ARRAY,
+	JSON_STRING,
+	JSON_INTEGER,
+	JSON_REAL,
+	JSON_TRUE,
+	JSON_FALSE,
+	JSON_NULL,
+	JSON_END,
+	JSON_ERROR
+};
+
+/*
+** Pulls a JSON document token by token from either a file or a memory buffer,
+** such that arbitrarily large documents can be processed without keeping them
+** in memory. Commas and colons are treated as whitespace; it's up to the
+** caller to check that the tokens appear in a sensible order.
+*/
+class gdsqlite_json_reader {
+	Ref<FileAccess> file;
+	std::vector<uint8_t> file_buffer;
+	const uint8_t *data = nullptr;
+	size_t data_size = 0;
+	size_t position = 0;
+	int64_t line = 1;
+
+	std::string string;
+	int64_t integer = 0;
+	double real = 0.0;
+
+	bool fill();
+	int peek();
+	int get();
+	bool read_string();
+	JSON_TOKEN read_number(int p_first);
+	bool read_literal(const char *p_rest);
+
+public:
+	gdsqlite_json_reader(const Ref<FileAccess> &p_file);
+	gdsqlite_json_reader(const uint8_t *p_data, size_t p_size);
+
+	JSON_TOKEN next();
+	bool skip_value(JSON_TOKEN p_token);
+	void rewind();
+
+	const std::string &get_string() const;
+	int64_t get_integer() const;
+	double get_real() const;
+	int64_t get_line() const;
+};
+
+} //namespace godot
+
+#endif
@@ -0,0 +1,198 @@
+#include "gdsqlite_live_query.hpp"
+#include "gdsqlite.hpp"
+
+#include <godot_cpp/variant/callable_method_pointer.hpp>
+
+#include <algorithm>
+
+using namespace godot;
+
+void SQLiteLiveQuery::_bind_methods() {
+	// Methods.
+	ClassDB::bind_method(D_METHOD("get_result"), &SQLiteLiveQuery::get_result);
+	ClassDB::bind_method(D_METHOD("get_tables"), &SQLiteLiveQuery::get_tables);
+	ClassDB::bind_method(D_METHOD("is_dirty"), &SQLiteLiveQuery::is_dirty);
+	ClassDB::bind_method(D_METHOD("invalidate"), &SQLiteLiveQuery::invalidate);
+
+	// Signals.
+	ADD_SIGNAL(MethodInfo("result_changed", PropertyInfo(Variant::ARRAY, "result", PROPERTY_HINT_ARRAY_TYPE, "Dictionary")));
+}
+
+SQLiteLiveQuery::SQLiteLiveQuery() {
+}
+
+SQLiteLiveQuery::~SQLiteLiveQuery() {
+	release();
+}
+
+/*
+** Collect the names of all tables that are read by the statement. Tables that
+** are read through views are reported as well.
+*/
+int SQLiteLiveQuery::authorizer_callback(void *p_context, int p_action, const char *p_table, const char *p_column, const char *p_database, const char *p_trigger) {
+	if (p_action == SQLITE_READ && p_table) {
+		PackedStringArray *tables = static_cast<PackedStringArray *>(p_context);
+		String table_name = String::utf8(p_table);
+		if (!tables->has(table_name)) {
+			tables->append(table_name);
+		}
+	}
+	return SQLITE_OK;
+}
+
+bool SQLiteLiveQuery::start(const Ref<SQLite> &p_database, const String &p_query_string, const Array &p_param_bindings) {
+	sqlite3 *db = p_database->db;
+	const CharString dummy_query = p_query_string.utf8();
+
+	/* The statement is only prepared to find out which tables it depends on */
+	sqlite3_stmt *stmt;
+	sqlite3_set_authorizer(db, authorizer_callback, &tables);
+	int rc = sqlite3_prepare_v2(db, dummy_query.get_data(), -1, &stmt, nullptr);
+	sqlite3_set_authorizer(db, NULL, NULL);
+	if (rc != SQLITE_OK) {
+		ERR_PRINT("GDSQLite Error: Can't watch query: " + String::utf8(sqlite3_errmsg(db)));
+		return false;
+	}
+	bool read_only = sqlite3_stmt_readonly(stmt);
+	sqlite3_finalize(stmt);
+	if (!read_only) {
+		ERR_PRINT("GDSQLite Error: Can't watch a query that writes to the database!");
+		return false;
+	}
+
+	database = p_database;
+	query_string = p_query_string;
+	param_bindings = p_param_bindings.duplicate();
+
+	Callable callable = callable_mp(this, &SQLiteLiveQuery::on_changes);
+	for (int64_t i = 0; i < tables.size(); i++) {
+		database->subscribe_changes(tables[i], callable, SQLite::CHANGE_ALL);
+	}
+	database->live_queries.push_back(this);
+	return true;
+}
+
+/*
+** Run the query again on a statement of its own, such that the query_result
+** and error_message of the database are left alone.
+*/
+bool SQLiteLiveQuery::execute() {
+	SQLite::call_guard guard(database.ptr());
+	sqlite3 *db = database->db;
+	if (db == nullptr) {
+		return false;
+	}
+
+	const CharString dummy_query = query_string.utf8();
+	sqlite3_stmt *stmt;
+	if (sqlite3_prepare_v2(db, dummy_query.get_data(), -1, &stmt, nullptr) != SQLITE_OK) {
+		ERR_PRINT("GDSQLite Error: Can't execute live query: " + String::utf8(sqlite3_errmsg(db)));
+		return false;
+	}
+
+	int parameter_count = sqlite3_bind_parameter_count(stmt);
+	if (param_bindings.size() < parameter_count) {
+		ERR_PRINT("GDSQLite Error: Insufficient number of parameters to satisfy required number of bindings in statement!");
+		sqlite3_finalize(stmt);
+		return false;
+	}
+	for (int i = 0; i < parameter_count; i++) {
+		if (!database->bind_parameter(param_bindings[i], stmt, i)) {
+			sqlite3_finalize(stmt);
+			return false;
+		}
+	}
+
+	TypedArray<Dictionary> rows;
+	int rc = SQLite::read_statement_rows(stmt, rows);
+	sqlite3_finalize(stmt);
+	if (rc != SQLITE_DONE) {
+		ERR_PRINT("GDSQLite Error: Can't execute live query: " + String::utf8(sqlite3_errmsg(db)));
+		return false;
+	}
+	result = rows;
+	dirty = false;
+	return true;
+}
+
+/*
+** Called with the committed changes of any of the tables of the query, once
+** per table. A single refresh is scheduled for all tables of the same flush.
+*/
+void SQLiteLiveQuery::on_changes(const String &p_table_name, const PackedInt64Array &p_inserted, const PackedInt64Array &p_updated, const PackedInt64Array &p_deleted) {
+	dirty = true;
+	if (refresh_scheduled || get_signal_connection_list("result_changed").is_empty()) {
+		return;
+	}
+	refresh_scheduled = true;
+	callable_mp(this, &SQLiteLiveQuery::run_scheduled_refresh).call_deferred();
+}
+
+/*
+** The result might already be up-to-date, if get_result() was called in the
+** meantime.
+*/
+void SQLiteLiveQuery::run_scheduled_refresh() {
+	refresh_scheduled = false;
+	if (dirty) {
+		refresh();
+	}
+}
+
+/*
+** Mark the result as outdated. Nobody is waiting for the new result unless
+** result_changed is connected, in which case it's executed right away.
+*/
+void SQLiteLiveQuery::refresh() {
+	dirty = true;
+	if (database.is_null() || get_signal_connection_list("result_changed").is_empty()) {
+		return;
+	}
+
+	TypedArray<Dictionary> previous_result = result;
+	if (execute() && result != previous_result) {
+		emit_signal("result_changed", result);
+	}
+}
+
+void SQLiteLiveQuery::release() {
+	if (database.is_null()) {
+		return;
+	}
+	Callable callable = callable_mp(this, &SQLiteLiveQuery::on_changes);
+	for (int64_t i = 0; i < tables.size(); i++) {
+		database->unsubscribe_changes(tables[i], callable);
+	}
+	std::vector<SQLiteLiveQuery *> &live_queries = database->live_queries;
+	live_queries.erase(std::remove(live_queries.begin(), live_queries.end(), this), live_queries.end());
+	database.unref();
+	dirty = true;
+}
+
+/*
+** Get the current result of the query, which is only executed again if any of
+** its tables have changed since the previous execution.
+*/
+TypedArray<Dictionary> SQLiteLiveQuery::get_result() {
+	if (dirty && database.is_valid()) {
+		execute();
+	}
+	return result;
+}
+
+PackedStringArray SQLiteLiveQuery::get_tables() const {
+	return tables;
+}
+
+bool SQLiteLiveQuery::is_dirty() const {
+	return dirty;
+}
+
+/*
+** Force the query to be executed again, for example after changes that the
+** hooks of SQLite don't report, such as changes to WITHOUT ROWID tables or
+** changes made by other connections.
+*/
+void SQLiteLiveQuery::invalidate() {
+	refresh();
+}
@@ -0,0 +1,63 @@
+#ifndef SQLITE_LIVE_QUERY_CLASS_H
+#define SQLITE_LIVE_QUERY_CLASS_H
+
+#include <godot_cpp/classes/ref_counted.hpp>
+#include <godot_cpp/core/binder_common.hpp>
+#include <godot_cpp/core/class_db.hpp>
+#include <godot_cpp/variant/typed_array.hpp>
+
+#include <sqlite/sqlite3.h>
+
+namespace godot {
+class SQLite;
+
+/*
+** A query whose result is kept up-to-date with the tables it reads from.
+** The tables are determined once by an authorizer while preparing the query,
+** after which the query subscribes to their changes. The query is only
+** executed again when one of these tables has changed, either once per flush
+** of the changes if anyone is connected to result_changed, or otherwise the
+** next time that its result is requested. Live queries are created with
+** SQLite::watch_query().
+*/
+class SQLiteLiveQuery : public RefCounted {
+	GDCLASS(SQLiteLiveQuery, RefCounted)
+
+	friend class SQLite;
+
+private:
+	Ref<SQLite> database;
+	String query_string;
+	Array param_bindings;
+	PackedStringArray tables;
+
+	TypedArray<Dictionary> result;
+	bool dirty = true;
+	bool refresh_scheduled = false;
+
+	static int authorizer_callback(void *p_context, int p_action, const char *p_table, const char *p_column, const char *p_database, const char *p_trigger);
+
+	bool start(const Ref<SQLite> &p_database, const String &p_query_string, const Array &p_param_bindings);
+	bool execute();
+	void refresh();
+	void run_scheduled_refresh();
+	void on_changes(const String &p_table_name, const PackedInt64Array &p_inserted, const PackedInt64Array &p_updated, const PackedInt64Array &p_deleted);
+	void release();
+
+protected:
+	static void _bind_methods();
+
+public:
+	SQLiteLiveQuery();
+	~SQLiteLiveQuery();
+
+	// Functions.
+	TypedArray<Dictionary> get_result();
+	PackedStringArray get_tables() const;
+	bool is_dirty() const;
+	void invalidate();
+};
+
+} //namespace godot
+
+#endif // ! SQLITE_LIVE_QUERY_CLASS_H
@@ -0,0 +1,241 @@
+#include "gdsqlite_pragmas.hpp"
+
+#include <godot_cpp/variant/array.hpp>
+#include <godot_cpp/variant/packed_string_array.hpp>
+
+#include <cstdint>
+
+using namespace godot;
+
+namespace {
+enum PRAGMA_TYPE {
+	PRAGMA_BOOLEAN,
+	PRAGMA_INTEGER,
+	PRAGMA_KEYWORD
+};
+
+struct pragma_definition {
+	const char *name;
+	PRAGMA_TYPE type;
+	/* Allowed values of keyword pragmas, terminated by a nullptr */
+	const char *const *keywords;
+	/* Keywords that have a numeric equivalent are set by their index instead */
+	bool numeric_keywords;
+	int64_t minimum;
+	/* Pragmas that modify the database file itself can't be set on read-only connections */
+	bool writes_database;
+};
+
+struct preset_value {
+	const char *name;
+	const char *value;
+};
+
+struct pragma_preset {
+	const char *name;
+	const preset_value *values;
+};
+
+const char *const journal_modes[] = { "DELETE", "TRUNCATE", "PERSIST", "MEMORY", "WAL", "OFF", nullptr };
+const char *const locking_modes[] = { "NORMAL", "EXCLUSIVE", nullptr };
+const char *const synchronous_modes[] = { "OFF", "NORMAL", "FULL", "EXTRA", nullptr };
+const char *const temp_stores[] = { "DEFAULT", "FILE", "MEMORY", nullptr };
+
+/*
+** The order of this list is the order in which the pragmas are applied.
+*/
+const pragma_definition definitions[] = {
+	{ "page_size", PRAGMA_INTEGER, nullptr, false, 512, true },
+	{ "journal_mode", PRAGMA_KEYWORD, journal_modes, false, 0, true },
+	{ "locking_mode", PRAGMA_KEYWORD, locking_modes, false, 0, false },
+	{ "synchronous", PRAGMA_KEYWORD, synchronous_modes, true, 0, false },
+	{ "temp_store", PRAGMA_KEYWORD, temp_stores, true, 0, false },
+	{ "cache_size", PRAGMA_INTEGER, nullptr, false, INT64_MIN, false },
+	{ "cache_spill", PRAGMA_BOOLEAN, nullptr, false, 0, false },
+	{ "mmap_size", PRAGMA_INTEGER, nullptr, false, 0, false },
+	{ "busy_timeout", PRAGMA_INTEGER, nullptr, false, 0, false },
+	{ "wal_autocheckpoint", PRAGMA_INTEGER, nullptr, false, 0, false },
+	{ "journal_size_limit", PRAGMA_INTEGER, nullptr, false, -1, false },
+	{ "foreign_keys", PRAGMA_BOOLEAN, nullptr, false, 0, false },
+	{ "recursive_triggers", PRAGMA_BOOLEAN, nullptr, false, 0, false },
+	{ "automatic_index", PRAGMA_BOOLEAN, nullptr, false, 0, false },
+	{ "secure_delete", PRAGMA_BOOLEAN, nullptr, false, 0, false },
+	{ "query_only", PRAGMA_BOOLEAN, nullptr, false, 0, false },
+};
+const int definition_count = sizeof(definitions) / sizeof(definitions[0]);
+
+/* Survives power loss at the cost of an fsync on every commit */
+const preset_value durable_values[] = {
+	{ "journal_mode", "WAL" },
+	{ "synchronous", "2" },
+	{ "busy_timeout", "5000" },
+	{ nullptr, nullptr },
+};
+
+/* Save files and caches on local storage, where losing the last commit on power loss is acceptable */
+const preset_value fast_local_values[] = {
+	{ "journal_mode", "WAL" },
+	{ "synchronous", "1" },
+	{ "temp_store", "2" },
+	{ "cache_size", "-16384" },
+	{ "mmap_size", "268435456" },
+	{ "busy_timeout", "5000" },
+	{ nullptr, nullptr },
+};
+
+/* Content databases that are shipped with the game and never written to */
+const preset_value read_only_content_values[] = {
+	{ "query_only", "1" },
+	{ "locking_mode", "EXCLUSIVE" },
+	{ "temp_store", "2" },
+	{ "cache_size", "-8192" },
+	{ nullptr, nullptr },
+};
+
+const pragma_preset presets[] = {
+	{ "durable", durable_values },
+	{ "fast_local", fast_local_values },
+	{ "read_only_content", read_only_content_values },
+};
+const int preset_count = sizeof(presets) / sizeof(presets[0]);
+
+int find_definition(const String &p_name) {
+	for (int i = 0; i < definition_count; i++) {
+		if (p_name == definitions[i].name) {
+			return i;
+		}
+	}
+	return -1;
+}
+
+bool validate_value(const pragma_definition &p_definition, const Variant &p_value, String &r_value) {
+	switch (p_definition.type) {
+		case PRAGMA_BOOLEAN:
+			if (p_value.get_type() == Variant::BOOL || (p_value.get_type() == Variant::INT && ((int64_t)p_value == 0 || (int64_t)p_value == 1))) {
+				r_value = (bool)p_value ? "1" : "0";
+				return true;
+			}
+			return false;
+
+		case PRAGMA_INTEGER: {
+			if (p_value.get_type() != Variant::INT) {
+				return false;
+			}
+			int64_t value = p_value;
+			if (value < p_definition.minimum) {
+				return false;
+			}
+			/* The page size has to be a power of two between 512 and 65536 */
+			if (String(p_definition.name) == "page_size" && (value > 65536 || (value & (value - 1)) != 0)) {
+				return false;
+			}
+			r_value = String::num_int64(value);
+			return true;
+		}
+
+		case PRAGMA_KEYWORD: {
+			if (p_value.get_type() == Variant::INT && p_definition.numeric_keywords) {
+				int64_t index = p_value;
+				for (int i = 0; p_definition.keywords[i]; i++) {
+					if (i == index) {
+						r_value = String::num_int64(index);
+						return true;
+					}
+				}
+				return false;
+			}
+			if (p_value.get_type() != Variant::STRING && p_value.get_type() != Variant::STRING_NAME) {
+				return false;
+			}
+			String keyword = String(p_value).to_upper();
+			for (int i = 0; p_definition.keywords[i]; i++) {
+				if (keyword == p_definition.keywords[i]) {
+					r_value = p_definition.numeric_keywords ? String::num_int64(i) : keyword;
+					return true;
+				}
+			}
+			return false;
+		}
+	}
+	return false;
+}
+
+String describe_allowed_values(const pragma_definition &p_definition) {
+	switch (p_definition.type) {
+		case PRAGMA_BOOLEAN:
+			return "a boolean";
+		case PRAGMA_INTEGER:
+			if (String(p_definition.name) == "page_size") {
+				return "a power of two between 512 and 65536";
+			}
+			return p_definition.minimum == INT64_MIN ? String("an integer") : "an integer of at least " + String::num_int64(p_definition.minimum);
+		case PRAGMA_KEYWORD: {
+			PackedStringArray keywords;
+			for (int i = 0; p_definition.keywords[i]; i++) {
+				keywords.append(p_definition.keywords[i]);
+			}
+			return "one of " + String(", ").join(keywords);
+		}
+	}
+	return String();
+}
+} //namespace
+
+bool godot::gdsqlite_resolve_pragmas(const String &p_preset, const Dictionary &p_pragmas, bool p_read_only, std::vector<gdsqlite_pragma_setting> &r_settings, String &r_error) {
+	String values[definition_count];
+	bool is_set[definition_count] = {};
+
+	if (!p_preset.is_empty()) {
+		const pragma_preset *preset = nullptr;
+		for (int i = 0; i < preset_count; i++) {
+			if (p_preset == presets[i].name) {
+				preset = &presets[i];
+				break;
+			}
+		}
+		if (preset == nullptr) {
+			r_error = "Unknown pragma preset \"" + p_preset + "\"!";
+			return false;
+		}
+		for (const preset_value *value = preset->values; value->name; value++) {
+			int index = find_definition(value->name);
+			values[index] = value->value;
+			is_set[index] = true;
+		}
+	}
+
+	Array names = p_pragmas.keys();
+	for (int64_t i = 0; i < names.size(); i++) {
+		String name = String(names[i]).to_lower();
+		int index = find_definition(name);
+		if (index == -1) {
+			r_error = "Unsupported pragma \"" + name + "\"!";
+			return false;
+		}
+		if (!validate_value(definitions[index], p_pragmas[names[i]], values[index])) {
+			r_error = "Invalid value for pragma \"" + name + "\", expected " + describe_allowed_values(definitions[index]) + "!";
+			return false;
+		}
+		is_set[index] = true;
+	}
+
+	r_settings.clear();
+	for (int i = 0; i < definition_count; i++) {
+		if (!is_set[i]) {
+			continue;
+		}
+		if (p_read_only && definitions[i].writes_database) {
+			r_error = "Pragma \"" + String(definitions[i].name) + "\" can't be set on read-only connections!";
+			return false;
+		}
+		r_settings.push_back({ definitions[i].name, values[i] });
+	}
+	return true;
+}
+
+bool godot::gdsqlite_pragma_matches(const gdsqlite_pragma_setting &p_setting, const Variant &p_effective_value) {
+	if (p_setting.value.is_valid_int()) {
+		return p_effective_value.get_type() == Variant::INT && (int64_t)p_effective_value == p_setting.value.to_int();
+	}
+	return String(p_effective_value).to_upper() == p_setting.value;
+}
@@ -0,0 +1,33 @@
+#ifndef GDSQLITE_PRAGMAS_H
+#define GDSQLITE_PRAGMAS_H
+
+#include <godot_cpp/variant/dictionary.hpp>
+#include <godot_cpp/variant/string.hpp>
+
+#include <vector>
+
+namespace godot {
+struct gdsqlite_pragma_setting {
+	const char *name;
+	/* The value as it appears in the PRAGMA-statement */
+	String value;
+};
+
+/*
+** Combine the pragmas of the given preset with the explicitly given pragmas,
+** which take precedence, and validate all of them before anything is applied.
+** Only a fixed set of pragmas that tune the connection is supported. The
+** settings are returned in the order in which they have to be applied, e.g.
+** page_size has to be set before switching the journal_mode to WAL.
+*/
+bool gdsqlite_resolve_pragmas(const String &p_preset, const Dictionary &p_pragmas, bool p_read_only, std::vector<gdsqlite_pragma_setting> &r_settings, String &r_error);
+
+/*
+** Check whether the value of a pragma as read back from the connection
+** matches the value that was set.
+*/
+bool gdsqlite_pragma_matches(const gdsqlite_pragma_setting &p_setting, const Variant &p_effective_value);
+
+} //namespace godot
+
+#endif
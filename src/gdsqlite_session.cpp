@@ -0,0 +1,218 @@
+#include "gdsqlite_session.hpp"
+#include "gdsqlite.hpp"
+
+#include <algorithm>
+
+using namespace godot;
+
+#ifndef SQLITE_ENABLE_SESSION
+#define SESSION_NOT_ENABLED_ERROR "GDSQLite Error: Sessions require the plugin to be compiled with the `enable_session` flag!"
+#endif
+
+void SQLiteSession::_bind_methods() {
+	// Methods.
+	ClassDB::bind_method(D_METHOD("attach", "table_name"), &SQLiteSession::attach, DEFVAL(""));
+	ClassDB::bind_method(D_METHOD("changeset"), &SQLiteSession::changeset);
+	ClassDB::bind_method(D_METHOD("patchset"), &SQLiteSession::patchset);
+	ClassDB::bind_method(D_METHOD("apply_changeset", "changeset", "conflict_policy"), &SQLiteSession::apply_changeset, DEFVAL(CONFLICT_ABORT));
+	ClassDB::bind_method(D_METHOD("is_empty"), &SQLiteSession::is_empty);
+
+	// Properties.
+	ClassDB::bind_method(D_METHOD("set_enabled", "enabled"), &SQLiteSession::set_enabled);
+	ClassDB::bind_method(D_METHOD("get_enabled"), &SQLiteSession::get_enabled);
+	ADD_PROPERTY(PropertyInfo(Variant::BOOL, "enabled"), "set_enabled", "get_enabled");
+
+	BIND_ENUM_CONSTANT(CONFLICT_OMIT);
+	BIND_ENUM_CONSTANT(CONFLICT_REPLACE);
+	BIND_ENUM_CONSTANT(CONFLICT_ABORT);
+}
+
+SQLiteSession::SQLiteSession() {
+}
+
+SQLiteSession::~SQLiteSession() {
+	release();
+}
+
+bool SQLiteSession::start(const Ref<SQLite> &p_database, const String &p_database_name) {
+#ifdef SQLITE_ENABLE_SESSION
+	const CharString utf8_name = p_database_name.utf8();
+	int rc = sqlite3session_create(p_database->db, utf8_name.get_data(), &session);
+	if (rc != SQLITE_OK) {
+		ERR_PRINT("GDSQLite Error: Can't create session: " + String::utf8(sqlite3_errstr(rc)));
+		session = nullptr;
+		return false;
+	}
+	database = p_database;
+	database->sessions.push_back(this);
+	return true;
+#else
+	ERR_PRINT(SESSION_NOT_ENABLED_ERROR);
+	return false;
+#endif
+}
+
+/*
+** Delete the session, which has to happen before its connection is closed.
+*/
+void SQLiteSession::release() {
+#ifdef SQLITE_ENABLE_SESSION
+	if (session) {
+		sqlite3session_delete(session);
+		session = nullptr;
+	}
+#endif
+	if (database.is_valid()) {
+		std::vector<SQLiteSession *> &sessions = database->sessions;
+		sessions.erase(std::remove(sessions.begin(), sessions.end(), this), sessions.end());
+		database.unref();
+	}
+}
+
+bool SQLiteSession::is_open() const {
+#ifdef SQLITE_ENABLE_SESSION
+	if (session == nullptr) {
+		ERR_PRINT("GDSQLite Error: Session is no longer valid, as its database connection was closed!");
+		return false;
+	}
+	return true;
+#else
+	ERR_PRINT(SESSION_NOT_ENABLED_ERROR);
+	return false;
+#endif
+}
+
+/*
+** Start recording the changes of the given table, or of all tables when no
+** name is given. Only tables with a PRIMARY KEY are recorded.
+*/
+bool SQLiteSession::attach(const String &p_table_name) {
+	if (!is_open()) {
+		return false;
+	}
+#ifdef SQLITE_ENABLE_SESSION
+	const CharString utf8_name = p_table_name.utf8();
+	int rc = sqlite3session_attach(session, p_table_name.is_empty() ? nullptr : utf8_name.get_data());
+	if (rc != SQLITE_OK) {
+		ERR_PRINT("GDSQLite Error: Can't attach table \"" + p_table_name + "\" to session: " + String::utf8(sqlite3_errstr(rc)));
+		return false;
+	}
+	return true;
+#else
+	return false;
+#endif
+}
+
+PackedByteArray SQLiteSession::changeset() {
+	PackedByteArray changeset_buffer;
+	if (!is_open()) {
+		return changeset_buffer;
+	}
+#ifdef SQLITE_ENABLE_SESSION
+	int size = 0;
+	void *data = nullptr;
+	int rc = sqlite3session_changeset(session, &size, &data);
+	if (rc != SQLITE_OK) {
+		ERR_PRINT("GDSQLite Error: Can't generate changeset: " + String::utf8(sqlite3_errstr(rc)));
+	} else if (size > 0) {
+		changeset_buffer.resize(size);
+		memcpy(changeset_buffer.ptrw(), data, size);
+	}
+	sqlite3_free(data);
+#endif
+	return changeset_buffer;
+}
+
+/*
+** Patchsets are smaller than changesets as they omit the original values of
+** updated and deleted rows, at the cost of less precise conflict detection.
+*/
+PackedByteArray SQLiteSession::patchset() {
+	PackedByteArray patchset_buffer;
+	if (!is_open()) {
+		return patchset_buffer;
+	}
+#ifdef SQLITE_ENABLE_SESSION
+	int size = 0;
+	void *data = nullptr;
+	int rc = sqlite3session_patchset(session, &size, &data);
+	if (rc != SQLITE_OK) {
+		ERR_PRINT("GDSQLite Error: Can't generate patchset: " + String::utf8(sqlite3_errstr(rc)));
+	} else if (size > 0) {
+		patchset_buffer.resize(size);
+		memcpy(patchset_buffer.ptrw(), data, size);
+	}
+	sqlite3_free(data);
+#endif
+	return patchset_buffer;
+}
+
+#ifdef SQLITE_ENABLE_SESSION
+int SQLiteSession::conflict_callback(void *p_context, int p_conflict, sqlite3_changeset_iter *p_iterator) {
+	ConflictPolicy policy = *static_cast<ConflictPolicy *>(p_context);
+	switch (policy) {
+		case CONFLICT_OMIT:
+			return SQLITE_CHANGESET_OMIT;
+		case CONFLICT_REPLACE:
+			/* Replacing is only possible if there's a conflicting row to replace */
+			if (p_conflict == SQLITE_CHANGESET_DATA || p_conflict == SQLITE_CHANGESET_CONFLICT) {
+				return SQLITE_CHANGESET_REPLACE;
+			}
+			return SQLITE_CHANGESET_OMIT;
+		default:
+			return SQLITE_CHANGESET_ABORT;
+	}
+}
+#endif
+
+/*
+** Apply a changeset or patchset to the database of this session. The changes
+** aren't recorded by the session itself, such that changes received from
+** elsewhere aren't sent back again. All changes are applied in a single
+** transaction, which is rolled back entirely when aborting on a conflict.
+*/
+bool SQLiteSession::apply_changeset(const PackedByteArray &p_changeset, ConflictPolicy p_conflict_policy) {
+	if (!is_open()) {
+		return false;
+	}
+#ifdef SQLITE_ENABLE_SESSION
+	bool enabled = sqlite3session_enable(session, -1);
+	sqlite3session_enable(session, 0);
+	int rc = sqlite3changeset_apply(database->db, p_changeset.size(), const_cast<uint8_t *>(p_changeset.ptr()), nullptr, conflict_callback, &p_conflict_policy);
+	sqlite3session_enable(session, enabled);
+
+	if (rc != SQLITE_OK) {
+		database->error_message = String::utf8(sqlite3_errstr(rc));
+		ERR_PRINT("GDSQLite Error: Can't apply changeset: " + database->error_message);
+		return false;
+	}
+	return true;
+#else
+	return false;
+#endif
+}
+
+bool SQLiteSession::is_empty() const {
+#ifdef SQLITE_ENABLE_SESSION
+	return session == nullptr || sqlite3session_isempty(session);
+#else
+	return true;
+#endif
+}
+
+void SQLiteSession::set_enabled(const bool &p_enabled) {
+	if (!is_open()) {
+		return;
+	}
+#ifdef SQLITE_ENABLE_SESSION
+	sqlite3session_enable(session, p_enabled);
+#endif
+}
+
+bool SQLiteSession::get_enabled() const {
+#ifdef SQLITE_ENABLE_SESSION
+	return session && sqlite3session_enable(session, -1);
+#else
+	return false;
+#endif
+}
@@ -0,0 +1,68 @@
+#ifndef SQLITE_SESSION_CLASS_H
+#define SQLITE_SESSION_CLASS_H
+
+#include <godot_cpp/classes/ref_counted.hpp>
+#include <godot_cpp/core/binder_common.hpp>
+#include <godot_cpp/core/class_db.hpp>
+#include <godot_cpp/variant/packed_byte_array.hpp>
+
+#include <sqlite/sqlite3.h>
+
+namespace godot {
+class SQLite;
+
+/*
+** Records the changes made to the attached tables of a connection, using
+** SQLite's session extension, such that they can be shipped as a changeset
+** or patchset and applied to another database later on. Sessions are created
+** with SQLite::create_session() and become invalid once the connection is
+** closed.
+*/
+class SQLiteSession : public RefCounted {
+	GDCLASS(SQLiteSession, RefCounted)
+
+	friend class SQLite;
+
+private:
+	Ref<SQLite> database;
+#ifdef SQLITE_ENABLE_SESSION
+	sqlite3_session *session = nullptr;
+
+	static int conflict_callback(void *p_context, int p_conflict, sqlite3_changeset_iter *p_iterator);
+#endif
+
+	bool start(const Ref<SQLite> &p_database, const String &p_database_name);
+	void release();
+	bool is_open() const;
+
+protected:
+	static void _bind_methods();
+
+public:
+	// Constants.
+	enum ConflictPolicy {
+		CONFLICT_OMIT = 0,
+		CONFLICT_REPLACE = 1,
+		CONFLICT_ABORT = 2
+	};
+
+	SQLiteSession();
+	~SQLiteSession();
+
+	// Functions.
+	bool attach(const String &p_table_name);
+	PackedByteArray changeset();
+	PackedByteArray patchset();
+	bool apply_changeset(const PackedByteArray &p_changeset, ConflictPolicy p_conflict_policy);
+	bool is_empty() const;
+
+	// Properties.
+	void set_enabled(const bool &p_enabled);
+	bool get_enabled() const;
+};
+
+} //namespace godot
+
+VARIANT_ENUM_CAST(SQLiteSession::ConflictPolicy);
+
+#endif // ! SQLITE_SESSION_CLASS_H
@@ -0,0 +1,58 @@
+#include "gdsqlite_snapshot.hpp"
+#include "gdsqlite.hpp"
+
+using namespace godot;
+
+void SQLiteSnapshot::_bind_methods() {
+	// Methods.
+	ClassDB::bind_method(D_METHOD("compare", "other"), &SQLiteSnapshot::compare);
+
+	ClassDB::bind_method(D_METHOD("get_path"), &SQLiteSnapshot::get_path);
+	ClassDB::bind_method(D_METHOD("get_database_name"), &SQLiteSnapshot::get_database_name);
+}
+
+SQLiteSnapshot::SQLiteSnapshot() {
+}
+
+SQLiteSnapshot::~SQLiteSnapshot() {
+#ifdef SQLITE_ENABLE_SNAPSHOT
+	if (snapshot) {
+		sqlite3_snapshot_free(snapshot);
+		snapshot = nullptr;
+	}
+#endif
+	/* Ending the read transaction allows checkpoints to restart the WAL again */
+	if (pin_connection.is_valid()) {
+		pin_connection->close_db();
+		pin_connection.unref();
+	}
+}
+
+/*
+** Returns a negative number if this snapshot is older than the other one, a
+** positive number if it is newer and zero if both are the same. Snapshots
+** can only be compared if they were taken of the same database.
+*/
+int64_t SQLiteSnapshot::compare(const Ref<SQLiteSnapshot> &p_other) const {
+	if (p_other.is_null() || p_other->snapshot == nullptr || snapshot == nullptr) {
+		ERR_PRINT("GDSQLite Error: Can't compare with an invalid snapshot!");
+		return 0;
+	}
+	if (p_other->path != path || p_other->database_name != database_name) {
+		ERR_PRINT("GDSQLite Error: Can't compare snapshots of different databases!");
+		return 0;
+	}
+#ifdef SQLITE_ENABLE_SNAPSHOT
+	return sqlite3_snapshot_cmp(snapshot, p_other->snapshot);
+#else
+	return 0;
+#endif
+}
+
+String SQLiteSnapshot::get_path() const {
+	return path;
+}
+
+String SQLiteSnapshot::get_database_name() const {
+	return database_name;
+}
@@ -0,0 +1,51 @@
+#ifndef SQLITE_SNAPSHOT_CLASS_H
+#define SQLITE_SNAPSHOT_CLASS_H
+
+#include <godot_cpp/classes/ref_counted.hpp>
+#include <godot_cpp/core/binder_common.hpp>
+#include <godot_cpp/core/class_db.hpp>
+
+#include <sqlite/sqlite3.h>
+
+namespace godot {
+class SQLite;
+class SQLiteDatabase;
+
+/*
+** A point-in-time view of a database in WAL mode, taken with
+** SQLite::snapshot_open(). Any connection to the same database file can start
+** a read transaction on the snapshot with SQLite::begin_read_snapshot(), such
+** that multiple connections read the exact same state of the database. The
+** snapshot isn't tied to the connection that took it, but snapshots taken by
+** SQLiteDatabase keep a connection of their own to pin them.
+*/
+class SQLiteSnapshot : public RefCounted {
+	GDCLASS(SQLiteSnapshot, RefCounted)
+
+	friend class SQLite;
+	friend class SQLiteDatabase;
+
+private:
+	sqlite3_snapshot *snapshot = nullptr;
+	String path;
+	String database_name;
+	/* Connection that holds a read transaction on the snapshot, if any */
+	Ref<SQLite> pin_connection;
+
+protected:
+	static void _bind_methods();
+
+public:
+	SQLiteSnapshot();
+	~SQLiteSnapshot();
+
+	// Functions.
+	int64_t compare(const Ref<SQLiteSnapshot> &p_other) const;
+
+	String get_path() const;
+	String get_database_name() const;
+};
+
+} //namespace godot
+
+#endif // ! SQLITE_SNAPSHOT_CLASS_H
@@ -7,6 +7,11 @@
 #include <godot_cpp/godot.hpp>
 
 #include "gdsqlite.hpp"
+#include "gdsqlite_backup.hpp"
+#include "gdsqlite_database.hpp"
+#include "gdsqlite_live_query.hpp"
+#include "gdsqlite_session.hpp"
+#include "gdsqlite_snapshot.hpp"
 
 using namespace godot;
 
@@ -16,6 +21,11 @@ void initialize_sqlite_module(ModuleInitializationLevel p_level) {
 	}
 
 	GDREGISTER_CLASS(SQLite);
+	GDREGISTER_CLASS(SQLiteBackup);
+	GDREGISTER_CLASS(SQLiteDatabase);
+	GDREGISTER_CLASS(SQLiteLiveQuery);
+	GDREGISTER_CLASS(SQLiteSession);
+	GDREGISTER_CLASS(SQLiteSnapshot);
 }
 
 void uninitialize_sqlite_module(ModuleInitializationLevel p_level) {
@@ -0,0 +1,219 @@
+#include "gdsqlite_compressed_file.hpp"
+
+using namespace godot;
+
+static uint32_t decode_uint32(const uint8_t *p_buffer) {
+	uint32_t value = 0;
+	for (int i = 3; i >= 0; i--) {
+		value = (value << 8) | p_buffer[i];
+	}
+	return value;
+}
+
+static uint64_t decode_uint64(const uint8_t *p_buffer) {
+	uint64_t value = 0;
+	for (int i = 7; i >= 0; i--) {
+		value = (value << 8) | p_buffer[i];
+	}
+	return value;
+}
+
+/*
+** Read the header and the block index of the compressed file.
+*/
+int gdsqlite_compressed_file::read_header() {
+	uint8_t header[COMPRESSED_HEADER_SIZE];
+	int rc = real->pMethods->xRead(real, header, COMPRESSED_HEADER_SIZE, 0);
+	if (rc != SQLITE_OK) {
+		return rc == SQLITE_IOERR_SHORT_READ ? SQLITE_NOTADB : rc;
+	}
+	if (memcmp(header, COMPRESSED_MAGIC, COMPRESSED_MAGIC_SIZE) != 0) {
+		return SQLITE_NOTADB;
+	}
+
+	const uint8_t *field = header + COMPRESSED_MAGIC_SIZE;
+	block_size = decode_uint32(field);
+	compression_mode = decode_uint32(field + 4);
+	uncompressed_size = decode_uint64(field + 8);
+	uint32_t block_count = decode_uint32(field + 16);
+	ERR_FAIL_COND_V(block_size == 0, SQLITE_CORRUPT);
+	ERR_FAIL_COND_V((uint64_t)block_count * block_size < (uint64_t)uncompressed_size, SQLITE_CORRUPT);
+
+	std::vector<uint8_t> index(block_count * COMPRESSED_INDEX_ENTRY_SIZE);
+	if (block_count > 0) {
+		rc = real->pMethods->xRead(real, index.data(), index.size(), COMPRESSED_HEADER_SIZE);
+		if (rc != SQLITE_OK) {
+			return rc == SQLITE_IOERR_SHORT_READ ? SQLITE_CORRUPT : rc;
+		}
+	}
+
+	blocks.resize(block_count);
+	for (uint32_t i = 0; i < block_count; i++) {
+		const uint8_t *entry = index.data() + i * COMPRESSED_INDEX_ENTRY_SIZE;
+		blocks[i].offset = decode_uint64(entry);
+		blocks[i].stored_size = decode_uint32(entry + 8);
+	}
+
+	return SQLITE_OK;
+}
+
+/*
+** Get the decompressed contents of the block at the given index, either
+** from the cache or by reading and decompressing it. The least recently used
+** cache entry makes room for newly decompressed blocks.
+*/
+int gdsqlite_compressed_file::get_block(int64_t p_index, const uint8_t **r_data, int64_t *r_size) {
+	gdsqlite_cached_block *slot = &cache[0];
+	for (int i = 0; i < COMPRESSED_CACHE_SIZE; i++) {
+		if (cache[i].index == p_index) {
+			cache[i].last_used = ++cache_clock;
+			*r_data = cache[i].data.ptr();
+			*r_size = cache[i].data.size();
+			return SQLITE_OK;
+		}
+		if (cache[i].last_used < slot->last_used) {
+			slot = &cache[i];
+		}
+	}
+
+	const gdsqlite_compressed_block &block = blocks[p_index];
+	int64_t original_size = MIN((int64_t)block_size, uncompressed_size - p_index * (int64_t)block_size);
+
+	PackedByteArray stored;
+	stored.resize(block.stored_size);
+	int rc = real->pMethods->xRead(real, stored.ptrw(), block.stored_size, block.offset);
+	if (rc != SQLITE_OK) {
+		return rc == SQLITE_IOERR_SHORT_READ ? SQLITE_CORRUPT : rc;
+	}
+
+	/* Blocks that didn't compress well are stored without compression */
+	if (block.stored_size == original_size) {
+		slot->data = stored;
+	} else {
+		slot->data = stored.decompress(original_size, compression_mode);
+		ERR_FAIL_COND_V_MSG(slot->data.size() != original_size, SQLITE_CORRUPT, "GDSQLITE_VFS Error: Failed to decompress block " + String::num_int64(p_index) + " of the database!");
+	}
+
+	slot->index = p_index;
+	slot->last_used = ++cache_clock;
+	*r_data = slot->data.ptr();
+	*r_size = slot->data.size();
+	return SQLITE_OK;
+}
+
+/*
+** Close a file.
+*/
+int gdsqlite_compressed_file::close(sqlite3_file *pFile) {
+	gdsqlite_compressed_file *p = reinterpret_cast<gdsqlite_compressed_file *>(pFile);
+
+	int rc = p->real->pMethods->xClose(p->real);
+	sqlite3_free(p->real);
+
+	/* The file handle was constructed in-place by `gdsqlite_compressed_vfs_open()` */
+	p->~gdsqlite_compressed_file();
+
+	return rc;
+}
+
+/*
+** Read data from a file, decompressing all the blocks that overlap with
+** the requested range.
+*/
+int gdsqlite_compressed_file::read(sqlite3_file *pFile, void *zBuf, int iAmt, sqlite_int64 iOfst) {
+	gdsqlite_compressed_file *p = reinterpret_cast<gdsqlite_compressed_file *>(pFile);
+	uint8_t *destination = reinterpret_cast<uint8_t *>(zBuf);
+
+	while (iAmt > 0) {
+		if (iOfst >= p->uncompressed_size) {
+			/* SQLite requires the unread part of the buffer to be zero-filled */
+			memset(destination, 0, iAmt);
+			return SQLITE_IOERR_SHORT_READ;
+		}
+
+		const uint8_t *block_data;
+		int64_t block_data_size;
+		int rc = p->get_block(iOfst / p->block_size, &block_data, &block_data_size);
+		if (rc != SQLITE_OK) {
+			return rc;
+		}
+
+		int64_t offset_in_block = iOfst % p->block_size;
+		int amount = (int)MIN((int64_t)iAmt, block_data_size - offset_in_block);
+		memcpy(destination, block_data + offset_in_block, amount);
+
+		destination += amount;
+		iOfst += amount;
+		iAmt -= amount;
+	}
+
+	return SQLITE_OK;
+}
+
+/*
+** Compressed databases can't be modified.
+*/
+int gdsqlite_compressed_file::write(sqlite3_file *pFile, const void *zBuf, int iAmt, sqlite_int64 iOfst) {
+	return SQLITE_READONLY;
+}
+int gdsqlite_compressed_file::truncate(sqlite3_file *pFile, sqlite_int64 size) {
+	return SQLITE_READONLY;
+}
+int gdsqlite_compressed_file::sync(sqlite3_file *pFile, int flags) {
+	return SQLITE_OK;
+}
+
+/*
+** Write the size of the uncompressed database in bytes to *pSize.
+*/
+int gdsqlite_compressed_file::fileSize(sqlite3_file *pFile, sqlite_int64 *pSize) {
+	gdsqlite_compressed_file *p = reinterpret_cast<gdsqlite_compressed_file *>(pFile);
+	*pSize = p->uncompressed_size;
+	return SQLITE_OK;
+}
+
+/*
+** Locking and file control are handled by the underlying file.
+*/
+int gdsqlite_compressed_file::lock(sqlite3_file *pFile, int eLock) {
+	gdsqlite_compressed_file *p = reinterpret_cast<gdsqlite_compressed_file *>(pFile);
+	return p->real->pMethods->xLock(p->real, eLock);
+}
+int gdsqlite_compressed_file::unlock(sqlite3_file *pFile, int eLock) {
+	gdsqlite_compressed_file *p = reinterpret_cast<gdsqlite_compressed_file *>(pFile);
+	return p->real->pMethods->xUnlock(p->real, eLock);
+}
+int gdsqlite_compressed_file::checkReservedLock(sqlite3_file *pFile, int *pResOut) {
+	gdsqlite_compressed_file *p = reinterpret_cast<gdsqlite_compressed_file *>(pFile);
+	return p->real->pMethods->xCheckReservedLock(p->real, pResOut);
+}
+int gdsqlite_compressed_file::fileControl(sqlite3_file *pFile, int op, void *pArg) {
+	gdsqlite_compressed_file *p = reinterpret_cast<gdsqlite_compressed_file *>(pFile);
+	if (op == GDSQLITE_FCNTL_PREFETCH_RANGE) {
+		/* Translate the range of the database to the range of the compressed blocks that contain it */
+		const gdsqlite_prefetch_range *range = reinterpret_cast<const gdsqlite_prefetch_range *>(pArg);
+		if (range->length <= 0 || range->offset >= p->uncompressed_size) {
+			return SQLITE_OK;
+		}
+		int64_t first_block = range->offset / p->block_size;
+		int64_t last_block = MIN((range->offset + range->length - 1) / p->block_size, (int64_t)p->blocks.size() - 1);
+
+		gdsqlite_prefetch_range stored_range;
+		stored_range.offset = p->blocks[first_block].offset;
+		stored_range.length = p->blocks[last_block].offset + p->blocks[last_block].stored_size - stored_range.offset;
+		return p->real->pMethods->xFileControl(p->real, op, &stored_range);
+	}
+	return p->real->pMethods->xFileControl(p->real, op, pArg);
+}
+
+/*
+** The xSectorSize() and xDeviceCharacteristics() methods. A compressed
+** database can only be created by `SQLite.compress_database()` and never
+** changes afterwards, which allows SQLite to skip all change detection.
+*/
+int gdsqlite_compressed_file::sectorSize(sqlite3_file *pFile) {
+	return 4096;
+}
+int gdsqlite_compressed_file::deviceCharacteristics(sqlite3_file *pFile) {
+	return SQLITE_IOCAP_IMMUTABLE;
+}
@@ -0,0 +1,78 @@
+#ifndef GDSQLITE_COMPRESSED_FILE_H
+#define GDSQLITE_COMPRESSED_FILE_H
+
+#include <godot_cpp/classes/file_access.hpp>
+#include <godot_cpp/variant/packed_byte_array.hpp>
+
+#include "./sqlite/sqlite3.h"
+#include "gdsqlite_prefetcher.hpp"
+#include <cstring>
+#include <vector>
+
+/*
+** Layout of a compressed database file (all integers are little-endian):
+**
+**   header:  magic (8 bytes), block_size (u32), compression_mode (u32),
+**            uncompressed_size (u64), block_count (u32)
+**   index:   block_count x [offset (u64), stored_size (u32)]
+**   blocks:  block_count x compressed block
+**
+** Every block holds block_size bytes of the original database file, except
+** for the last one which might be shorter. Blocks that don't compress are
+** stored as-is, in which case their stored_size equals their original size.
+*/
+#define COMPRESSED_MAGIC "GDSQLZ01"
+#define COMPRESSED_MAGIC_SIZE 8
+#define COMPRESSED_HEADER_SIZE (COMPRESSED_MAGIC_SIZE + 4 + 4 + 8 + 4)
+#define COMPRESSED_INDEX_ENTRY_SIZE (8 + 4)
+#define COMPRESSED_DEFAULT_BLOCK_SIZE (64 * 1024)
+
+/*
+** The number of decompressed blocks that are kept in memory per file.
+*/
+#define COMPRESSED_CACHE_SIZE 8
+
+namespace godot {
+struct gdsqlite_compressed_block {
+	uint64_t offset;
+	uint32_t stored_size;
+};
+
+struct gdsqlite_cached_block {
+	int64_t index = -1;
+	uint64_t last_used = 0;
+	PackedByteArray data;
+};
+
+struct gdsqlite_compressed_file {
+	sqlite3_file base; /* Base class. Must be first. */
+	sqlite3_file *real; /* The underlying file as opened by the godot VFS */
+
+	uint32_t block_size = 0;
+	int compression_mode = 0;
+	sqlite_int64 uncompressed_size = 0;
+	std::vector<gdsqlite_compressed_block> blocks;
+
+	gdsqlite_cached_block cache[COMPRESSED_CACHE_SIZE];
+	uint64_t cache_clock = 0;
+
+	int read_header();
+	int get_block(int64_t p_index, const uint8_t **r_data, int64_t *r_size);
+
+	static int close(sqlite3_file *pFile);
+	static int read(sqlite3_file *pFile, void *zBuf, int iAmt, sqlite_int64 iOfst);
+	static int write(sqlite3_file *pFile, const void *zBuf, int iAmt, sqlite_int64 iOfst);
+	static int truncate(sqlite3_file *pFile, sqlite_int64 size);
+	static int sync(sqlite3_file *pFile, int flags);
+	static int fileSize(sqlite3_file *pFile, sqlite_int64 *pSize);
+	static int lock(sqlite3_file *pFile, int eLock);
+	static int unlock(sqlite3_file *pFile, int eLock);
+	static int checkReservedLock(sqlite3_file *pFile, int *pResOut);
+	static int fileControl(sqlite3_file *pFile, int op, void *pArg);
+	static int sectorSize(sqlite3_file *pFile);
+	static int deviceCharacteristics(sqlite3_file *pFile);
+};
+
+} //namespace godot
+
+#endif
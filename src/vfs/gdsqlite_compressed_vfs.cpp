@@ -0,0 +1,163 @@
+#include "gdsqlite_compressed_vfs.hpp"
+
+using namespace godot;
+
+/*
+** The I/O methods of the main database file of a compressed database.
+*/
+const sqlite3_io_methods *godot::gdsqlite_compressed_file_io_methods() {
+	static const sqlite3_io_methods io_methods = {
+		1, /* iVersion */
+		gdsqlite_compressed_file::close, /* xClose */
+		gdsqlite_compressed_file::read, /* xRead */
+		gdsqlite_compressed_file::write, /* xWrite */
+		gdsqlite_compressed_file::truncate, /* xTruncate */
+		gdsqlite_compressed_file::sync, /* xSync */
+		gdsqlite_compressed_file::fileSize, /* xFileSize */
+		gdsqlite_compressed_file::lock, /* xLock */
+		gdsqlite_compressed_file::unlock, /* xUnlock */
+		gdsqlite_compressed_file::checkReservedLock, /* xCheckReservedLock */
+		gdsqlite_compressed_file::fileControl, /* xFileControl */
+		gdsqlite_compressed_file::sectorSize, /* xSectorSize */
+		gdsqlite_compressed_file::deviceCharacteristics, /* xDeviceCharacteristics */
+	};
+	return &io_methods;
+}
+
+/*
+** Open a file handle. The main database file is opened through the godot VFS
+** and wrapped in a gdsqlite_compressed_file, all other files (journals,
+** temporary files, ...) are handed to the godot VFS directly.
+*/
+static int gdsqlite_compressed_vfs_open(sqlite3_vfs *pVfs, const char *zName, sqlite3_file *pFile, int flags, int *pOutFlags) {
+	sqlite3_vfs *real_vfs = reinterpret_cast<sqlite3_vfs *>(pVfs->pAppData);
+
+	if (!(flags & SQLITE_OPEN_MAIN_DB)) {
+		return real_vfs->xOpen(real_vfs, zName, pFile, flags, pOutFlags);
+	}
+
+	/* Compressed databases are always opened in read-only mode */
+	flags = (flags & ~(SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE)) | SQLITE_OPEN_READONLY;
+
+	sqlite3_file *real = reinterpret_cast<sqlite3_file *>(sqlite3_malloc(real_vfs->szOsFile));
+	if (real == nullptr) {
+		return SQLITE_NOMEM;
+	}
+	memset(real, 0, real_vfs->szOsFile);
+
+	int rc = real_vfs->xOpen(real_vfs, zName, real, flags, nullptr);
+	if (rc != SQLITE_OK) {
+		if (real->pMethods) {
+			real->pMethods->xClose(real);
+		}
+		sqlite3_free(real);
+		return rc;
+	}
+
+	/* SQLite only allocates the memory of the file handle, so its members have to be constructed in-place */
+	gdsqlite_compressed_file *p = new (pFile) gdsqlite_compressed_file();
+	p->real = real;
+
+	rc = p->read_header();
+	if (rc != SQLITE_OK) {
+		ERR_PRINT("GDSQLITE_VFS Error: " + String(zName) + " is not a valid compressed database!");
+		real->pMethods->xClose(real);
+		sqlite3_free(real);
+		p->~gdsqlite_compressed_file();
+		return rc;
+	}
+
+	if (pOutFlags) {
+		*pOutFlags = flags;
+	}
+	p->base.pMethods = gdsqlite_compressed_file_io_methods();
+	return SQLITE_OK;
+}
+
+/*
+** This function returns a pointer to the VFS implemented in this file,
+** which is stacked on top of the godot VFS. Apart from opening files, all
+** functionality is provided by the godot VFS itself.
+*/
+sqlite3_vfs *godot::gdsqlite_compressed_vfs() {
+	static sqlite3_vfs compressed_vfs = []() {
+		sqlite3_vfs *real_vfs = gdsqlite_vfs();
+		sqlite3_vfs vfs = *real_vfs;
+		vfs.szOsFile = MAX((int)sizeof(gdsqlite_compressed_file), real_vfs->szOsFile);
+		vfs.pNext = 0;
+		vfs.zName = "godot_compressed";
+		vfs.pAppData = real_vfs;
+		vfs.xOpen = gdsqlite_compressed_vfs_open;
+		return vfs;
+	}();
+	return &compressed_vfs;
+}
+
+/*
+** Check if the file at the given path starts with the magic of a
+** compressed database.
+*/
+bool godot::gdsqlite_is_compressed_database(const String &p_path) {
+	Ref<FileAccess> file = FileAccess::open(p_path, FileAccess::READ);
+	if (file.is_null()) {
+		return false;
+	}
+
+	uint8_t magic[COMPRESSED_MAGIC_SIZE];
+	if (file->get_buffer(magic, COMPRESSED_MAGIC_SIZE) != COMPRESSED_MAGIC_SIZE) {
+		return false;
+	}
+	return memcmp(magic, COMPRESSED_MAGIC, COMPRESSED_MAGIC_SIZE) == 0;
+}
+
+/*
+** Convert an ordinary database file into a compressed database that can be
+** opened with the VFS implemented in this file. The database shouldn't be
+** modified during the conversion.
+*/
+Error godot::gdsqlite_compress_database(const String &p_source_path, const String &p_destination_path, uint32_t p_block_size, FileAccess::CompressionMode p_compression_mode) {
+	ERR_FAIL_COND_V_MSG(p_block_size == 0, ERR_INVALID_PARAMETER, "GDSQLite Error: The block size of a compressed database can't be zero!");
+
+	Ref<FileAccess> source = FileAccess::open(p_source_path, FileAccess::READ);
+	if (source.is_null()) {
+		return FileAccess::get_open_error();
+	}
+	Ref<FileAccess> destination = FileAccess::open(p_destination_path, FileAccess::WRITE);
+	if (destination.is_null()) {
+		return FileAccess::get_open_error();
+	}
+
+	uint64_t uncompressed_size = source->get_length();
+	uint32_t block_count = (uncompressed_size + p_block_size - 1) / p_block_size;
+
+	destination->store_buffer(reinterpret_cast<const uint8_t *>(COMPRESSED_MAGIC), COMPRESSED_MAGIC_SIZE);
+	destination->store_32(p_block_size);
+	destination->store_32(p_compression_mode);
+	destination->store_64(uncompressed_size);
+	destination->store_32(block_count);
+
+	/* The index is written once all blocks have been compressed */
+	uint64_t index_position = destination->get_position();
+	uint64_t block_position = index_position + (uint64_t)block_count * COMPRESSED_INDEX_ENTRY_SIZE;
+	destination->seek(block_position);
+
+	std::vector<gdsqlite_compressed_block> blocks(block_count);
+	for (uint32_t i = 0; i < block_count; i++) {
+		PackedByteArray original = source->get_buffer(p_block_size);
+		PackedByteArray compressed = original.compress(p_compression_mode);
+		/* Blocks that don't compress are stored as-is */
+		const PackedByteArray &stored = compressed.size() < original.size() ? compressed : original;
+
+		blocks[i].offset = destination->get_position();
+		blocks[i].stored_size = stored.size();
+		destination->store_buffer(stored);
+	}
+
+	destination->seek(index_position);
+	for (const gdsqlite_compressed_block &block : blocks) {
+		destination->store_64(block.offset);
+		destination->store_32(block.stored_size);
+	}
+
+	return destination->get_error();
+}
@@ -0,0 +1,22 @@
+#ifndef GDSQLITE_COMPRESSED_VFS_H
+#define GDSQLITE_COMPRESSED_VFS_H
+
+#include <godot_cpp/variant/utility_functions.hpp>
+
+#include <godot_cpp/classes/file_access.hpp>
+
+#include "./sqlite/sqlite3.h"
+#include "gdsqlite_compressed_file.hpp"
+#include "gdsqlite_vfs.hpp"
+
+namespace godot {
+
+sqlite3_vfs *gdsqlite_compressed_vfs();
+const sqlite3_io_methods *gdsqlite_compressed_file_io_methods();
+
+bool gdsqlite_is_compressed_database(const String &p_path);
+Error gdsqlite_compress_database(const String &p_source_path, const String &p_destination_path, uint32_t p_block_size, FileAccess::CompressionMode p_compression_mode);
+
+}
+
+#endif
@@ -7,12 +7,23 @@ using namespace godot;
 */
 int gdsqlite_file::close(sqlite3_file *pFile) {
 	gdsqlite_file *p = reinterpret_cast<gdsqlite_file *>(pFile);
-	ERR_FAIL_COND_V(!p->file->is_open(), SQLITE_IOERR_CLOSE);
+	bool was_open = p->file.is_valid() && p->file->is_open();
+
+	int rc = was_open ? p->flush_write_buffer() : SQLITE_IOERR_CLOSE;
+	p->prefetcher.reset();
 
-	p->file->close();
+	if (was_open) {
+		p->file->close();
+	}
 	p->file.unref();
+	/* The lock entry and the handle are released even if the file was closed already */
+	p->lock_state.close();
 
-	return SQLITE_OK;
+	/* The file handle was constructed in-place by `gdsqlite_vfs_open()` */
+	p->~gdsqlite_file();
+
+	ERR_FAIL_COND_V(!was_open, SQLITE_IOERR_CLOSE);
+	return rc;
 }
 
 /*
@@ -22,58 +33,177 @@ int gdsqlite_file::read(sqlite3_file *pFile, void *zBuf, int iAmt, sqlite_int64
 	gdsqlite_file *p = reinterpret_cast<gdsqlite_file *>(pFile);
 	ERR_FAIL_COND_V(!p->file->is_open(), SQLITE_IOERR_CLOSE);
 
+	gdsqlite_io_timer timer(p->io_stats.read_latency);
+	p->io_stats.reads.fetch_add(1, std::memory_order_relaxed);
+
+	/* Make sure that any buffered writes in the requested range are visible */
+	if (!p->write_buffer.empty() && iOfst < p->write_buffer_offset + (sqlite_int64)p->write_buffer.size() && iOfst + iAmt > p->write_buffer_offset) {
+		int rc = p->flush_write_buffer();
+		if (rc != SQLITE_OK) {
+			return rc;
+		}
+	}
+
+	/* Serve the read from the blocks that were fetched ahead of time by the prefetcher */
+	if (p->prefetcher && p->prefetcher->read(reinterpret_cast<uint8_t *>(zBuf), iAmt, iOfst)) {
+		p->io_stats.prefetch_hits.fetch_add(1, std::memory_order_relaxed);
+		p->io_stats.bytes_read.fetch_add(iAmt, std::memory_order_relaxed);
+		return SQLITE_OK;
+	}
+
 	/* Seek the wanted position in the file */
-	p->file->seek(iOfst);
-	ERR_FAIL_COND_V(p->file->get_position() != iOfst, SQLITE_IOERR_READ);
+	ERR_FAIL_COND_V(!p->seek(iOfst), SQLITE_IOERR_READ);
 
 	/* Read and populate the data */
-	PackedByteArray arr = p->file->get_buffer(iAmt);
-	memcpy(zBuf, arr.ptr(), iAmt);
+	uint64_t bytes_read = p->file->get_buffer(reinterpret_cast<uint8_t *>(zBuf), iAmt);
+	p->position += bytes_read;
+	p->io_stats.bytes_read.fetch_add(bytes_read, std::memory_order_relaxed);
 
-	if (arr.size() == iAmt) {
+	if (bytes_read == (uint64_t)iAmt) {
 		return SQLITE_OK;
-	} else if (arr.size() >= 0) {
-		return SQLITE_IOERR_SHORT_READ;
 	}
 
-	ERR_FAIL_V(SQLITE_IOERR_READ);
+	/* SQLite requires the unread part of the buffer to be zero-filled */
+	p->io_stats.short_reads.fetch_add(1, std::memory_order_relaxed);
+	memset(reinterpret_cast<uint8_t *>(zBuf) + bytes_read, 0, iAmt - bytes_read);
+	return SQLITE_IOERR_SHORT_READ;
 }
 
 /*
 ** Write data to a file.
+** Writes are collected in the write-back buffer for as long as they are
+** adjacent to the previously buffered data. SQLite mostly writes journals
+** and databases page by page in increasing order, which allows turning many
+** small writes into a few large sequential ones.
 */
 int gdsqlite_file::write(sqlite3_file *pFile, const void *zBuf, int iAmt, sqlite_int64 iOfst) {
 	gdsqlite_file *p = reinterpret_cast<gdsqlite_file *>(pFile);
 	ERR_FAIL_COND_V(!p->file->is_open(), SQLITE_IOERR_CLOSE);
 
-	/* Seek the wanted position in the file */
-	p->file->seek(iOfst);
-	ERR_FAIL_COND_V(p->file->get_position() != iOfst, SQLITE_IOERR_READ);
+	gdsqlite_io_timer timer(p->io_stats.write_latency);
+	p->io_stats.writes.fetch_add(1, std::memory_order_relaxed);
+	p->io_stats.bytes_written.fetch_add(iAmt, std::memory_order_relaxed);
+
+	const uint8_t *data = reinterpret_cast<const uint8_t *>(zBuf);
+	sqlite_int64 buffer_end = p->write_buffer_offset + (sqlite_int64)p->write_buffer.size();
+
+	if (!p->write_buffer.empty()) {
+		/* Overwrite data that is still in the buffer, for example when a page gets modified twice */
+		if (iOfst >= p->write_buffer_offset && iOfst + iAmt <= buffer_end) {
+			memcpy(p->write_buffer.data() + (iOfst - p->write_buffer_offset), data, iAmt);
+			return SQLITE_OK;
+		}
+		/* Append data that continues right where the buffer ends */
+		if (iOfst == buffer_end && p->write_buffer.size() + iAmt <= WRITE_BUFFER_SIZE) {
+			p->write_buffer.insert(p->write_buffer.end(), data, data + iAmt);
+			return SQLITE_OK;
+		}
 
-	/* Write the data to the file */
-	PackedByteArray arr = PackedByteArray();
-	arr.resize(iAmt);
-	memcpy(arr.ptrw(), zBuf, iAmt);
-	p->file->store_buffer(arr);
+		int rc = p->flush_write_buffer();
+		if (rc != SQLITE_OK) {
+			return rc;
+		}
+	}
+
+	if (iAmt < WRITE_BUFFER_SIZE) {
+		p->write_buffer.reserve(WRITE_BUFFER_SIZE);
+		p->write_buffer.assign(data, data + iAmt);
+		p->write_buffer_offset = iOfst;
+		return SQLITE_OK;
+	}
+
+	/* Writes that don't fit in the buffer are written to the file immediately */
+	ERR_FAIL_COND_V(!p->seek(iOfst), SQLITE_IOERR_WRITE);
+
+	p->file->store_buffer(data, iAmt);
 
 	/* Was the write succesful? */
-	size_t bytes_written = p->file->get_position() - iOfst;
-	ERR_FAIL_COND_V(bytes_written != iAmt, SQLITE_IOERR_WRITE);
+	p->position = p->file->get_position();
+	ERR_FAIL_COND_V(p->position - iOfst != iAmt, SQLITE_IOERR_WRITE);
 
 	return SQLITE_OK;
 }
 
 /*
-** Truncate a file. This is a no-op for this VFS.
+** Move the file descriptor to the given offset, unless it's already there.
+*/
+bool gdsqlite_file::seek(sqlite_int64 p_offset) {
+	if (position == p_offset) {
+		return true;
+	}
+
+	io_stats.seeks.fetch_add(1, std::memory_order_relaxed);
+	file->seek(p_offset);
+	position = file->get_position();
+	return position == p_offset;
+}
+
+/*
+** Write the contents of the write-back buffer to the file.
+*/
+int gdsqlite_file::flush_write_buffer() {
+	if (write_buffer.empty()) {
+		return SQLITE_OK;
+	}
+
+	ERR_FAIL_COND_V(!seek(write_buffer_offset), SQLITE_IOERR_WRITE);
+
+	file->store_buffer(write_buffer.data(), write_buffer.size());
+
+	/* Was the write succesful? */
+	position = file->get_position();
+	ERR_FAIL_COND_V(position - write_buffer_offset != (sqlite_int64)write_buffer.size(), SQLITE_IOERR_WRITE);
+
+	write_buffer.clear();
+	return SQLITE_OK;
+}
+
+/*
+** Truncate a file.
 */
 int gdsqlite_file::truncate(sqlite3_file *pFile, sqlite_int64 size) {
+	gdsqlite_file *p = reinterpret_cast<gdsqlite_file *>(pFile);
+	ERR_FAIL_COND_V(!p->file->is_open(), SQLITE_IOERR_CLOSE);
+
+	p->io_stats.truncates.fetch_add(1, std::memory_order_relaxed);
+
+	int rc = p->flush_write_buffer();
+	if (rc != SQLITE_OK) {
+		return rc;
+	}
+
+	/* Resizing the file might move the file descriptor */
+	p->position = -1;
+	if (p->file->resize(size) != Error::OK) {
+		return SQLITE_IOERR_TRUNCATE;
+	}
+
 	return SQLITE_OK;
 }
 
 /*
 ** Sync the contents of the file to the persistent media.
+** Godot's FileAccess doesn't expose fsync(), so the best we can do is to
+** flush all buffered data to the OS. SQLite skips this call entirely when
+** `PRAGMA synchronous` is set to OFF.
 */
 int gdsqlite_file::sync(sqlite3_file *pFile, int flags) {
+	gdsqlite_file *p = reinterpret_cast<gdsqlite_file *>(pFile);
+	ERR_FAIL_COND_V(!p->file->is_open(), SQLITE_IOERR_CLOSE);
+
+	gdsqlite_io_timer timer(p->io_stats.sync_latency);
+	p->io_stats.syncs.fetch_add(1, std::memory_order_relaxed);
+
+	int rc = p->flush_write_buffer();
+	if (rc != SQLITE_OK) {
+		return rc;
+	}
+
+	p->file->flush();
+	if (p->file->get_error() != Error::OK) {
+		return SQLITE_IOERR_FSYNC;
+	}
+
 	return SQLITE_OK;
 }
 
@@ -85,42 +215,93 @@ int gdsqlite_file::fileSize(sqlite3_file *pFile, sqlite_int64 *pSize) {
 	ERR_FAIL_COND_V(!p->file->is_open(), SQLITE_IOERR_CLOSE);
 
 	*pSize = p->file->get_length();
+	/* Buffered writes might extend the file */
+	if (!p->write_buffer.empty()) {
+		*pSize = MAX(*pSize, p->write_buffer_offset + (sqlite_int64)p->write_buffer.size());
+	}
 
 	return SQLITE_OK;
 }
 
 /*
-** Locking functions. The xLock() and xUnlock() methods are both no-ops.
-** The xCheckReservedLock() always indicates that no other process holds
-** a reserved lock on the database file. This ensures that if a hot-journal
-** file is found in the file-system it is rolled back.
+** Locking functions. Locks are only shared between the connections of this
+** process, since Godot doesn't provide any kind of file-system locking.
+** Only the main database file has a lock state, locks on any other files
+** (journals, temporary files, ...) are no-ops.
 */
 int gdsqlite_file::lock(sqlite3_file *pFile, int eLock) {
-	return SQLITE_OK;
+	gdsqlite_file *p = reinterpret_cast<gdsqlite_file *>(pFile);
+	return p->lock_state.lock(eLock);
 }
 int gdsqlite_file::unlock(sqlite3_file *pFile, int eLock) {
-	return SQLITE_OK;
+	gdsqlite_file *p = reinterpret_cast<gdsqlite_file *>(pFile);
+	/* Other connections read through their own FileAccess, so they have to see all writes before the lock is released */
+	int rc = p->flush_write_buffer();
+	if (rc != SQLITE_OK) {
+		return rc;
+	}
+	/* FileAccess buffers writes of its own, which would stay invisible to handles that lock the file next */
+	if (eLock == SQLITE_LOCK_NONE && !p->read_only) {
+		p->file->flush();
+	}
+	return p->lock_state.unlock(eLock);
 }
 int gdsqlite_file::checkReservedLock(sqlite3_file *pFile, int *pResOut) {
-	*pResOut = 0;
+	gdsqlite_file *p = reinterpret_cast<gdsqlite_file *>(pFile);
+	*pResOut = p->lock_state.is_reserved();
 	return SQLITE_OK;
 }
 
 /*
-** No xFileControl() verbs are implemented by this VFS.
+** The only xFileControl() verbs implemented by this VFS are custom ones:
+** - GDSQLITE_FCNTL_IO_STATS gives access to the I/O counters of the file.
+** - GDSQLITE_FCNTL_PREFETCH_ENABLE starts the prefetcher of a read-only file.
+** - GDSQLITE_FCNTL_PREFETCH_RANGE makes the prefetcher read the given range.
 */
 int gdsqlite_file::fileControl(sqlite3_file *pFile, int op, void *pArg) {
-	return SQLITE_NOTFOUND;
+	gdsqlite_file *p = reinterpret_cast<gdsqlite_file *>(pFile);
+	switch (op) {
+		case GDSQLITE_FCNTL_IO_STATS:
+			*reinterpret_cast<gdsqlite_io_stats **>(pArg) = &p->io_stats;
+			return SQLITE_OK;
+
+		case GDSQLITE_FCNTL_PREFETCH_ENABLE:
+			/* Prefetched blocks are never invalidated, so the file can't be allowed to change */
+			ERR_FAIL_COND_V_MSG(!p->read_only, SQLITE_MISUSE, "GDSQLITE_VFS Error: Prefetching is only supported for read-only files!");
+			if (!p->prefetcher) {
+				std::unique_ptr<gdsqlite_prefetcher> prefetcher = std::make_unique<gdsqlite_prefetcher>();
+				if (!prefetcher->start(p->path)) {
+					return SQLITE_IOERR;
+				}
+				p->prefetcher = std::move(prefetcher);
+			}
+			return SQLITE_OK;
+
+		case GDSQLITE_FCNTL_PREFETCH_RANGE: {
+			if (!p->prefetcher) {
+				return SQLITE_MISUSE;
+			}
+			const gdsqlite_prefetch_range *range = reinterpret_cast<const gdsqlite_prefetch_range *>(pArg);
+			p->prefetcher->request(range->offset, range->length);
+			return SQLITE_OK;
+		}
+
+		default:
+			return SQLITE_NOTFOUND;
+	}
 }
 
 /*
-** The xSectorSize() and xDeviceCharacteristics() methods. These two
-** may return special values allowing SQLite to optimize file-system
-** access to some extent. But it is also safe to simply return 0.
+** The xSectorSize() and xDeviceCharacteristics() methods. FileAccess
+** doesn't report the sector size of the underlying storage, so the common
+** 4096 bytes are assumed. No device characteristics are reported: writes can
+** sit in the write-back buffer and in FileAccess' own buffers until the next
+** sync, so SQLite has to keep syncing the journal before it writes to the
+** database.
 */
 int gdsqlite_file::sectorSize(sqlite3_file *pFile) {
-	return 0;
+	return 4096;
 }
 int gdsqlite_file::deviceCharacteristics(sqlite3_file *pFile) {
 	return 0;
-}
+}
\ No newline at end of file
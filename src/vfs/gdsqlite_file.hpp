@@ -4,12 +4,34 @@
 #include <godot_cpp/classes/file_access.hpp>
 
 #include "./sqlite/sqlite3.h"
+#include "gdsqlite_io_stats.hpp"
+#include "gdsqlite_lock.hpp"
+#include "gdsqlite_prefetcher.hpp"
 #include <cstring>
+#include <memory>
+#include <vector>
+
+/*
+** The maximum amount of adjacent writes that are coalesced in memory before
+** being written to the file with a single call to FileAccess.
+*/
+#define WRITE_BUFFER_SIZE (256 * 1024)
 
 namespace godot {
 struct gdsqlite_file {
 	sqlite3_file base; /* Base class. Must be first. */
 	Ref<FileAccess> file; /* File descriptor */
+	String path; /* Path of the file as given to xOpen() */
+	bool read_only = false;
+	gdsqlite_lock lock_state; /* In-process lock of the main database file */
+	std::vector<uint8_t> write_buffer; /* Adjacent writes that haven't been written to the file yet */
+	sqlite_int64 write_buffer_offset = 0; /* Offset in the file of the first byte of write_buffer */
+	sqlite_int64 position = 0; /* Current position of the file descriptor, or -1 if unknown */
+	gdsqlite_io_stats io_stats;
+	std::unique_ptr<gdsqlite_prefetcher> prefetcher; /* Only available for read-only files */
+
+	bool seek(sqlite_int64 p_offset);
+	int flush_write_buffer();
 
 	static int close(sqlite3_file *pFile);
 	static int read(sqlite3_file *pFile, void *zBuf, int iAmt, sqlite_int64 iOfst);
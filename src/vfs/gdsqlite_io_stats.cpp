@@ -0,0 +1,63 @@
+#include "gdsqlite_io_stats.hpp"
+
+using namespace godot;
+
+void gdsqlite_io_histogram::record(uint64_t p_usec) {
+	int bucket = 0;
+	while (p_usec > 0 && bucket < IO_STATS_HISTOGRAM_SIZE - 1) {
+		p_usec >>= 1;
+		bucket++;
+	}
+	buckets[bucket].fetch_add(1, std::memory_order_relaxed);
+}
+
+void gdsqlite_io_histogram::reset() {
+	for (int i = 0; i < IO_STATS_HISTOGRAM_SIZE; i++) {
+		buckets[i].store(0, std::memory_order_relaxed);
+	}
+}
+
+PackedInt64Array gdsqlite_io_histogram::to_array() const {
+	PackedInt64Array array;
+	array.resize(IO_STATS_HISTOGRAM_SIZE);
+	for (int i = 0; i < IO_STATS_HISTOGRAM_SIZE; i++) {
+		array[i] = (int64_t)buckets[i].load(std::memory_order_relaxed);
+	}
+	return array;
+}
+
+gdsqlite_io_stats::gdsqlite_io_stats() {
+	reset();
+}
+
+void gdsqlite_io_stats::reset() {
+	reads.store(0, std::memory_order_relaxed);
+	writes.store(0, std::memory_order_relaxed);
+	bytes_read.store(0, std::memory_order_relaxed);
+	bytes_written.store(0, std::memory_order_relaxed);
+	seeks.store(0, std::memory_order_relaxed);
+	syncs.store(0, std::memory_order_relaxed);
+	short_reads.store(0, std::memory_order_relaxed);
+	truncates.store(0, std::memory_order_relaxed);
+	prefetch_hits.store(0, std::memory_order_relaxed);
+	read_latency.reset();
+	write_latency.reset();
+	sync_latency.reset();
+}
+
+Dictionary gdsqlite_io_stats::to_dictionary() const {
+	Dictionary stats;
+	stats["reads"] = (int64_t)reads.load(std::memory_order_relaxed);
+	stats["writes"] = (int64_t)writes.load(std::memory_order_relaxed);
+	stats["bytes_read"] = (int64_t)bytes_read.load(std::memory_order_relaxed);
+	stats["bytes_written"] = (int64_t)bytes_written.load(std::memory_order_relaxed);
+	stats["seeks"] = (int64_t)seeks.load(std::memory_order_relaxed);
+	stats["syncs"] = (int64_t)syncs.load(std::memory_order_relaxed);
+	stats["short_reads"] = (int64_t)short_reads.load(std::memory_order_relaxed);
+	stats["truncates"] = (int64_t)truncates.load(std::memory_order_relaxed);
+	stats["prefetch_hits"] = (int64_t)prefetch_hits.load(std::memory_order_relaxed);
+	stats["read_latency_histogram"] = read_latency.to_array();
+	stats["write_latency_histogram"] = write_latency.to_array();
+	stats["sync_latency_histogram"] = sync_latency.to_array();
+	return stats;
+}
@@ -0,0 +1,72 @@
+#ifndef GDSQLITE_IO_STATS_H
+#define GDSQLITE_IO_STATS_H
+
+#include <godot_cpp/variant/dictionary.hpp>
+#include <godot_cpp/variant/packed_int64_array.hpp>
+
+#include <atomic>
+#include <chrono>
+
+/*
+** Latencies are recorded in power-of-two buckets of microseconds: bucket 0
+** counts calls that took less than 1 us, bucket i counts calls that took
+** between 2^(i-1) and 2^i us and the last bucket counts everything slower.
+*/
+#define IO_STATS_HISTOGRAM_SIZE 24
+
+/*
+** Custom xFileControl() opcode that makes the godot VFS write a pointer to
+** the gdsqlite_io_stats of the file to the gdsqlite_io_stats** argument.
+*/
+#define GDSQLITE_FCNTL_IO_STATS 0x47440001
+
+namespace godot {
+struct gdsqlite_io_histogram {
+	std::atomic<uint64_t> buckets[IO_STATS_HISTOGRAM_SIZE];
+
+	void record(uint64_t p_usec);
+	void reset();
+	PackedInt64Array to_array() const;
+};
+
+/*
+** I/O counters of a single open file. The counters are only ever written by
+** the connection that owns the file, but can be read or reset from any thread.
+*/
+struct gdsqlite_io_stats {
+	std::atomic<uint64_t> reads;
+	std::atomic<uint64_t> writes;
+	std::atomic<uint64_t> bytes_read;
+	std::atomic<uint64_t> bytes_written;
+	std::atomic<uint64_t> seeks;
+	std::atomic<uint64_t> syncs;
+	std::atomic<uint64_t> short_reads;
+	std::atomic<uint64_t> truncates;
+	std::atomic<uint64_t> prefetch_hits;
+	gdsqlite_io_histogram read_latency;
+	gdsqlite_io_histogram write_latency;
+	gdsqlite_io_histogram sync_latency;
+
+	gdsqlite_io_stats();
+
+	void reset();
+	Dictionary to_dictionary() const;
+};
+
+/*
+** Records the time between its construction and destruction in a histogram.
+*/
+struct gdsqlite_io_timer {
+	gdsqlite_io_histogram &histogram;
+	std::chrono::steady_clock::time_point start;
+
+	gdsqlite_io_timer(gdsqlite_io_histogram &p_histogram) :
+			histogram(p_histogram), start(std::chrono::steady_clock::now()) {}
+	~gdsqlite_io_timer() {
+		histogram.record(std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count());
+	}
+};
+
+} //namespace godot
+
+#endif
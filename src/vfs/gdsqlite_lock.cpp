@@ -0,0 +1,152 @@
+#include "gdsqlite_lock.hpp"
+
+using namespace godot;
+
+/*
+** All lock entries, keyed by the simplified path of the database file.
+** Both the map and the entries themselves are protected by the same mutex.
+*/
+static std::mutex &lock_mutex() {
+	static std::mutex mutex;
+	return mutex;
+}
+
+static std::unordered_map<std::string, gdsqlite_lock_entry *> &lock_entries() {
+	static std::unordered_map<std::string, gdsqlite_lock_entry *> entries;
+	return entries;
+}
+
+/*
+** Attach this file handle to the lock entry of the given path, creating
+** the entry if this is the first handle to open the file.
+*/
+void gdsqlite_lock::open(const String &p_path) {
+	const CharString dummy_path = p_path.simplify_path().utf8();
+	std::string key = std::string(dummy_path.get_data());
+
+	std::lock_guard<std::mutex> guard(lock_mutex());
+	gdsqlite_lock_entry *&new_entry = lock_entries()[key];
+	if (new_entry == nullptr) {
+		new_entry = new gdsqlite_lock_entry();
+		new_entry->path = key;
+	}
+	new_entry->reference_count++;
+
+	entry = new_entry;
+	level = SQLITE_LOCK_NONE;
+	holds_reserved = false;
+}
+
+/*
+** Release any locks still held by this file handle and detach it from the
+** lock entry. The entry is deleted once the last handle is closed.
+*/
+void gdsqlite_lock::close() {
+	if (entry == nullptr) {
+		return;
+	}
+	unlock(SQLITE_LOCK_NONE);
+
+	std::lock_guard<std::mutex> guard(lock_mutex());
+	entry->reference_count--;
+	if (entry->reference_count == 0) {
+		lock_entries().erase(entry->path);
+		delete entry;
+	}
+	entry = nullptr;
+}
+
+/*
+** Upgrade the lock of this file handle to eLock. Lock requests that can't
+** be satisfied immediately return SQLITE_BUSY, which allows SQLite to
+** invoke the busy-handler of the connection and retry later on.
+*/
+int gdsqlite_lock::lock(int eLock) {
+	if (entry == nullptr || level >= eLock) {
+		return SQLITE_OK;
+	}
+
+	std::lock_guard<std::mutex> guard(lock_mutex());
+	switch (eLock) {
+		case SQLITE_LOCK_SHARED:
+			/* New readers are kept out as soon as a writer is waiting for the EXCLUSIVE lock */
+			if (entry->pending || entry->exclusive) {
+				return SQLITE_BUSY;
+			}
+			entry->shared_count++;
+			level = SQLITE_LOCK_SHARED;
+			break;
+
+		case SQLITE_LOCK_RESERVED:
+			ERR_FAIL_COND_V(level != SQLITE_LOCK_SHARED, SQLITE_IOERR_LOCK);
+			if (entry->reserved) {
+				return SQLITE_BUSY;
+			}
+			entry->reserved = true;
+			holds_reserved = true;
+			level = SQLITE_LOCK_RESERVED;
+			break;
+
+		case SQLITE_LOCK_EXCLUSIVE:
+			ERR_FAIL_COND_V(level < SQLITE_LOCK_SHARED, SQLITE_IOERR_LOCK);
+			/* Acquire the PENDING lock first, and keep it while other readers are still active */
+			if (level < SQLITE_LOCK_PENDING) {
+				if (entry->pending) {
+					return SQLITE_BUSY;
+				}
+				entry->pending = true;
+				level = SQLITE_LOCK_PENDING;
+			}
+			if (entry->shared_count > 1) {
+				return SQLITE_BUSY;
+			}
+			entry->exclusive = true;
+			level = SQLITE_LOCK_EXCLUSIVE;
+			break;
+
+		default:
+			ERR_FAIL_V(SQLITE_IOERR_LOCK);
+	}
+
+	return SQLITE_OK;
+}
+
+/*
+** Downgrade the lock of this file handle to either SHARED or NONE.
+*/
+int gdsqlite_lock::unlock(int eLock) {
+	if (entry == nullptr || level <= eLock) {
+		return SQLITE_OK;
+	}
+
+	std::lock_guard<std::mutex> guard(lock_mutex());
+	if (level == SQLITE_LOCK_EXCLUSIVE) {
+		entry->exclusive = false;
+	}
+	if (level >= SQLITE_LOCK_PENDING) {
+		entry->pending = false;
+	}
+	if (holds_reserved) {
+		entry->reserved = false;
+		holds_reserved = false;
+	}
+	if (eLock == SQLITE_LOCK_NONE) {
+		entry->shared_count--;
+	}
+	level = eLock;
+
+	return SQLITE_OK;
+}
+
+/*
+** Check if any file handle of this process holds a RESERVED or higher
+** lock on the database file.
+*/
+bool gdsqlite_lock::is_reserved() const {
+	if (entry == nullptr) {
+		return false;
+	}
+
+	std::lock_guard<std::mutex> guard(lock_mutex());
+	return entry->reserved || entry->pending || entry->exclusive;
+}
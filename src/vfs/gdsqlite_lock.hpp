@@ -0,0 +1,49 @@
+#ifndef GDSQLITE_LOCK_H
+#define GDSQLITE_LOCK_H
+
+#include <godot_cpp/core/error_macros.hpp>
+#include <godot_cpp/variant/string.hpp>
+
+#include "./sqlite/sqlite3.h"
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+namespace godot {
+/*
+** Locking state that is shared between all file handles of this process
+** that have the same database file opened through the godot VFS.
+*/
+struct gdsqlite_lock_entry {
+	std::string path;
+	int reference_count = 0; /* Number of open file handles */
+	int shared_count = 0; /* Number of file handles holding at least a SHARED lock */
+	bool reserved = false;
+	bool pending = false;
+	bool exclusive = false;
+};
+
+/*
+** The locking state of a single file handle. Implements the same
+** NONE/SHARED/RESERVED/PENDING/EXCLUSIVE state machine as SQLite's native
+** VFSes, but only between connections of the same process since Godot's
+** FileAccess does not expose any kind of file-system locks. Writable
+** connections use the native VFS, so in practice this arbitrates between
+** readers, backups and compactions that go through the godot VFS.
+*/
+struct gdsqlite_lock {
+	gdsqlite_lock_entry *entry = nullptr;
+	int level = SQLITE_LOCK_NONE;
+	bool holds_reserved = false;
+
+	void open(const String &p_path);
+	void close();
+
+	int lock(int eLock);
+	int unlock(int eLock);
+	bool is_reserved() const;
+};
+
+} //namespace godot
+
+#endif
@@ -0,0 +1,145 @@
+#include "gdsqlite_prefetcher.hpp"
+
+using namespace godot;
+
+gdsqlite_prefetcher::~gdsqlite_prefetcher() {
+	stop();
+}
+
+/*
+** Open a second file descriptor for the worker thread and start it.
+*/
+bool gdsqlite_prefetcher::start(const String &p_path) {
+	file = FileAccess::open(p_path, FileAccess::READ);
+	if (file.is_null()) {
+		return false;
+	}
+
+	file_length = file->get_length();
+	exiting = false;
+	thread = std::thread(&gdsqlite_prefetcher::run, this);
+	return true;
+}
+
+void gdsqlite_prefetcher::stop() {
+	if (!thread.joinable()) {
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> guard(mutex);
+		exiting = true;
+	}
+	condition.notify_one();
+	thread.join();
+
+	file.unref();
+}
+
+/*
+** Queue a block, unless it's already cached, queued or beyond the end of
+** the file. The mutex has to be held by the caller.
+*/
+void gdsqlite_prefetcher::enqueue(int64_t p_block) {
+	if (p_block * PREFETCH_BLOCK_SIZE >= file_length || cache.count(p_block) || queued_blocks.count(p_block)) {
+		return;
+	}
+	queued_blocks.insert(p_block);
+	queue.push_back(p_block);
+}
+
+/*
+** Queue all blocks that overlap with the given range of the file.
+*/
+void gdsqlite_prefetcher::request(sqlite_int64 p_offset, sqlite_int64 p_length) {
+	if (p_length <= 0) {
+		return;
+	}
+
+	int64_t first_block = p_offset / PREFETCH_BLOCK_SIZE;
+	int64_t last_block = (p_offset + p_length - 1) / PREFETCH_BLOCK_SIZE;
+	{
+		std::lock_guard<std::mutex> guard(mutex);
+		for (int64_t block = first_block; block <= last_block; block++) {
+			enqueue(block);
+		}
+	}
+	condition.notify_one();
+}
+
+/*
+** Copy the requested range from the cache if all of its blocks have already
+** been prefetched, in which case true is returned. Otherwise the caller has
+** to read the data itself. Sequential reads make the prefetcher read ahead.
+*/
+bool gdsqlite_prefetcher::read(uint8_t *r_buffer, int p_amount, sqlite_int64 p_offset) {
+	int64_t first_block = p_offset / PREFETCH_BLOCK_SIZE;
+	int64_t last_block = (p_offset + p_amount - 1) / PREFETCH_BLOCK_SIZE;
+
+	std::unique_lock<std::mutex> lock(mutex);
+	if (p_offset == last_read_end) {
+		for (int64_t block = last_block + 1; block <= last_block + PREFETCH_READ_AHEAD; block++) {
+			enqueue(block);
+		}
+		condition.notify_one();
+	}
+	last_read_end = p_offset + p_amount;
+
+	for (int64_t block = first_block; block <= last_block; block++) {
+		auto it = cache.find(block);
+		if (it == cache.end()) {
+			return false;
+		}
+		/* The last block of the file might not contain the complete range */
+		sqlite_int64 range_end = MIN(p_offset + p_amount, (block + 1) * (sqlite_int64)PREFETCH_BLOCK_SIZE);
+		if (block * PREFETCH_BLOCK_SIZE + (sqlite_int64)it->second.size() < range_end) {
+			return false;
+		}
+	}
+
+	for (int64_t block = first_block; block <= last_block; block++) {
+		const std::vector<uint8_t> &data = cache[block];
+		sqlite_int64 block_offset = block * PREFETCH_BLOCK_SIZE;
+		sqlite_int64 start = MAX(p_offset, block_offset);
+		sqlite_int64 end = MIN(p_offset + p_amount, block_offset + (sqlite_int64)PREFETCH_BLOCK_SIZE);
+		memcpy(r_buffer + (start - p_offset), data.data() + (start - block_offset), end - start);
+	}
+	return true;
+}
+
+/*
+** Main loop of the worker thread.
+*/
+void gdsqlite_prefetcher::run() {
+	std::vector<uint8_t> data;
+	while (true) {
+		int64_t block;
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			condition.wait(lock, [this] { return exiting || !queue.empty(); });
+			if (exiting) {
+				return;
+			}
+			block = queue.front();
+			queue.pop_front();
+		}
+
+		data.resize(PREFETCH_BLOCK_SIZE);
+		file->seek(block * PREFETCH_BLOCK_SIZE);
+		uint64_t bytes_read = file->get_buffer(data.data(), PREFETCH_BLOCK_SIZE);
+		data.resize(bytes_read);
+
+		std::lock_guard<std::mutex> guard(mutex);
+		queued_blocks.erase(block);
+		if (bytes_read == 0) {
+			continue;
+		}
+		/* The oldest blocks are evicted first */
+		while (cache.size() >= PREFETCH_CACHE_SIZE) {
+			cache.erase(cache_order.front());
+			cache_order.pop_front();
+		}
+		cache[block] = std::move(data);
+		cache_order.push_back(block);
+	}
+}
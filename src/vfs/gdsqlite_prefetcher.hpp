@@ -0,0 +1,72 @@
+#ifndef GDSQLITE_PREFETCHER_H
+#define GDSQLITE_PREFETCHER_H
+
+#include <godot_cpp/classes/file_access.hpp>
+
+#include "./sqlite/sqlite3.h"
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+/*
+** The prefetcher reads the file in blocks of PREFETCH_BLOCK_SIZE bytes and
+** keeps at most PREFETCH_CACHE_SIZE of those blocks in memory. Whenever the
+** file is read sequentially, the next PREFETCH_READ_AHEAD blocks are queued.
+*/
+#define PREFETCH_BLOCK_SIZE (64 * 1024)
+#define PREFETCH_CACHE_SIZE 64
+#define PREFETCH_READ_AHEAD 4
+
+/*
+** Custom xFileControl() opcodes of the godot VFS. The first one starts the
+** prefetcher of a read-only database file, the second one queues the range
+** described by its gdsqlite_prefetch_range* argument.
+*/
+#define GDSQLITE_FCNTL_PREFETCH_ENABLE 0x47440002
+#define GDSQLITE_FCNTL_PREFETCH_RANGE 0x47440003
+
+namespace godot {
+struct gdsqlite_prefetch_range {
+	sqlite_int64 offset;
+	sqlite_int64 length;
+};
+
+/*
+** Reads blocks of a read-only file on a worker thread, ahead of the reads
+** done by SQLite itself. The worker uses its own FileAccess, since a single
+** FileAccess can't be shared between threads.
+*/
+class gdsqlite_prefetcher {
+	Ref<FileAccess> file;
+	std::thread thread;
+	std::mutex mutex;
+	std::condition_variable condition;
+	bool exiting = false;
+	sqlite_int64 file_length = 0;
+
+	std::deque<int64_t> queue;
+	std::unordered_set<int64_t> queued_blocks;
+	std::unordered_map<int64_t, std::vector<uint8_t>> cache;
+	std::deque<int64_t> cache_order;
+	sqlite_int64 last_read_end = -1;
+
+	void run();
+	void enqueue(int64_t p_block);
+
+public:
+	~gdsqlite_prefetcher();
+
+	bool start(const String &p_path);
+	void stop();
+
+	void request(sqlite_int64 p_offset, sqlite_int64 p_length);
+	bool read(uint8_t *r_buffer, int p_amount, sqlite_int64 p_offset);
+};
+
+} //namespace godot
+
+#endif
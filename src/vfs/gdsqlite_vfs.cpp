@@ -3,10 +3,10 @@
 using namespace godot;
 
 /*
-** Open a file handle.
+** The I/O methods of every file that is opened through the godot VFS.
 */
-static int gdsqlite_vfs_open(sqlite3_vfs *pVfs, const char *zName, sqlite3_file *pFile, int flags, int *pOutFlags) {
-	static const sqlite3_io_methods gdsqlite_file_io_methods = {
+const sqlite3_io_methods *godot::gdsqlite_file_io_methods() {
+	static const sqlite3_io_methods io_methods = {
 		1, /* iVersion */
 		gdsqlite_file::close, /* xClose */
 		gdsqlite_file::read, /* xRead */
@@ -21,7 +21,13 @@ static int gdsqlite_vfs_open(sqlite3_vfs *pVfs, const char *zName, sqlite3_file
 		gdsqlite_file::sectorSize, /* xSectorSize */
 		gdsqlite_file::deviceCharacteristics, /* xDeviceCharacteristics */
 	};
-	gdsqlite_file *p = reinterpret_cast<gdsqlite_file *>(pFile);
+	return &io_methods;
+}
+
+/*
+** Open a file handle.
+*/
+static int gdsqlite_vfs_open(sqlite3_vfs *pVfs, const char *zName, sqlite3_file *pFile, int flags, int *pOutFlags) {
 	Ref<FileAccess> file;
 	FileAccess::ModeFlags godot_flags;
 
@@ -70,8 +76,15 @@ static int gdsqlite_vfs_open(sqlite3_vfs *pVfs, const char *zName, sqlite3_file
 	if (pOutFlags) {
 		*pOutFlags = flags;
 	}
+	/* SQLite only allocates the memory of the file handle, so its members have to be constructed in-place */
+	gdsqlite_file *p = new (pFile) gdsqlite_file();
 	p->file = file;
-	p->base.pMethods = &gdsqlite_file_io_methods;
+	p->path = String(zName);
+	p->read_only = godot_flags == FileAccess::READ;
+	if (flags & SQLITE_OPEN_MAIN_DB) {
+		p->lock_state.open(String(zName));
+	}
+	p->base.pMethods = gdsqlite_file_io_methods();
 	return SQLITE_OK;
 }
 
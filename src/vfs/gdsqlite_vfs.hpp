@@ -10,6 +10,7 @@
 #include "./sqlite/sqlite3.h"
 #include "gdsqlite_file.hpp"
 #include <iostream>
+#include <new>
 #include <sstream>
 
 /*
@@ -20,6 +21,7 @@
 namespace godot {
 
 sqlite3_vfs *gdsqlite_vfs();
+const sqlite3_io_methods *gdsqlite_file_io_methods();
 
 }
 